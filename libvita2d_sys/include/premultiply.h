@@ -0,0 +1,10 @@
+#ifndef PREMULTIPLY_H
+#define PREMULTIPLY_H
+
+/* RGBA8 pixels in memory order, color channels are multiplied by alpha in place */
+void premultiply_alpha(void *pixels, unsigned int count);
+
+/* Scalar version, premultiply_alpha() must give the same bytes */
+void premultiply_alpha_ref(void *pixels, unsigned int count);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef PRESENT_H
+#define PRESENT_H
+
+#include <kernel.h>
+#include <appmgr.h>
+
+int _vita2d_present_init(SceUID shfb_id);
+void _vita2d_present_fini(void);
+int _vita2d_present_enabled(void);
+void _vita2d_present_acquire(SceSharedFbInfo *info);
+int _vita2d_present_submit(void);
+unsigned int _vita2d_present_pending(void);
+
+#endif
@@ -1,42 +0,0 @@
-﻿#ifndef TEXTURE_TINT_F_GXP_H
-#define TEXTURE_TINT_F_GXP_H
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-static const unsigned char texture_tint_f_gxp[324] = {
-	0x47, 0x58, 0x50, 0x00, 0x01, 0x05, 0x50, 0x03, 0x43, 0x01, 0x00, 0x00,
-	0x44, 0x2F, 0x5D, 0xFE, 0x70, 0xAB, 0x51, 0x1D, 0x05, 0x08, 0x18, 0x00,
-	0x00, 0x00, 0x00, 0x10, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x02, 0x00, 0x00, 0x00, 0xCC, 0x00, 0x00, 0x00, 0x70, 0x00, 0x00, 0x00,
-	0x04, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00,
-	0x05, 0x00, 0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x78, 0x00, 0x00, 0x00, 0x74, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x84, 0x00, 0x00, 0x00,
-	0xC0, 0x3D, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x78, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x78, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x68, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x60, 0x00, 0x00, 0x00,
-	0x01, 0x00, 0x00, 0x00, 0x58, 0x00, 0x00, 0x00, 0x7C, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x04,
-	0x01, 0x00, 0x01, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0xF9, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0xC0, 0x00, 0x00, 0x00, 0x30, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x07, 0x44, 0xFA,
-	0x00, 0x00, 0x00, 0x00, 0x40, 0x09, 0x00, 0xF8, 0x02, 0x80, 0x99, 0xFF,
-	0xBC, 0x0D, 0xC0, 0x40, 0x02, 0x80, 0xB9, 0xAF, 0xBC, 0x0D, 0x80, 0x40,
-	0x7C, 0x0F, 0x04, 0x00, 0x86, 0x47, 0xA4, 0x10, 0x0E, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x04, 0x00, 0x40, 0x00, 0x00, 0x00, 0x01, 0xE4, 0x00, 0x00,
-	0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3B, 0x00, 0x00, 0x00,
-	0x02, 0x04, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x01, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x75, 0x54, 0x69, 0x6E,
-	0x74, 0x43, 0x6F, 0x6C, 0x6F, 0x72, 0x00, 0x74, 0x65, 0x78, 0x00, 0x00
-};
-
-#ifdef __cplusplus
-}
-#endif
-
-#endif
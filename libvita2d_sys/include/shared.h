@@ -2,15 +2,244 @@
 #define SHARED_H
 
 /* Shared with other .c */
-extern float _vita2d_ortho_matrix[4*4];
 extern SceGxmContext *_vita2d_context;
 extern SceGxmVertexProgram *_vita2d_colorVertexProgram;
-extern SceGxmFragmentProgram *_vita2d_colorFragmentProgram;
+extern SceGxmVertexProgram *_vita2d_colorCompactVertexProgram;
+extern SceGxmVertexProgram *_vita2d_colorMeshVertexProgram;
 extern SceGxmVertexProgram *_vita2d_textureVertexProgram;
-extern SceGxmFragmentProgram *_vita2d_textureFragmentProgram;
-extern SceGxmFragmentProgram *_vita2d_textureTintFragmentProgram;
+extern SceGxmVertexProgram *_vita2d_textureTintVertexProgram;
+extern SceGxmVertexProgram *_vita2d_textureTintWideVertexProgram;
+extern SceGxmVertexProgram *_vita2d_textureTintArrayVertexProgram;
+extern SceGxmVertexProgram *_vita2d_spriteVertexProgram;
+extern SceGxmVertexProgram *_vita2d_shapeVertexProgram;
 extern const SceGxmProgramParameter *_vita2d_colorWvpParam;
+extern const SceGxmProgramParameter *_vita2d_colorCompactWvpParam;
 extern const SceGxmProgramParameter *_vita2d_textureWvpParam;
-extern SceGxmProgramParameter *_vita2d_textureTintColorParam;
+extern const SceGxmProgramParameter *_vita2d_textureTintWvpParam;
+extern const SceGxmProgramParameter *_vita2d_spriteWvpParam;
+extern const SceGxmProgramParameter *_vita2d_spriteInvTexSizeParam;
+extern const SceGxmProgramParameter *_vita2d_shapeWvpParam;
+extern const float *_vita2d_spriteQuadVertices;
+extern const uint16_t *_vita2d_spriteQuadIndices;
+
+typedef struct vita2d_shape_vertex {
+	float x;
+	float y;
+	float local_x;		// Position relative to the shape center
+	float local_y;
+	float half_w;
+	float half_h;
+	float radius;
+	float stroke;		// 0 for filled shapes
+	unsigned int color;
+} vita2d_shape_vertex;
+
+// vita2d_texture_tint_vertex with F32 texcoords, for quads that tile or wrap
+typedef struct vita2d_texture_tint_wide_vertex {
+	float x;
+	float y;
+	float u;
+	float v;
+	unsigned int color;
+} vita2d_texture_tint_wide_vertex;
+
+typedef struct vita2d_stencil_state {
+	SceGxmStencilFunc func;
+	SceGxmStencilOp stencilFail;
+	SceGxmStencilOp depthFail;
+	SceGxmStencilOp depthPass;
+	unsigned char compareMask;
+	unsigned char writeMask;
+} vita2d_stencil_state;
+
+// Shadow copy of the GXM state set through vita2d_state.c
+typedef struct vita2d_state {
+	const SceGxmVertexProgram *vertexProgram;
+	const SceGxmFragmentProgram *fragmentProgram;
+	SceGxmTexture texture;
+	int textureValid;
+	SceGxmPolygonMode frontPolygonMode;
+	int frontPolygonModeValid;
+	SceGxmPolygonMode backPolygonMode;
+	int backPolygonModeValid;
+	vita2d_stencil_state frontStencil;
+	int frontStencilValid;
+	SceGxmDepthFunc depthFunc;
+	SceGxmDepthWriteMode depthWrite;
+	int depthValid;
+	const SceGxmVertexProgram *wvpProgram;
+	float wvp[4 * 4];
+} vita2d_state;
+
+// Fragment programs of one blend mode
+typedef struct vita2d_fragment_programs {
+	SceGxmFragmentProgram *color;
+	SceGxmFragmentProgram *colorCompact;
+	SceGxmFragmentProgram *texture;
+	SceGxmFragmentProgram *textureTint;
+	SceGxmFragmentProgram *sprite;
+	SceGxmFragmentProgram *shape;
+} vita2d_fragment_programs;
+
+#define CLIP_STACK_DEPTH	16
+
+typedef struct vita2d_clip_state {
+	int enabled;
+	int x_min;
+	int y_min;
+	int x_max;
+	int y_max;
+} vita2d_clip_state;
+
+// Quads waiting in vita2d_batch.c
+typedef struct vita2d_batch {
+	const SceGxmVertexProgram *vertexProgram;
+	const SceGxmFragmentProgram *fragmentProgram;
+	const SceGxmProgramParameter *wvpParam;
+	const SceGxmTexture *texture;
+	void *vertices;
+	void *verticesEnd;
+	unsigned int stride;
+	unsigned int quadCount;
+} vita2d_batch;
+
+/*
+ * Counters behind vita2d_get_frame_stats(). Builds with VITA2D_SYS_NO_STATS
+ * drop them from the draw context and every VITA2D_STAT_ADD() with them.
+ */
+typedef struct vita2d_frame_counters {
+	unsigned int drawCalls;
+	unsigned int vertices;
+	unsigned int indices;
+	unsigned int programBinds;
+	unsigned int textureBinds;
+	unsigned int glyphMisses;
+	unsigned int textDraws;
+	unsigned int clipChanges;
+} vita2d_frame_counters;
+
+#ifndef VITA2D_SYS_NO_STATS
+#define VITA2D_STAT_ADD(ctx, counter, n)	((ctx)->counters.counter += (n))
+#else
+#define VITA2D_STAT_ADD(ctx, counter, n)	((void)0)
+#endif
+
+/*
+ * Everything a thread needs to build GXM commands. The default one draws into
+ * _vita2d_context and the frame pool, deferred contexts record into their own
+ * GXM deferred context and pool slice. Blend, clip and projection set through
+ * the public API apply to the context of the calling thread.
+ */
+typedef struct vita2d_draw_ctx {
+	SceGxmContext *context;
+	int deferred;
+	unsigned int sliceBase;		// Pool slice, sliceSize is 0 for the frame pool
+	unsigned int sliceSize;
+	unsigned int sliceIndex;
+	vita2d_state state;
+	vita2d_state_stats stateStats;
+	vita2d_batch batch;
+	unsigned int drawCallCount;
+#ifndef VITA2D_SYS_NO_STATS
+	vita2d_frame_counters counters;
+#endif
+	float *scratch;				// Polyline normals, see vita2d_polyline.c
+	unsigned int scratchSize;
+	const vita2d_fragment_programs *programs;	// Set of the current blend mode
+	vita2d_blend_mode blendMode;
+	vita2d_clip_state clip;
+	int clipStencilValid;
+	vita2d_clip_state clipStack[CLIP_STACK_DEPTH];
+	unsigned int clipStackDepth;
+	float ortho[4 * 4];
+} vita2d_draw_ctx;
+
+extern vita2d_draw_ctx _vita2d_default_ctx;
+
+/* vita2d.c */
+enum {
+	VITA2D_CLIP_OUTSIDE,
+	VITA2D_CLIP_INSIDE,
+	VITA2D_CLIP_PARTIAL
+};
+
+int _vita2d_clip_test(float x_min, float y_min, float x_max, float y_max);
+int _vita2d_visibility(float x_min, float y_min, float x_max, float y_max);
+void _vita2d_clip_require_stencil(void);
+void _vita2d_clip_restore(void);
+void _vita2d_ctx_reset(vita2d_draw_ctx *ctx);
+void _vita2d_frame_pacing_wait(void);
+#ifndef VITA2D_SYS_NO_STATS
+void _vita2d_stats_reset(vita2d_draw_ctx *ctx);
+void _vita2d_stats_merge(vita2d_draw_ctx *dst, const vita2d_draw_ctx *src);
+#else
+#define _vita2d_stats_reset(ctx)			((void)0)
+#define _vita2d_stats_merge(dst, src)		((void)0)
+#endif
+int _vita2d_clip_quad(float *x0, float *y0, float *x1, float *y1, float *u0, float *v0, float *u1, float *v1);
+
+/* vita2d_draw.c */
+int _vita2d_circle_init(void);
+void _vita2d_circle_fini(void);
+
+/* vita2d_polyline.c */
+void _vita2d_polyline_init(void);
+void _vita2d_polyline_release(vita2d_draw_ctx *ctx);
+
+/* vita2d_batch.c */
+int _vita2d_batch_init(void);
+void _vita2d_batch_fini(void);
+void _vita2d_batch_flush(void);
+void _vita2d_batch_flush_texture(const SceGxmTexture *texture);
+void _vita2d_batch_reset_stats(void);
+void *_vita2d_batch_alloc_quads(const SceGxmVertexProgram *vertexProgram, const SceGxmFragmentProgram *fragmentProgram,
+	const SceGxmProgramParameter *wvpParam, const SceGxmTexture *texture, unsigned int stride, unsigned int count);
+void _vita2d_draw(SceGxmPrimitiveType type, const void *indices, unsigned int count, unsigned int vertexCount);
+void _vita2d_draw_u32(SceGxmPrimitiveType type, const void *indices, unsigned int count, unsigned int vertexCount);
+void _vita2d_batch_draw_quads(const SceGxmVertexProgram *vertexProgram, const SceGxmFragmentProgram *fragmentProgram,
+	const SceGxmProgramParameter *wvpParam, const SceGxmTexture *texture, const void *vertices, unsigned int stride, unsigned int count,
+	const float *wvp);
+void _vita2d_draw_instanced(const void *indices, unsigned int count, unsigned int wrap, unsigned int vertexCount);
+
+/* vita2d_queue.c */
+void _vita2d_queue_fini(void);
+int _vita2d_queue_enabled(void);
+void _vita2d_queue_submit(void);
+void _vita2d_queue_scene_begin(void);
+void *_vita2d_queue_alloc_quads(const SceGxmVertexProgram *vertexProgram, const SceGxmFragmentProgram *fragmentProgram,
+	const SceGxmProgramParameter *wvpParam, const SceGxmTexture *texture, unsigned int stride, unsigned int count);
+
+/* vita2d_display_list.c */
+void _vita2d_display_list_fini(void);
+int _vita2d_display_list_recording(void);
+void *_vita2d_display_list_alloc_quads(const SceGxmVertexProgram *vertexProgram, const SceGxmFragmentProgram *fragmentProgram,
+	const SceGxmProgramParameter *wvpParam, const SceGxmTexture *texture, unsigned int stride, unsigned int count);
+
+/* vita2d_deferred.c */
+vita2d_draw_ctx *_vita2d_ctx(void);
+void _vita2d_deferred_fini(void);
+
+/* vita2d_pool.c */
+int _vita2d_pool_init(unsigned int size);
+void _vita2d_pool_fini(void);
+void _vita2d_pool_next_frame(void);
+const SceGxmNotification *_vita2d_pool_scene_notification(void);
+unsigned int _vita2d_pool_frame_serial(void);
+int _vita2d_pool_frame_done(unsigned int serial);
+
+/* vita2d_state.c */
+void _vita2d_state_invalidate(void);
+void _vita2d_state_reset_stats(void);
+void _vita2d_set_vertex_stream(unsigned int index, const void *data);
+void _vita2d_set_vertex_program(const SceGxmVertexProgram *program);
+void _vita2d_set_fragment_program(const SceGxmFragmentProgram *program);
+void _vita2d_set_fragment_texture(const SceGxmTexture *texture);
+void _vita2d_set_front_polygon_mode(SceGxmPolygonMode mode);
+void _vita2d_set_back_polygon_mode(SceGxmPolygonMode mode);
+void _vita2d_set_front_stencil_func(SceGxmStencilFunc func, SceGxmStencilOp stencilFail, SceGxmStencilOp depthFail,
+	SceGxmStencilOp depthPass, unsigned char compareMask, unsigned char writeMask);
+void _vita2d_set_depth_func(SceGxmDepthFunc func, SceGxmDepthWriteMode write);
+void _vita2d_set_wvp(const SceGxmProgramParameter *param, const float *matrix);
+void *_vita2d_reserve_vertex_uniforms(const SceGxmProgramParameter *wvpParam, const float *matrix);
 
 #endif
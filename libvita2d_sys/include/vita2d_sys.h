@@ -12,7 +12,7 @@
 extern "C" {
 #endif
 
-#define VITA2D_SYS_VERSION_INTERNAL 0146
+#define VITA2D_SYS_VERSION_INTERNAL 0174
 
 #ifndef VITA2D_SYS_VERSION
 #define VITA2D_SYS_VERSION VITA2D_SYS_VERSION_INTERNAL
@@ -33,6 +33,10 @@ extern "C" {
 #define VITA2D_SYS_ERROR_VERSION_MISMATCH		-1002
 #define VITA2D_SYS_ERROR_INVALID_ARGUMENT		-1003
 #define VITA2D_SYS_ERROR_INVALID_POINTER		-1004
+#define VITA2D_SYS_ERROR_STACK_OVERFLOW			-1005
+#define VITA2D_SYS_ERROR_STACK_UNDERFLOW		-1006
+#define VITA2D_SYS_ERROR_NO_MEMORY				-1007
+#define VITA2D_SYS_ERROR_INVALID_STATE			-1008
 
 typedef enum vita2d_io_type {
 	VITA2D_IO_TYPE_NORMAL,	//Use sceIo
@@ -44,8 +48,23 @@ typedef enum vita2d_mem_attrib {
 	VITA2D_MEM_ATTRIB_SHARED	//Use shared driver memory
 } vita2d_mem_attrib;
 
+typedef enum vita2d_line_join {
+	VITA2D_LINE_JOIN_MITER,	//Sharp corners, limited to 4 times the half width
+	VITA2D_LINE_JOIN_ROUND
+} vita2d_line_join;
+
+typedef enum vita2d_blend_mode {
+	VITA2D_BLEND_MODE_NORMAL,			//Alpha blending
+	VITA2D_BLEND_MODE_ADD,				//Additive
+	VITA2D_BLEND_MODE_MULTIPLY,			//Multiply, colors and textures must be premultiplied by alpha
+	VITA2D_BLEND_MODE_SCREEN,			//Screen, colors and textures must be premultiplied by alpha
+	VITA2D_BLEND_MODE_PREMULTIPLIED,	//Alpha blending for colors already multiplied by alpha
+	VITA2D_BLEND_MODE_OPAQUE,			//Blending disabled, alpha is ignored
+	VITA2D_BLEND_MODE_COUNT
+} vita2d_blend_mode;
+
 typedef struct vita2d_init_param {
-	unsigned int temp_pool_size;
+	unsigned int temp_pool_size;	//Split between two frames, see temp memory pool
 	unsigned int heap_size;
 	unsigned int param_buffer_size;
 	unsigned int vdm_ring_buffer_size;
@@ -57,6 +76,8 @@ typedef struct vita2d_init_param {
 	unsigned int fragment_usse_ring_buffer_size;
 	unsigned int fragment_usse_ring_buffer_attrib;
 	unsigned int msaa;
+	unsigned int display_buffer_count;	//[GAME MODE ONLY] 2 (default) or 3 for triple buffering
+	unsigned int present_thread;		//[SYSTEM MODE ONLY] 1 to begin/end the shared framebuffer and wait for vblank on a present thread
 } vita2d_init_param;
 
 typedef struct vita2d_init_param_external {
@@ -85,6 +106,34 @@ typedef struct vita2d_color_vertex {
 	unsigned int color;
 } vita2d_color_vertex;
 
+typedef struct vita2d_color_compact_vertex {
+	float x;
+	float y;
+	unsigned int color;
+} vita2d_color_compact_vertex;
+
+typedef struct vita2d_point {
+	float x;
+	float y;
+	unsigned int color;
+} vita2d_point;
+
+typedef struct vita2d_line {
+	float x0;
+	float y0;
+	float x1;
+	float y1;
+	unsigned int color;
+} vita2d_line;
+
+typedef struct vita2d_rectangle {
+	float x;
+	float y;
+	float w;
+	float h;
+	unsigned int color;
+} vita2d_rectangle;
+
 typedef struct vita2d_texture_vertex {
 	float x;
 	float y;
@@ -93,6 +142,29 @@ typedef struct vita2d_texture_vertex {
 	float v;
 } vita2d_texture_vertex;
 
+typedef struct vita2d_texture_tint_vertex {
+	float x;
+	float y;
+	unsigned short u;		//Normalized, 0xFFFF is 1.0
+	unsigned short v;
+	unsigned int color;
+} vita2d_texture_tint_vertex;
+
+typedef struct vita2d_sprite_instance {
+	float x;				//Position of the hotspot on screen
+	float y;
+	float x_scale;
+	float y_scale;
+	float rad;				//Rotation around the hotspot in radians
+	float center_x;			//Hotspot relative to the upper left corner of the sprite, before scaling
+	float center_y;
+	unsigned short tex_x;	//Source rectangle in texels
+	unsigned short tex_y;
+	unsigned short tex_w;
+	unsigned short tex_h;
+	unsigned int color;		//Tint color in RGBA8 format
+} vita2d_sprite_instance;
+
 typedef struct vita2d_texture {
 	SceGxmTexture gxm_tex;
 	SceGxmDeviceMemInfo *data_mem;
@@ -103,6 +175,56 @@ typedef struct vita2d_texture {
 	SceGxmDepthStencilSurface gxm_sfd;
 } vita2d_texture;
 
+typedef struct vita2d_pool_stats {
+	unsigned int used;				//Bytes used by the current frame, including overflow chunks
+	unsigned int high_water;		//Most bytes used by a single frame since init
+	unsigned int overflow_count;	//Frames that did not fit in their pool region since init
+	unsigned int chunk_count;		//Overflow chunks currently allocated
+	unsigned int chunk_size;		//Total size of overflow chunks in bytes
+} vita2d_pool_stats;
+
+typedef struct vita2d_cull_stats {
+	unsigned int drawn;		//Primitives that passed the culling test this frame
+	unsigned int culled;	//Primitives rejected before vertex generation this frame
+} vita2d_cull_stats;
+
+typedef struct vita2d_state_stats {
+	unsigned int issued;	//GXM state calls submitted to the context
+	unsigned int elided;	//GXM state calls skipped because the state was already bound
+} vita2d_state_stats;
+
+typedef struct vita2d_frame_stats {
+	unsigned int draw_calls;		//GXM draw calls, including executed deferred contexts
+	unsigned int vertices;			//Vertices referenced by draw calls
+	unsigned int indices;			//Indices submitted with draw calls
+	unsigned int program_binds;		//Vertex and fragment program changes submitted to GXM
+	unsigned int texture_binds;		//Texture changes submitted to GXM
+	unsigned int pool_used;			//Temp pool bytes used by the frame
+	unsigned int pool_high_water;	//Most temp pool bytes used by a single frame since init
+	unsigned int glyph_misses;		//Glyphs rendered into a font atlas because they were not cached yet
+	unsigned int text_draws;		//pgf and pvf text draws
+	unsigned int clip_changes;		//Clip rectangle and region clip changes submitted to GXM
+	unsigned int cpu_us;			//Rendering thread time from vita2d_start_drawing() to the end of vita2d_end_drawing() not spent in waits, in microseconds
+	unsigned int vblank_wait_us;	//Rendering thread time blocked on the display (vblank, free display buffer) since the previous frame, in microseconds
+} vita2d_frame_stats;
+
+#define VITA2D_FRAME_INTERVAL_BINS 5
+
+typedef struct vita2d_frame_interval_stats {
+	unsigned int bins[VITA2D_FRAME_INTERVAL_BINS];	//Frames shown 0 (no vsync or torn), 1, 2, 3 and 4 or more vblanks after the previous one
+	unsigned int late;		//Frames that missed their swap interval
+	unsigned int last_us;	//Last frame interval in microseconds
+	unsigned int max_us;	//Longest frame interval since the last reset in microseconds
+} vita2d_frame_interval_stats;
+
+typedef void (*vita2d_late_latch_callback)(void *user_data);
+
+typedef struct vita2d_display_queue_stats {
+	unsigned int buffer_count;	//Display buffers in use
+	unsigned int pending;		//Frames queued for display that are not on screen yet
+	unsigned int high_water;	//Most frames queued at once since init
+} vita2d_display_queue_stats;
+
 typedef struct vita2d_system_pgf_config {
 	int code;
 	int (*in_font_group)(unsigned int c);
@@ -117,6 +239,8 @@ typedef struct vita2d_system_pvf_config {
 
 typedef struct vita2d_pgf vita2d_pgf;
 typedef struct vita2d_pvf vita2d_pvf;
+typedef struct vita2d_display_list vita2d_display_list;
+typedef struct vita2d_deferred_context vita2d_deferred_context;
 
 /*----------------------------------- general functions -----------------------------------*/
 
@@ -187,11 +311,22 @@ PRX_INTERFACE SceUID vita2d_get_shfbid();
 
 /**
  * [SYSTEM MODE] Signal to the system that vita2d_sys has finished drawing to shared framebuffer. Must be called after rendering is done on each frame.
+ * With vita2d_init_param::present_thread the frame is handed to the present thread and the call returns right away.
  * [GAME MODE] Swap display buffers.
  *
  */
 PRX_INTERFACE void vita2d_end_shfb();
 
+/**
+ * Get display queue statistics. A high_water close to display_buffer_count - 1 means
+ * frames wait for the display, more buffers trade latency for throughput.
+ * In system mode pending counts frames handed to the present thread that are not ended yet, 0 without one.
+ *
+ * @param[out] stats - pointer to ::vita2d_display_queue_stats to fill
+ *
+ */
+PRX_INTERFACE void vita2d_get_display_queue_stats(vita2d_display_queue_stats *stats);
+
 /**
  * [GAME MODE ONLY] Set display/rendering resolution. Must not exceed maximum resolution that was set by vita2d_display_set_max_resolution()
  *
@@ -214,6 +349,7 @@ PRX_INTERFACE int vita2d_display_set_max_resolution(int hRes, int vRes);
 
 /**
  * [SYSTEM MODE] Start drawing and signal to the system that vita2d_sys has started drawing to shared framebuffer. Must be called on each new frame.
+ * With vita2d_init_param::present_thread only waits if the present thread has not ended the previous frame yet.
  * [GAME MODE] Start drawing. Must be called on each new frame.
  *
  */
@@ -270,12 +406,73 @@ PRX_INTERFACE unsigned int vita2d_get_clear_color();
 /**
  * [SYSTEM MODE] Switch vsync mode (30/60 FPS).
  * [GAME MODE] Enable/disable vsync.
+ * Same as ::vita2d_set_swap_interval with 1 or 0.
  *
  * @param[in] enable - 1 to enable, 0 to disable
  *
  */
 PRX_INTERFACE void vita2d_set_vblank_wait(int enable);
 
+/*-----------------------------------  frame pacing -----------------------------------*/
+
+/**
+ * Set number of vblanks each frame stays on screen. 1 (default) paces to 60 FPS, 2 to a steady 30 FPS, 3 to 20 FPS.
+ * 0 disables vsync. Frames are paced where they are shown: the display queue in game mode,
+ * ::vita2d_end_drawing or the present thread in system mode.
+ *
+ * @param[in] interval - 0 to 3
+ *
+ * @return SCE_OK, VITA2D_SYS_ERROR_INVALID_ARGUMENT if interval is above 3.
+ */
+PRX_INTERFACE int vita2d_set_swap_interval(unsigned int interval);
+
+/**
+ * Get swap interval.
+ *
+ * @return number of vblanks each frame stays on screen, 0 if vsync is disabled.
+ */
+PRX_INTERFACE unsigned int vita2d_get_swap_interval();
+
+/**
+ * Enable/disable adaptive vsync. A frame that missed its swap interval is shown right away and may tear,
+ * instead of waiting for the next vblank and dropping to the next lower rate.
+ *
+ * @param[in] enable - 1 to enable, 0 to disable
+ *
+ */
+PRX_INTERFACE void vita2d_set_adaptive_vsync(int enable);
+
+/**
+ * Get adaptive vsync status.
+ *
+ * @return 1 if adaptive vsync is enabled, 0 otherwise.
+ */
+PRX_INTERFACE int vita2d_get_adaptive_vsync();
+
+/**
+ * Set late-latch callback. It is called by ::vita2d_end_drawing on the rendering thread right before a display scene is submitted,
+ * so input can be sampled as late as possible. Scenes drawn into a texture don't call it. Drawing functions may be used from the callback.
+ *
+ * @param[in] callback - function to call, NULL to remove
+ * @param[in] user_data - passed to callback
+ *
+ */
+PRX_INTERFACE void vita2d_set_late_latch_callback(vita2d_late_latch_callback callback, void *user_data);
+
+/**
+ * Get histogram of measured intervals between shown frames. Safe to call from any thread.
+ *
+ * @param[out] stats - pointer to ::vita2d_frame_interval_stats to fill
+ *
+ */
+PRX_INTERFACE void vita2d_get_frame_interval_stats(vita2d_frame_interval_stats *stats);
+
+/**
+ * Reset frame interval histogram.
+ *
+ */
+PRX_INTERFACE void vita2d_reset_frame_interval_stats();
+
 /**
  * Get vita2d_sys GXM context.
  *
@@ -313,6 +510,11 @@ PRX_INTERFACE void vita2d_set_region_clip(SceGxmRegionClipMode mode, unsigned in
 
 /*-----------------------------------  region clipping (pixel-aligned) -----------------------------------*/
 
+/*
+ * Clipping state and the clip stack belong to the calling thread: the rendering thread has its own,
+ * a thread recording into a ::vita2d_deferred_context uses the one of that context.
+ */
+
 /**
  * Enable clipping, pixel-aligned implementation.
  *
@@ -334,6 +536,8 @@ PRX_INTERFACE int vita2d_get_clipping_enabled();
 
 /**
  * Set clipping region size for drawing, pixel-aligned implementation.
+ * Uses the region clip for whole tiles and clips axis-aligned quads on the CPU, the stencil buffer
+ * is only written when rotated or arbitrary geometry is drawn. Overrides ::vita2d_set_region_clip while enabled.
  *
  * @param[in] x_min - minimum x value of clipping region in pixels
  * @param[in] y_min - minimum y value of clipping region in pixels
@@ -355,15 +559,93 @@ PRX_INTERFACE void vita2d_set_clip_rectangle(int x_min, int y_min, int x_max, in
 PRX_INTERFACE void vita2d_get_clip_rectangle(int *x_min, int *y_min, int *x_max, int *y_max);
 
 /**
- * Enable/disable additive blend mode.
+ * Push a clipping rectangle, pixel-aligned implementation.
+ * The rectangle is intersected with the current one if clipping is enabled, and clipping is enabled.
+ * GPU state is only changed when the resulting rectangle differs from the current one.
+ *
+ * @param[in] x_min - minimum x value of clipping region in pixels
+ * @param[in] y_min - minimum y value of clipping region in pixels
+ * @param[in] x_max - maximum x value of clipping region in pixels
+ * @param[in] y_max - maximum y value of clipping region in pixels
+ *
+ * @return SCE_OK, VITA2D_SYS_ERROR_STACK_OVERFLOW if more than 16 rectangles are pushed.
+ */
+PRX_INTERFACE int vita2d_push_clip(int x_min, int y_min, int x_max, int y_max);
+
+/**
+ * Restore clipping state saved by the matching ::vita2d_push_clip.
+ *
+ * @return SCE_OK, VITA2D_SYS_ERROR_STACK_UNDERFLOW if the stack is empty.
+ */
+PRX_INTERFACE int vita2d_pop_clip();
+
+/*-----------------------------------  culling -----------------------------------*/
+
+/**
+ * Enable/disable culling of primitives outside the render target or the clipping rectangle.
+ * Rectangles, circles, lines, pixels, textures, sprites and text are tested by their bounding box
+ * before any pool memory is allocated. Vertex arrays (::vita2d_draw_array, ::vita2d_draw_array_textured) are not tested.
+ * ::vita2d_draw_pixels, ::vita2d_draw_lines and ::vita2d_draw_rectangles test each element on its own and skip the ones outside.
+ *
+ * @param[in] enable - 1 to enable, 0 to disable
+ *
+ */
+PRX_INTERFACE void vita2d_set_culling(int enable);
+
+/**
+ * Get culling status.
+ *
+ * @return 1 if culling is enabled, 0 otherwise.
+ */
+PRX_INTERFACE int vita2d_get_culling_enabled();
+
+/**
+ * Get culling statistics since the last vita2d_start_drawing().
+ *
+ * @param[out] stats - pointer to ::vita2d_cull_stats to fill
+ *
+ */
+PRX_INTERFACE void vita2d_get_cull_stats(vita2d_cull_stats *stats);
+
+/**
+ * Enable/disable additive blend mode. Same as ::vita2d_set_blend_mode with ::VITA2D_BLEND_MODE_ADD
+ * or ::VITA2D_BLEND_MODE_NORMAL.
  *
  * @param[in] enable - 1 to enable, 0 to disable
  *
  */
 PRX_INTERFACE void vita2d_set_blend_mode_add(int enable);
 
+/**
+ * Set blend mode for following draws of the calling thread. Fragment programs for a mode are created the first time it is set,
+ * on the rendering thread.
+ *
+ * ::VITA2D_BLEND_MODE_MULTIPLY and ::VITA2D_BLEND_MODE_SCREEN blend premultiplied colors, like ::VITA2D_BLEND_MODE_PREMULTIPLIED:
+ * draw colors and texels must already be multiplied by their alpha, straight alpha input blends too strongly where it is translucent.
+ *
+ * @param[in] mode - one of ::vita2d_blend_mode
+ *
+ * @return SCE_OK, VITA2D_SYS_ERROR_INVALID_ARGUMENT for unknown modes, VITA2D_SYS_ERROR_INVALID_STATE if the mode
+ * was never set on the rendering thread and the calling thread records a deferred context, <0 if fragment programs could not be created.
+ */
+PRX_INTERFACE int vita2d_set_blend_mode(vita2d_blend_mode mode);
+
+/**
+ * Get current blend mode.
+ *
+ * @return one of ::vita2d_blend_mode.
+ */
+PRX_INTERFACE vita2d_blend_mode vita2d_get_blend_mode();
+
 /*-----------------------------------  temp memory pool -----------------------------------*/
 
+/*
+ * The temp pool is split in two halves used by alternate frames, so a frame gets half of temp_pool_size:
+ * double it to keep the per-frame capacity of a single buffered pool. The GPU signals the end of each half
+ * through the last two entries of the GXM notification region (SCE_GXM_NOTIFICATION_COUNT - 2 and
+ * SCE_GXM_NOTIFICATION_COUNT - 1), applications must not use them.
+ */
+
 /**
  * Allocate memory block from vita2d_sys temp memory pool.
  *
@@ -384,18 +666,212 @@ PRX_INTERFACE void *vita2d_pool_malloc(unsigned int size);
 PRX_INTERFACE void *vita2d_pool_memalign(unsigned int size, unsigned int alignment);
 
 /**
- * Get size of free vita2d_sys temp memory pool.
+ * Get size of free vita2d_sys temp memory pool for the current frame.
+ * The pool is split between two frames so the CPU can fill one while the GPU reads the other.
  *
  * @return free temp memory pool size in bytes.
  */
 PRX_INTERFACE unsigned int vita2d_pool_free_space();
 
 /**
- * Reset vita2d_sys temp memory pool. All previous allocations will be invalidated.
+ * Reset vita2d_sys temp memory pool of the current frame. All previous allocations of the frame will be invalidated.
+ * vita2d_start_drawing() moves to the next frame on its own, waiting for the GPU if it still uses that frame.
  *
  */
 PRX_INTERFACE void vita2d_pool_reset();
 
+/**
+ * Get vita2d_sys temp memory pool usage statistics.
+ * When a frame does not fit in its part of the pool, allocations continue in GPU mapped overflow chunks that are kept until vita2d_fini().
+ * high_water can be used to size temp_pool_size.
+ *
+ * @param[out] stats - pointer to ::vita2d_pool_stats to fill
+ *
+ */
+PRX_INTERFACE void vita2d_get_pool_stats(vita2d_pool_stats *stats);
+
+/*-----------------------------------  draw batching -----------------------------------*/
+
+/**
+ * Submit all pending batched draws. Consecutive texture and rectangle draws that share the same state are merged into one draw call;
+ * pending draws are submitted automatically on state change and in vita2d_end_drawing(). Call this before issuing GXM commands directly.
+ *
+ */
+PRX_INTERFACE void vita2d_batch_flush();
+
+/**
+ * Get number of GXM draw calls issued since last vita2d_start_drawing() call.
+ *
+ * @return number of draw calls.
+ */
+PRX_INTERFACE unsigned int vita2d_get_draw_call_count();
+
+/**
+ * Get number of GXM state calls (programs, texture, WVP uniform, polygon mode, stencil function) issued and elided by state filtering since last vita2d_start_drawing() call.
+ *
+ * @param[out] stats - pointer to ::vita2d_state_stats structure
+ *
+ */
+PRX_INTERFACE void vita2d_get_state_stats(vita2d_state_stats *stats);
+
+/**
+ * Get counters of the last frame, collected from vita2d_start_drawing() and taken by vita2d_end_drawing() of the display scene.
+ * Scenes drawn into a texture count for the frame they are drawn in.
+ * Libraries built with VITA2D_SYS_NO_STATS do not collect them and return all zeros.
+ *
+ * @param[out] stats - pointer to ::vita2d_frame_stats to fill
+ *
+ */
+PRX_INTERFACE void vita2d_get_frame_stats(vita2d_frame_stats *stats);
+
+/*-----------------------------------  deferred drawing -----------------------------------*/
+
+/**
+ * Enable/disable deferred drawing. While enabled, rectangles, textures and text are queued and
+ * reordered to batch by texture, then drawn at the next flush point (any other draw, clipping change,
+ * ::vita2d_batch_flush, ::vita2d_end_drawing). Quads are only moved past earlier quads they do not overlap,
+ * so the result looks the same as immediate drawing within a layer.
+ *
+ * @param[in] enable - 1 to enable, 0 to disable and draw the queue
+ *
+ * @return SCE_OK, VITA2D_SYS_ERROR_NO_MEMORY if the queue could not be allocated.
+ */
+PRX_INTERFACE int vita2d_set_deferred_mode(int enable);
+
+/**
+ * Get deferred drawing status.
+ *
+ * @return 1 if deferred drawing is enabled, 0 otherwise.
+ */
+PRX_INTERFACE int vita2d_get_deferred_mode();
+
+/**
+ * Set layer for following deferred draws. Lower layers are drawn first at the next flush point,
+ * draws in the same layer keep their order where they overlap.
+ *
+ * @param[in] layer - layer index
+ *
+ */
+PRX_INTERFACE void vita2d_set_draw_layer(int layer);
+
+/**
+ * Get layer used for deferred draws.
+ *
+ * @return current layer index.
+ */
+PRX_INTERFACE int vita2d_get_draw_layer();
+
+/**
+ * Enable/disable depth sorting of deferred draws, takes effect at the next ::vita2d_start_drawing.
+ * Every layer gets its own depth, quads drawn with ::VITA2D_BLEND_MODE_OPAQUE are submitted front to back
+ * with depth write first and the rest back to front with depth test, so covered parts of lower layers
+ * are not shaded. Has no effect on immediate draws, which are drawn without depth test while enabled.
+ *
+ * @param[in] enable - 1 to enable, 0 to disable
+ */
+PRX_INTERFACE void vita2d_set_depth_sorting(int enable);
+
+/**
+ * Get depth sorting status.
+ *
+ * @return 1 if depth sorting is enabled, 0 otherwise.
+ */
+PRX_INTERFACE int vita2d_get_depth_sorting();
+
+/*-----------------------------------  display lists -----------------------------------*/
+
+/**
+ * Start recording a display list. Rectangles, textures and text drawn until ::vita2d_display_list_end
+ * are recorded instead of drawn, any other draw is executed immediately and not recorded.
+ * Clipping, culling and blend mode are applied as they are while recording.
+ *
+ * @return SCE_OK, VITA2D_SYS_ERROR_INVALID_STATE if a display list is already being recorded.
+ */
+PRX_INTERFACE int vita2d_display_list_begin();
+
+/**
+ * Stop recording and copy recorded vertices to GPU memory. Textures used by the list must stay alive as long as the list.
+ *
+ * @return pointer to ::vita2d_display_list, NULL if nothing was recorded or on error.
+ */
+PRX_INTERFACE vita2d_display_list *vita2d_display_list_end();
+
+/**
+ * Draw display list. The list is not copied, so this only costs a few GXM calls per texture change.
+ *
+ * @param[in] list - pointer to ::vita2d_display_list
+ * @param[in] x - x offset added to all recorded positions
+ * @param[in] y - y offset added to all recorded positions
+ *
+ */
+PRX_INTERFACE void vita2d_display_list_draw(const vita2d_display_list *list, float x, float y);
+
+/**
+ * Free display list. GPU must be done with all scenes that draw the list, see ::vita2d_wait_rendering_done.
+ *
+ * @param[in] list - pointer to ::vita2d_display_list to free
+ *
+ */
+PRX_INTERFACE void vita2d_free_display_list(vita2d_display_list *list);
+
+/*----------------------------------- deferred contexts -----------------------------------*/
+
+/**
+ * Create deferred context. Worker threads record GXM command lists into deferred contexts with the regular
+ * drawing functions, the rendering thread then executes them inside its scene. Must be called from the rendering thread,
+ * up to 8 contexts can exist at once.
+ *
+ * @param[in] pool_size - size of the context temp memory in bytes, 0 for default (256 KiB). Each recording can use half of it.
+ *
+ * @return pointer to ::vita2d_deferred_context, NULL on error.
+ */
+PRX_INTERFACE vita2d_deferred_context *vita2d_create_deferred_context(unsigned int pool_size);
+
+/**
+ * Free deferred context. Must be called from the rendering thread while the context is not recording,
+ * waits for the GPU if it may still execute the context command list.
+ *
+ * @param[in] context - pointer to ::vita2d_deferred_context to free
+ *
+ * @return SCE_OK, <0 on error.
+ */
+PRX_INTERFACE int vita2d_free_deferred_context(vita2d_deferred_context *context);
+
+/**
+ * Begin recording into deferred context on the calling thread. Until ::vita2d_deferred_context_end,
+ * drawing functions called on this thread are recorded into the context instead of the current scene.
+ * Each recording starts with normal blending, clipping disabled and an empty clip stack, blend and clip changes made
+ * while recording only apply to the recording thread. Blend modes other than normal must have been selected once on
+ * the rendering thread before. Recorded draws do not go through deferred drawing or display lists.
+ * Fails with VITA2D_SYS_ERROR_INVALID_STATE if the GPU may still read memory of the recording before the previous one,
+ * record a context at most once per frame.
+ *
+ * @param[in] context - pointer to ::vita2d_deferred_context
+ *
+ * @return SCE_OK, <0 on error.
+ */
+PRX_INTERFACE int vita2d_deferred_context_begin(vita2d_deferred_context *context);
+
+/**
+ * End recording into deferred context. Must be called on the thread that began the recording.
+ *
+ * @param[in] context - pointer to ::vita2d_deferred_context
+ *
+ * @return SCE_OK, <0 on error.
+ */
+PRX_INTERFACE int vita2d_deferred_context_end(vita2d_deferred_context *context);
+
+/**
+ * Execute last recorded command list of deferred context in the current scene. Must be called from the rendering thread
+ * between ::vita2d_start_drawing and ::vita2d_end_drawing. Lists are drawn in the order they are executed,
+ * after everything drawn before on the rendering thread.
+ *
+ * @param[in] context - pointer to ::vita2d_deferred_context
+ *
+ * @return SCE_OK, <0 on error.
+ */
+PRX_INTERFACE int vita2d_deferred_context_execute(vita2d_deferred_context *context);
+
 /*----------------------------------- general drawing functions -----------------------------------*/
 
 /**
@@ -433,7 +909,49 @@ PRX_INTERFACE void vita2d_draw_line(float x0, float y0, float x1, float y1, unsi
 PRX_INTERFACE void vita2d_draw_rectangle(float x, float y, float w, float h, unsigned int color);
 
 /**
- * Draw colored circle.
+ * Draw array of colored pixels with a single draw call.
+ *
+ * @param[in] points - pointer to ::vita2d_point array
+ * @param[in] count - number of points
+ *
+ */
+PRX_INTERFACE void vita2d_draw_pixels(const vita2d_point *points, unsigned int count);
+
+/**
+ * Draw array of colored lines with a single draw call.
+ *
+ * @param[in] lines - pointer to ::vita2d_line array
+ * @param[in] count - number of lines
+ *
+ */
+PRX_INTERFACE void vita2d_draw_lines(const vita2d_line *lines, unsigned int count);
+
+/**
+ * Draw thick anti-aliased polyline, ends are cut square at the first and last point.
+ * The whole polyline is one draw call, polylines needing more than 65536 vertices use 32 bit indices.
+ * Translucent colors blend once per pixel, except where the line itself overlaps (turns past the miter limit, segments shorter than the line is wide).
+ *
+ * @param[in] points - pointer to x, y pairs
+ * @param[in] count - number of points
+ * @param[in] thickness - line thickness in pixel equivalent
+ * @param[in] join - one of ::vita2d_line_join
+ * @param[in] color - color of the line in RGBA8 format
+ *
+ */
+PRX_INTERFACE void vita2d_draw_polyline(const float *points, unsigned int count, float thickness, vita2d_line_join join, unsigned int color);
+
+/**
+ * Draw array of colored rectangles. Rectangles are batched, so the array is drawn with a single draw call
+ * unless it is larger than the batch.
+ *
+ * @param[in] rectangles - pointer to ::vita2d_rectangle array
+ * @param[in] count - number of rectangles
+ *
+ */
+PRX_INTERFACE void vita2d_draw_rectangles(const vita2d_rectangle *rectangles, unsigned int count);
+
+/**
+ * Draw colored circle. Segment count is chosen from the radius.
  *
  * @param[in] x - x position of center of the circle in pixel equivalent
  * @param[in] y - y position of center of the circle in pixel equivalent
@@ -443,6 +961,117 @@ PRX_INTERFACE void vita2d_draw_rectangle(float x, float y, float w, float h, uns
  */
 PRX_INTERFACE void vita2d_draw_fill_circle(float x, float y, float radius, unsigned int color);
 
+/**
+ * Draw colored circle outline.
+ *
+ * @param[in] x - x position of center of the circle in pixel equivalent
+ * @param[in] y - y position of center of the circle in pixel equivalent
+ * @param[in] radius - radius of the circle in pixel equivalent
+ * @param[in] color - color of the outline in RGBA8 format
+ *
+ */
+PRX_INTERFACE void vita2d_draw_circle(float x, float y, float radius, unsigned int color);
+
+/**
+ * Draw colored axis-aligned ellipse.
+ *
+ * @param[in] x - x position of center of the ellipse in pixel equivalent
+ * @param[in] y - y position of center of the ellipse in pixel equivalent
+ * @param[in] rx - horizontal radius in pixel equivalent
+ * @param[in] ry - vertical radius in pixel equivalent
+ * @param[in] color - color of the ellipse in RGBA8 format
+ *
+ */
+PRX_INTERFACE void vita2d_draw_fill_ellipse(float x, float y, float rx, float ry, unsigned int color);
+
+/**
+ * Draw colored axis-aligned ellipse outline.
+ *
+ * @param[in] x - x position of center of the ellipse in pixel equivalent
+ * @param[in] y - y position of center of the ellipse in pixel equivalent
+ * @param[in] rx - horizontal radius in pixel equivalent
+ * @param[in] ry - vertical radius in pixel equivalent
+ * @param[in] color - color of the outline in RGBA8 format
+ *
+ */
+PRX_INTERFACE void vita2d_draw_ellipse(float x, float y, float rx, float ry, unsigned int color);
+
+/**
+ * Draw colored circular arc outline. Angles are in radians, clockwise from the positive x axis.
+ *
+ * @param[in] x - x position of center of the arc in pixel equivalent
+ * @param[in] y - y position of center of the arc in pixel equivalent
+ * @param[in] radius - radius of the arc in pixel equivalent
+ * @param[in] start_rad - start angle
+ * @param[in] end_rad - end angle
+ * @param[in] color - color of the arc in RGBA8 format
+ *
+ */
+PRX_INTERFACE void vita2d_draw_arc(float x, float y, float radius, float start_rad, float end_rad, unsigned int color);
+
+/**
+ * Draw colored circle sector. Angles are in radians, clockwise from the positive x axis.
+ *
+ * @param[in] x - x position of center of the sector in pixel equivalent
+ * @param[in] y - y position of center of the sector in pixel equivalent
+ * @param[in] radius - radius of the sector in pixel equivalent
+ * @param[in] start_rad - start angle
+ * @param[in] end_rad - end angle
+ * @param[in] color - color of the sector in RGBA8 format
+ *
+ */
+PRX_INTERFACE void vita2d_draw_fill_arc(float x, float y, float radius, float start_rad, float end_rad, unsigned int color);
+
+/**
+ * Draw anti-aliased rectangle with rounded corners. Shapes are batched together like rectangles.
+ *
+ * @param[in] x - x position of the top left corner in pixel equivalent
+ * @param[in] y - y position of the top left corner in pixel equivalent
+ * @param[in] w - width of the rectangle in pixel equivalent
+ * @param[in] h - height of the rectangle in pixel equivalent
+ * @param[in] radius - corner radius in pixel equivalent, half of the shorter side gives a pill
+ * @param[in] color - color of the rectangle in RGBA8 format
+ *
+ */
+PRX_INTERFACE void vita2d_draw_fill_rounded_rectangle(float x, float y, float w, float h, float radius, unsigned int color);
+
+/**
+ * Draw anti-aliased outline of a rectangle with rounded corners. The outline lies inside the rectangle.
+ *
+ * @param[in] x - x position of the top left corner in pixel equivalent
+ * @param[in] y - y position of the top left corner in pixel equivalent
+ * @param[in] w - width of the rectangle in pixel equivalent
+ * @param[in] h - height of the rectangle in pixel equivalent
+ * @param[in] radius - corner radius in pixel equivalent
+ * @param[in] thickness - outline thickness in pixel equivalent
+ * @param[in] color - color of the outline in RGBA8 format
+ *
+ */
+PRX_INTERFACE void vita2d_draw_rounded_rectangle(float x, float y, float w, float h, float radius, float thickness, unsigned int color);
+
+/**
+ * Draw anti-aliased circle as a single batched quad.
+ *
+ * @param[in] x - x position of center of the circle in pixel equivalent
+ * @param[in] y - y position of center of the circle in pixel equivalent
+ * @param[in] radius - radius of the circle in pixel equivalent
+ * @param[in] color - color of the circle in RGBA8 format
+ *
+ */
+PRX_INTERFACE void vita2d_draw_smooth_circle(float x, float y, float radius, unsigned int color);
+
+/**
+ * Draw anti-aliased ring. The ring lies inside the radius.
+ *
+ * @param[in] x - x position of center of the ring in pixel equivalent
+ * @param[in] y - y position of center of the ring in pixel equivalent
+ * @param[in] radius - outer radius of the ring in pixel equivalent
+ * @param[in] thickness - ring thickness in pixel equivalent
+ * @param[in] color - color of the ring in RGBA8 format
+ *
+ */
+PRX_INTERFACE void vita2d_draw_ring(float x, float y, float radius, float thickness, unsigned int color);
+
 /**
  * Draw colored polygon.
  *
@@ -470,6 +1099,23 @@ PRX_INTERFACE void vita2d_texture_set_heap_type(SceGxmDeviceHeapId type);
  */
 PRX_INTERFACE SceGxmDeviceHeapId vita2d_texture_get_heap_type();
 
+/**
+ * Enable/disable premultiplied alpha for loaded textures. While enabled, color channels of PNG and 32 bpp BMP
+ * images are multiplied by alpha at load time, draw them with ::VITA2D_BLEND_MODE_PREMULTIPLIED, ::VITA2D_BLEND_MODE_MULTIPLY
+ * or ::VITA2D_BLEND_MODE_SCREEN.
+ * JPEG and other bitmaps load opaque and empty textures load transparent black, both already premultiplied.
+ *
+ * @param[in] enable - 1 to enable, 0 to disable
+ */
+PRX_INTERFACE void vita2d_texture_set_premultiplied_alpha(int enable);
+
+/**
+ * Get premultiplied alpha status for loaded textures.
+ *
+ * @return 1 if loaded textures are premultiplied, 0 otherwise.
+ */
+PRX_INTERFACE int vita2d_texture_get_premultiplied_alpha();
+
 /**
  * Create empty texture with SCE_GXM_TEXTURE_FORMAT_A8B8G8R8 format.
  *
@@ -857,6 +1503,17 @@ PRX_INTERFACE void vita2d_draw_texture_part_tint_scale_rotate(const vita2d_textu
  */
 PRX_INTERFACE void vita2d_draw_array_textured(const vita2d_texture *texture, SceGxmPrimitiveType mode, const vita2d_texture_vertex *vertices, size_t count, unsigned int color);
 
+/**
+ * Draw many sprites from the same texture with a single instanced draw.
+ * Each sprite is expanded to a quad by the vertex shader, so only one ::vita2d_sprite_instance per sprite is uploaded.
+ *
+ * @param[in] texture - pointer to ::vita2d_texture to use
+ * @param[in] sprites - pointer to the array of ::vita2d_sprite_instance, copied to the temp pool
+ * @param[in] count - number of sprites
+ *
+ */
+PRX_INTERFACE void vita2d_draw_sprites(const vita2d_texture *texture, const vita2d_sprite_instance *sprites, unsigned int count);
+
 /*----------------------------------- PNG functions -----------------------------------*/
 
 /**
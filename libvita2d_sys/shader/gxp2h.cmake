@@ -0,0 +1,37 @@
+# Converts a compiled GXP binary into a C header in the format of
+# include/shader/compiled/*_gxp.h.
+#
+# Usage: cmake -DNAME=<name> -DIN=<file.gxp> -DOUT=<file_gxp.h> -P gxp2h.cmake
+
+file(READ "${IN}" data HEX)
+string(LENGTH "${data}" length)
+math(EXPR size "${length} / 2")
+
+string(TOUPPER "${data}" data)
+string(REGEX REPLACE "([0-9A-F][0-9A-F])" "0x\\1, " data "${data}")
+# CMake regular expressions have no {n} quantifier
+string(REPEAT "0x[0-9A-F][0-9A-F], " 12 line)
+string(REGEX REPLACE "(${line})" "\\1\n\t" data "${data}")
+string(REPLACE ", \n\t" ",\n\t" data "${data}")
+string(REGEX REPLACE "[, \n\t]+$" "" data "${data}")
+
+string(TOUPPER "${NAME}_GXP_H" guard)
+
+file(WRITE "${OUT}"
+"#ifndef ${guard}
+#define ${guard}
+
+#ifdef __cplusplus
+extern \"C\" {
+#endif
+
+static const unsigned char ${NAME}_gxp[${size}] = {
+	${data}
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+")
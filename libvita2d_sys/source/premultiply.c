@@ -0,0 +1,47 @@
+#include <arm_neon.h>
+
+#include "premultiply.h"
+
+static inline unsigned int div255(unsigned int x)
+{
+	// Exact rounded x / 255 for x <= 255 * 255
+	x += 128;
+	return (x + (x >> 8)) >> 8;
+}
+
+static inline uint8x8_t div255_n(uint16x8_t x)
+{
+	// Same rounding as div255(): (x + 128 + ((x + 128) >> 8)) >> 8
+	return vrshrn_n_u16(vrsraq_n_u16(x, x, 8), 8);
+}
+
+void premultiply_alpha_ref(void *pixels, unsigned int count)
+{
+	// Alpha itself is kept
+	unsigned char *p = pixels;
+	unsigned int i;
+
+	for (i = 0; i < count; i++, p += 4) {
+		p[0] = div255(p[0] * p[3]);
+		p[1] = div255(p[1] * p[3]);
+		p[2] = div255(p[2] * p[3]);
+	}
+}
+
+void premultiply_alpha(void *pixels, unsigned int count)
+{
+	unsigned char *p = pixels;
+	unsigned int i;
+
+	for (i = 0; i + 8 <= count; i += 8, p += 8 * 4) {
+		uint8x8x4_t v = vld4_u8(p);
+
+		v.val[0] = div255_n(vmull_u8(v.val[0], v.val[3]));
+		v.val[1] = div255_n(vmull_u8(v.val[1], v.val[3]));
+		v.val[2] = div255_n(vmull_u8(v.val[2], v.val[3]));
+
+		vst4_u8(p, v);
+	}
+
+	premultiply_alpha_ref(p, count - i);
+}
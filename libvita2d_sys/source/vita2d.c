@@ -12,23 +12,33 @@
 #include "utils.h"
 #include "heap.h"
 #include "pvr.h"
+#include "present.h"
+#include "shared.h"
 
 /* Shader binaries */
 
 #include "shader/compiled/clear_v_gxp.h"
 #include "shader/compiled/clear_f_gxp.h"
 #include "shader/compiled/color_v_gxp.h"
+#include "shader/compiled/color_compact_v_gxp.h"
 #include "shader/compiled/color_f_gxp.h"
 #include "shader/compiled/texture_v_gxp.h"
 #include "shader/compiled/texture_f_gxp.h"
+#include "shader/compiled/texture_tint_v_gxp.h"
 #include "shader/compiled/texture_tint_f_gxp.h"
+#include "shader/compiled/sprite_v_gxp.h"
+#include "shader/compiled/shape_v_gxp.h"
+#include "shader/compiled/shape_f_gxp.h"
 
 /* Defines */
 
 #define DEFAULT_HEAP_SIZE			1 * 1024 * 1024;
 #define DISPLAY_COLOR_FORMAT		SCE_GXM_COLOR_FORMAT_A8B8G8R8
 #define DISPLAY_PIXEL_FORMAT		SCE_DISPLAY_PIXELFORMAT_A8B8G8R8
-#define DISPLAY_BUFFER_COUNT		2
+#define DISPLAY_MAX_BUFFER_COUNT	3
+#define DISPLAY_DEFAULT_BUFFER_COUNT	2
+#define DISPLAY_MAX_PENDING_SWAPS	2
+#define SWAP_INTERVAL_MAX			3
 #define DEFAULT_TEMP_POOL_SIZE		(1 * 1024 * 1024)
 
 typedef struct vita2d_display_data {
@@ -47,9 +57,14 @@ static const SceGxmProgram *const clearVertexProgramGxp = (const SceGxmProgram*)
 static const SceGxmProgram *const clearFragmentProgramGxp = (const SceGxmProgram*)clear_f_gxp;
 static const SceGxmProgram *const colorVertexProgramGxp = (const SceGxmProgram*)color_v_gxp;
 static const SceGxmProgram *const colorFragmentProgramGxp = (const SceGxmProgram*)color_f_gxp;
+static const SceGxmProgram *const colorCompactVertexProgramGxp = (const SceGxmProgram*)color_compact_v_gxp;
 static const SceGxmProgram *const textureVertexProgramGxp = (const SceGxmProgram*)texture_v_gxp;
 static const SceGxmProgram *const textureFragmentProgramGxp = (const SceGxmProgram*)texture_f_gxp;
+static const SceGxmProgram *const textureTintVertexProgramGxp = (const SceGxmProgram*)texture_tint_v_gxp;
 static const SceGxmProgram *const textureTintFragmentProgramGxp = (const SceGxmProgram*)texture_tint_f_gxp;
+static const SceGxmProgram *const spriteVertexProgramGxp = (const SceGxmProgram*)sprite_v_gxp;
+static const SceGxmProgram *const shapeVertexProgramGxp = (const SceGxmProgram*)shape_v_gxp;
+static const SceGxmProgram *const shapeFragmentProgramGxp = (const SceGxmProgram*)shape_f_gxp;
 
 static int display_hres = 960;
 static int display_vres = 544;
@@ -61,13 +76,17 @@ static int max_display_stride = 960;
 static int vita2d_initialized = 0;
 static float clear_color[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
 static unsigned int clear_color_u = 0xFF000000;
-static int clip_rect_x_min = 0;
-static int clip_rect_y_min = 0;
-static int clip_rect_x_max = 960;
-static int clip_rect_y_max = 544;
-static int vblank_wait = 1;
+static unsigned int swap_interval = 1;
+static int adaptive_vsync = 0;
+static vita2d_late_latch_callback late_latch_callback = NULL;
+static void *late_latch_user_data = NULL;
 static int drawing = 0;
-static int clipping_enabled = 0;
+static int display_scene = 0;	// Scene begun with target == NULL, only these are paced and shown
+
+static int culling_enabled = 0;
+static float viewport_w = 960.0f;
+static float viewport_h = 544.0f;
+static vita2d_cull_stats cull_stats;
 
 static vita2d_init_param init_param_s;
 static SceUID renderTargetMemUid;
@@ -77,20 +96,53 @@ static vita2d_shared_mem_info *fragmentRingBufferMem;
 static vita2d_shared_mem_info *fragmentUsseRingBufferMem;
 
 static SceUID shfb_id;
+static int shfb_acquired = 0;	// Frame begun by the present thread was picked up
 
 static SceGxmValidRegion validRegion;
 static SceGxmMultisampleMode msaa_s;
 static SceGxmContextParams contextParams;
 static SceGxmRenderTarget *renderTarget = NULL;
-static void *displayBufferData[DISPLAY_BUFFER_COUNT];
-static SceGxmColorSurface displaySurface[DISPLAY_BUFFER_COUNT];
-static SceGxmSyncObject *displayBufferSync[DISPLAY_BUFFER_COUNT];
+static void *displayBufferData[DISPLAY_MAX_BUFFER_COUNT];
+static SceGxmColorSurface displaySurface[DISPLAY_MAX_BUFFER_COUNT];
+static SceGxmSyncObject *displayBufferSync[DISPLAY_MAX_BUFFER_COUNT];
 
-static SceGxmDeviceMemInfo *displayBufferMem[DISPLAY_BUFFER_COUNT];
-static void *displayBufferData[DISPLAY_BUFFER_COUNT];
+static SceGxmDeviceMemInfo *displayBufferMem[DISPLAY_MAX_BUFFER_COUNT];
 
+static unsigned int displayBufferCount = DISPLAY_DEFAULT_BUFFER_COUNT;
 static int bufferIndex = 1;
 
+// Swaps queued by vita2d_end_shfb() and shown by display_callback(), each written by one thread only
+static unsigned int displayQueueSubmitted = 0;
+static volatile unsigned int displayQueueShown = 0;
+static unsigned int displayQueueHighWater = 0;
+
+/*
+ * Frame pacing, updated by the thread showing frames (display queue, present
+ * or rendering thread). Other threads copy the stats between two equal even
+ * values of pacing_seq, a reset is requested and done by the writer.
+ */
+static unsigned int pacing_vcount = 0;
+static SceUInt64 pacing_time = 0;
+static vita2d_frame_interval_stats frame_interval_stats;
+static volatile unsigned int pacing_seq = 0;
+static volatile int pacing_reset = 0;
+
+#ifndef VITA2D_SYS_NO_STATS
+// Frame statistics, taken by vita2d_end_drawing() on the rendering thread
+static vita2d_frame_stats frame_stats;
+static SceUInt64 stats_frame_start = 0;
+static SceUInt64 stats_frame_start_wait = 0;
+static SceUInt64 stats_wait = 0;	// Rendering thread blocked on the display since the last snapshot
+
+#define STATS_WAIT(...) do { \
+		SceUInt64 wait_start = sceKernelGetProcessTimeWide(); \
+		__VA_ARGS__; \
+		stats_wait += sceKernelGetProcessTimeWide() - wait_start; \
+	} while (0)
+#else
+#define STATS_WAIT(...) __VA_ARGS__
+#endif
+
 static SceGxmDeviceMemInfo *depthBufferMem;
 static SceGxmDeviceMemInfo *stencilBufferMem;
 static SceGxmDepthStencilSurface depthSurface;
@@ -103,9 +155,14 @@ static SceGxmShaderPatcherId clearVertexProgramId;
 static SceGxmShaderPatcherId clearFragmentProgramId;
 static SceGxmShaderPatcherId colorVertexProgramId;
 static SceGxmShaderPatcherId colorFragmentProgramId;
+static SceGxmShaderPatcherId colorCompactVertexProgramId;
 static SceGxmShaderPatcherId textureVertexProgramId;
 static SceGxmShaderPatcherId textureFragmentProgramId;
+static SceGxmShaderPatcherId textureTintVertexProgramId;
 static SceGxmShaderPatcherId textureTintFragmentProgramId;
+static SceGxmShaderPatcherId spriteVertexProgramId;
+static SceGxmShaderPatcherId shapeVertexProgramId;
+static SceGxmShaderPatcherId shapeFragmentProgramId;
 
 static SceGxmDeviceMemInfo *patcherBufferMem;
 static SceGxmDeviceMemInfo *patcherVertexUsseMem;
@@ -113,6 +170,7 @@ static SceGxmDeviceMemInfo *patcherFragmentUsseMem;
 
 static SceGxmDeviceMemInfo *clearVerticesMem;
 static SceGxmDeviceMemInfo *clearIndicesMem;
+static SceGxmDeviceMemInfo *spriteQuadMem;
 static SceGxmDeviceMemInfo *linearIndicesMem;
 static vita2d_clear_vertex *clearVertices = NULL;
 static uint16_t *clearIndices = NULL;
@@ -129,32 +187,96 @@ int pvrsrvContextAttribs;
 void *vita2d_heap_internal;
 int system_mode_flag = 1;
 int pgf_module_was_loaded = 10;
-float _vita2d_ortho_matrix[4 * 4];
 SceGxmContext *_vita2d_context = NULL;
+vita2d_draw_ctx _vita2d_default_ctx = {
+	.clip = { 0, 0, 0, 960, 544 }
+};
 SceGxmVertexProgram *_vita2d_colorVertexProgram = NULL;
-SceGxmFragmentProgram *_vita2d_colorFragmentProgram = NULL;
+SceGxmVertexProgram *_vita2d_colorCompactVertexProgram = NULL;
+SceGxmVertexProgram *_vita2d_colorMeshVertexProgram = NULL;
 SceGxmVertexProgram *_vita2d_textureVertexProgram = NULL;
-SceGxmFragmentProgram *_vita2d_textureFragmentProgram = NULL;
-SceGxmFragmentProgram *_vita2d_textureTintFragmentProgram = NULL;
+SceGxmVertexProgram *_vita2d_textureTintVertexProgram = NULL;
+SceGxmVertexProgram *_vita2d_textureTintWideVertexProgram = NULL;
+SceGxmVertexProgram *_vita2d_textureTintArrayVertexProgram = NULL;
+SceGxmVertexProgram *_vita2d_spriteVertexProgram = NULL;
+SceGxmVertexProgram *_vita2d_shapeVertexProgram = NULL;
 const SceGxmProgramParameter *_vita2d_clearClearColorParam = NULL;
 const SceGxmProgramParameter *_vita2d_colorWvpParam = NULL;
+const SceGxmProgramParameter *_vita2d_colorCompactWvpParam = NULL;
 const SceGxmProgramParameter *_vita2d_textureWvpParam = NULL;
-const SceGxmProgramParameter *_vita2d_textureTintColorParam = NULL;
-
-typedef struct vita2d_fragment_programs {
-	SceGxmFragmentProgram *color;
-	SceGxmFragmentProgram *texture;
-	SceGxmFragmentProgram *textureTint;
-} vita2d_fragment_programs;
+const SceGxmProgramParameter *_vita2d_textureTintWvpParam = NULL;
+const SceGxmProgramParameter *_vita2d_spriteWvpParam = NULL;
+const SceGxmProgramParameter *_vita2d_spriteInvTexSizeParam = NULL;
+const SceGxmProgramParameter *_vita2d_shapeWvpParam = NULL;
+const float *_vita2d_spriteQuadVertices = NULL;
+const uint16_t *_vita2d_spriteQuadIndices = NULL;
+
+/*
+ * Fragment programs are created per blend mode the first time the mode is
+ * selected. The patcher would hand out the same program again for an equal
+ * (program, blend info, msaa) key, but only after hashing the request, so
+ * created sets are kept here. MSAA mode is fixed between init and fini.
+ */
+static const SceGxmBlendInfo blend_infos[VITA2D_BLEND_MODE_COUNT] = {
+	[VITA2D_BLEND_MODE_NORMAL] = {
+		.colorFunc = SCE_GXM_BLEND_FUNC_ADD,
+		.alphaFunc = SCE_GXM_BLEND_FUNC_ADD,
+		.colorSrc = SCE_GXM_BLEND_FACTOR_SRC_ALPHA,
+		.colorDst = SCE_GXM_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+		.alphaSrc = SCE_GXM_BLEND_FACTOR_SRC_ALPHA,
+		.alphaDst = SCE_GXM_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+		.colorMask = SCE_GXM_COLOR_MASK_ALL
+	},
+	[VITA2D_BLEND_MODE_ADD] = {
+		.colorFunc = SCE_GXM_BLEND_FUNC_ADD,
+		.alphaFunc = SCE_GXM_BLEND_FUNC_ADD,
+		.colorSrc = SCE_GXM_BLEND_FACTOR_ONE,
+		.colorDst = SCE_GXM_BLEND_FACTOR_ONE,
+		.alphaSrc = SCE_GXM_BLEND_FACTOR_ONE,
+		.alphaDst = SCE_GXM_BLEND_FACTOR_ONE,
+		.colorMask = SCE_GXM_COLOR_MASK_ALL
+	},
+	/*
+	 * Multiply and screen are written for premultiplied sources. With straight
+	 * alpha the source term would have to be scaled by alpha a second time,
+	 * which the fixed blend equation can't express.
+	 */
+	// src * dst + dst * (1 - src alpha)
+	[VITA2D_BLEND_MODE_MULTIPLY] = {
+		.colorFunc = SCE_GXM_BLEND_FUNC_ADD,
+		.alphaFunc = SCE_GXM_BLEND_FUNC_ADD,
+		.colorSrc = SCE_GXM_BLEND_FACTOR_DST_COLOR,
+		.colorDst = SCE_GXM_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+		.alphaSrc = SCE_GXM_BLEND_FACTOR_SRC_ALPHA,
+		.alphaDst = SCE_GXM_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+		.colorMask = SCE_GXM_COLOR_MASK_ALL
+	},
+	// src + dst - src * dst
+	[VITA2D_BLEND_MODE_SCREEN] = {
+		.colorFunc = SCE_GXM_BLEND_FUNC_ADD,
+		.alphaFunc = SCE_GXM_BLEND_FUNC_ADD,
+		.colorSrc = SCE_GXM_BLEND_FACTOR_ONE_MINUS_DST_COLOR,
+		.colorDst = SCE_GXM_BLEND_FACTOR_ONE,
+		.alphaSrc = SCE_GXM_BLEND_FACTOR_SRC_ALPHA,
+		.alphaDst = SCE_GXM_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+		.colorMask = SCE_GXM_COLOR_MASK_ALL
+	},
+	[VITA2D_BLEND_MODE_PREMULTIPLIED] = {
+		.colorFunc = SCE_GXM_BLEND_FUNC_ADD,
+		.alphaFunc = SCE_GXM_BLEND_FUNC_ADD,
+		.colorSrc = SCE_GXM_BLEND_FACTOR_ONE,
+		.colorDst = SCE_GXM_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+		.alphaSrc = SCE_GXM_BLEND_FACTOR_ONE,
+		.alphaDst = SCE_GXM_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+		.colorMask = SCE_GXM_COLOR_MASK_ALL
+	}
+	// VITA2D_BLEND_MODE_OPAQUE has no blend info, blending is disabled
+};
 
-struct {
-	vita2d_fragment_programs blend_mode_normal;
-	vita2d_fragment_programs blend_mode_add;
-} _vita2d_fragmentPrograms;
+static vita2d_fragment_programs fragment_programs[VITA2D_BLEND_MODE_COUNT];
+static unsigned int fragment_programs_created = 0;
 
 // Temporary memory pool
-static SceGxmDeviceMemInfo *poolMem;
-static unsigned int pool_index = 0;
 
 /* Static functions */
 
@@ -173,22 +295,22 @@ static void patcher_host_free(void *user_data, void *mem)
 
 static int _vita2d_free_fragment_programs(vita2d_fragment_programs *out)
 {
-	int ret;
-	ret = sceGxmShaderPatcherReleaseFragmentProgram(shaderPatcher, out->color);
-	if (ret != SCE_OK) {
-		SCE_DBG_LOG_ERROR("sceGxmShaderPatcherReleaseFragmentProgram(): 0x%X", ret);
-		goto _free_fragment_programs_error;
-	}
-	ret = sceGxmShaderPatcherReleaseFragmentProgram(shaderPatcher, out->texture);
-	if (ret != SCE_OK) {
-		SCE_DBG_LOG_ERROR("sceGxmShaderPatcherReleaseFragmentProgram(): 0x%X", ret);
-		goto _free_fragment_programs_error;
-	}
-	ret = sceGxmShaderPatcherReleaseFragmentProgram(shaderPatcher, out->textureTint);
-	if (ret != SCE_OK)
-		SCE_DBG_LOG_ERROR("sceGxmShaderPatcherReleaseFragmentProgram(): 0x%X", ret);
+	int ret = SCE_OK;
+	unsigned int i;
+	SceGxmFragmentProgram **programs[] = {
+		&out->color, &out->colorCompact, &out->texture, &out->textureTint, &out->sprite, &out->shape
+	};
 
-_free_fragment_programs_error:
+	// Partially created sets are released too
+	for (i = 0; i < sizeof(programs) / sizeof(programs[0]); i++) {
+		if (!*programs[i])
+			continue;
+
+		ret = sceGxmShaderPatcherReleaseFragmentProgram(shaderPatcher, *programs[i]);
+		if (ret != SCE_OK)
+			SCE_DBG_LOG_ERROR("sceGxmShaderPatcherReleaseFragmentProgram(): 0x%X", ret);
+		*programs[i] = NULL;
+	}
 
 	return ret;
 }
@@ -212,6 +334,20 @@ static int _vita2d_make_fragment_programs(vita2d_fragment_programs *out,
 		goto _make_fragment_programs_error;
 	}
 
+	err = sceGxmShaderPatcherCreateFragmentProgram(
+		shaderPatcher,
+		colorFragmentProgramId,
+		SCE_GXM_OUTPUT_REGISTER_FORMAT_UCHAR4,
+		msaa,
+		blend_info,
+		colorCompactVertexProgramGxp,
+		&out->colorCompact);
+
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("color_compact sceGxmShaderPatcherCreateFragmentProgram(): 0x%X", err);
+		goto _make_fragment_programs_error;
+	}
+
 	err = sceGxmShaderPatcherCreateFragmentProgram(
 		shaderPatcher,
 		textureFragmentProgramId,
@@ -232,21 +368,118 @@ static int _vita2d_make_fragment_programs(vita2d_fragment_programs *out,
 		SCE_GXM_OUTPUT_REGISTER_FORMAT_UCHAR4,
 		msaa,
 		blend_info,
-		textureVertexProgramGxp,
+		textureTintVertexProgramGxp,
 		&out->textureTint);
 
-	if (err != SCE_OK)
+	if (err != SCE_OK) {
 		SCE_DBG_LOG_ERROR("texture_tint sceGxmShaderPatcherCreateFragmentProgram(): 0x%X", err);
+		goto _make_fragment_programs_error;
+	}
+
+	// Same fragment shader as texture_tint, linked against the sprite vertex program outputs
+	err = sceGxmShaderPatcherCreateFragmentProgram(
+		shaderPatcher,
+		textureTintFragmentProgramId,
+		SCE_GXM_OUTPUT_REGISTER_FORMAT_UCHAR4,
+		msaa,
+		blend_info,
+		spriteVertexProgramGxp,
+		&out->sprite);
+
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("sprite sceGxmShaderPatcherCreateFragmentProgram(): 0x%X", err);
+		goto _make_fragment_programs_error;
+	}
+
+	err = sceGxmShaderPatcherCreateFragmentProgram(
+		shaderPatcher,
+		shapeFragmentProgramId,
+		SCE_GXM_OUTPUT_REGISTER_FORMAT_UCHAR4,
+		msaa,
+		blend_info,
+		shapeVertexProgramGxp,
+		&out->shape);
+
+	if (err != SCE_OK)
+		SCE_DBG_LOG_ERROR("shape sceGxmShaderPatcherCreateFragmentProgram(): 0x%X", err);
 
 _make_fragment_programs_error:
 
+	if (err != SCE_OK)
+		_vita2d_free_fragment_programs(out);
+
 	return err;
 }
 
+/*
+ * Frame pacing. A frame is shown swap_interval vblanks after the previous
+ * one. A frame that already missed its interval is shown on the next vblank,
+ * or right away with adaptive vsync, tearing instead of waiting.
+ */
+static unsigned int pacing_wait_count(int *late)
+{
+	unsigned int elapsed = sceDisplayGetVcount() - pacing_vcount;
+
+	*late = swap_interval && elapsed >= swap_interval;
+
+	if (!swap_interval || (*late && adaptive_vsync))
+		return 0;
+
+	return *late ? 1 : swap_interval - elapsed;
+}
+
+static void pacing_frame_shown(int late)
+{
+	SceUInt64 now = sceKernelGetProcessTimeWide();
+	unsigned int vcount = sceDisplayGetVcount();
+	unsigned int vblanks = vcount - pacing_vcount;
+	unsigned int interval_us;
+
+	pacing_seq++;
+	__sync_synchronize();
+
+	if (pacing_reset) {
+		sceClibMemset(&frame_interval_stats, 0, sizeof(frame_interval_stats));
+		pacing_time = 0;
+		pacing_reset = 0;
+	}
+
+	if (pacing_time) {
+		interval_us = (unsigned int)(now - pacing_time);
+		if (vblanks >= VITA2D_FRAME_INTERVAL_BINS)
+			vblanks = VITA2D_FRAME_INTERVAL_BINS - 1;
+		frame_interval_stats.bins[vblanks]++;
+		if (late)
+			frame_interval_stats.late++;
+		frame_interval_stats.last_us = interval_us;
+		if (interval_us > frame_interval_stats.max_us)
+			frame_interval_stats.max_us = interval_us;
+	}
+
+	pacing_vcount = vcount;
+	pacing_time = now;
+
+	__sync_synchronize();
+	pacing_seq++;
+}
+
+void _vita2d_frame_pacing_wait(void)
+{
+	int late;
+	unsigned int count = pacing_wait_count(&late);
+
+	if (count)
+		sceDisplayWaitVblankStartMulti(count);
+
+	pacing_frame_shown(late);
+}
+
 static void display_callback(const void *callback_data)
 {
 	SceDisplayFrameBuf framebuf;
 	const vita2d_display_data *display_data = (const vita2d_display_data *)callback_data;
+	int late;
+	unsigned int count = pacing_wait_count(&late);
 
 	sceClibMemset(&framebuf, 0x00, sizeof(SceDisplayFrameBuf));
 	framebuf.size = sizeof(SceDisplayFrameBuf);
@@ -255,11 +488,18 @@ static void display_callback(const void *callback_data)
 	framebuf.pixelformat = DISPLAY_PIXEL_FORMAT;
 	framebuf.width = display_hres;
 	framebuf.height = display_vres;
-	sceDisplaySetFrameBuf(&framebuf, SCE_DISPLAY_UPDATETIMING_NEXTVSYNC);
 
-	if (vblank_wait) {
+	// The flip is queued for the last vblank of the interval, late frames tear with adaptive vsync
+	if (count > 1)
+		sceDisplayWaitVblankStartMulti(count - 1);
+
+	sceDisplaySetFrameBuf(&framebuf, (count || !late) ? SCE_DISPLAY_UPDATETIMING_NEXTVSYNC : SCE_DISPLAY_UPDATETIMING_NEXTHSYNC);
+
+	if (count)
 		sceDisplayWaitVblankStart();
-	}
+
+	pacing_frame_shown(late);
+	displayQueueShown++;
 }
 
 static void driver_bridge_init(void)
@@ -318,6 +558,12 @@ static int vita2d_setup_shaders(void)
 		goto _init_internal_common_error;
 	}
 
+	err = sceGxmShaderPatcherRegisterProgram(shaderPatcher, colorCompactVertexProgramGxp, &colorCompactVertexProgramId);
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("color_compact_v sceGxmShaderPatcherRegisterProgram(): 0x%X", err);
+		goto _init_internal_common_error;
+	}
+
 	err = sceGxmShaderPatcherRegisterProgram(shaderPatcher, textureVertexProgramGxp, &textureVertexProgramId);
 	if (err != SCE_OK) {
 		SCE_DBG_LOG_ERROR("texture_v sceGxmShaderPatcherRegisterProgram(): 0x%X", err);
@@ -330,32 +576,35 @@ static int vita2d_setup_shaders(void)
 		goto _init_internal_common_error;
 	}
 
+	err = sceGxmShaderPatcherRegisterProgram(shaderPatcher, textureTintVertexProgramGxp, &textureTintVertexProgramId);
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("texture_tint_v sceGxmShaderPatcherRegisterProgram(): 0x%X", err);
+		goto _init_internal_common_error;
+	}
+
 	err = sceGxmShaderPatcherRegisterProgram(shaderPatcher, textureTintFragmentProgramGxp, &textureTintFragmentProgramId);
 	if (err != SCE_OK) {
 		SCE_DBG_LOG_ERROR("texture_tint_f sceGxmShaderPatcherRegisterProgram(): 0x%X", err);
 		goto _init_internal_common_error;
 	}
 
-	// Fill SceGxmBlendInfo
-	static const SceGxmBlendInfo blend_info = {
-		.colorFunc = SCE_GXM_BLEND_FUNC_ADD,
-		.alphaFunc = SCE_GXM_BLEND_FUNC_ADD,
-		.colorSrc = SCE_GXM_BLEND_FACTOR_SRC_ALPHA,
-		.colorDst = SCE_GXM_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
-		.alphaSrc = SCE_GXM_BLEND_FACTOR_SRC_ALPHA,
-		.alphaDst = SCE_GXM_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
-		.colorMask = SCE_GXM_COLOR_MASK_ALL
-	};
+	err = sceGxmShaderPatcherRegisterProgram(shaderPatcher, spriteVertexProgramGxp, &spriteVertexProgramId);
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("sprite_v sceGxmShaderPatcherRegisterProgram(): 0x%X", err);
+		goto _init_internal_common_error;
+	}
 
-	static const SceGxmBlendInfo blend_info_add = {
-		.colorFunc = SCE_GXM_BLEND_FUNC_ADD,
-		.alphaFunc = SCE_GXM_BLEND_FUNC_ADD,
-		.colorSrc = SCE_GXM_BLEND_FACTOR_ONE,
-		.colorDst = SCE_GXM_BLEND_FACTOR_ONE,
-		.alphaSrc = SCE_GXM_BLEND_FACTOR_ONE,
-		.alphaDst = SCE_GXM_BLEND_FACTOR_ONE,
-		.colorMask = SCE_GXM_COLOR_MASK_ALL
-	};
+	err = sceGxmShaderPatcherRegisterProgram(shaderPatcher, shapeVertexProgramGxp, &shapeVertexProgramId);
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("shape_v sceGxmShaderPatcherRegisterProgram(): 0x%X", err);
+		goto _init_internal_common_error;
+	}
+
+	err = sceGxmShaderPatcherRegisterProgram(shaderPatcher, shapeFragmentProgramGxp, &shapeFragmentProgramId);
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("shape_f sceGxmShaderPatcherRegisterProgram(): 0x%X", err);
+		goto _init_internal_common_error;
+	}
 
 	// get attributes by name to create vertex format bindings
 	const SceGxmProgramParameter *paramClearPositionAttribute = sceGxmProgramFindParameterByName(clearVertexProgramGxp, "aPosition");
@@ -419,6 +668,16 @@ static int vita2d_setup_shaders(void)
 		linearIndices[i] = i;
 	}
 
+	err = _vita2d_batch_init();
+	if (err != SCE_OK)
+		goto _init_internal_common_error;
+
+	err = _vita2d_circle_init();
+	if (err != SCE_OK)
+		goto _init_internal_common_error;
+
+	_vita2d_polyline_init();
+
 	// create the clear rectangle vertex/index data
 
 	err = sceGxmAllocDeviceMemLinux(
@@ -465,12 +724,48 @@ static int vita2d_setup_shaders(void)
 	clearIndices[4] = 2;
 	clearIndices[5] = 3;
 
+	// create the unit quad used to expand sprite instances: 4 corners followed by 6 indices
+
+	err = sceGxmAllocDeviceMemLinux(
+		SCE_GXM_DEVICE_HEAP_ID_USER_NC,
+		SCE_GXM_MEMORY_ATTRIB_READ,
+		4 * 2 * sizeof(float) + 6 * sizeof(uint16_t),
+		4,
+		&spriteQuadMem);
+
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("sceGxmAllocDeviceMemLinux(): 0x%X", err);
+		goto _init_internal_common_error;
+	}
+
+	float *spriteQuadVertices = (float *)(spriteQuadMem->mappedBase);
+	uint16_t *spriteQuadIndices = (uint16_t *)(spriteQuadVertices + 4 * 2);
+
+	spriteQuadVertices[0] = 0.0f;
+	spriteQuadVertices[1] = 0.0f;
+	spriteQuadVertices[2] = 1.0f;
+	spriteQuadVertices[3] = 0.0f;
+	spriteQuadVertices[4] = 0.0f;
+	spriteQuadVertices[5] = 1.0f;
+	spriteQuadVertices[6] = 1.0f;
+	spriteQuadVertices[7] = 1.0f;
+
+	spriteQuadIndices[0] = 0;
+	spriteQuadIndices[1] = 1;
+	spriteQuadIndices[2] = 2;
+	spriteQuadIndices[3] = 2;
+	spriteQuadIndices[4] = 1;
+	spriteQuadIndices[5] = 3;
+
+	_vita2d_spriteQuadVertices = spriteQuadVertices;
+	_vita2d_spriteQuadIndices = spriteQuadIndices;
+
 	const SceGxmProgramParameter *paramColorPositionAttribute = sceGxmProgramFindParameterByName(colorVertexProgramGxp, "aPosition");
 	const SceGxmProgramParameter *paramColorColorAttribute = sceGxmProgramFindParameterByName(colorVertexProgramGxp, "aColor");
 
 	// create color vertex format
 	SceGxmVertexAttribute colorVertexAttributes[2];
-	SceGxmVertexStream colorVertexStreams[1];
+	SceGxmVertexStream colorVertexStreams[2];
 	/* x,y,z: 3 float 32 bits */
 	colorVertexAttributes[0].streamIndex = 0;
 	colorVertexAttributes[0].offset = 0;
@@ -502,6 +797,57 @@ static int vita2d_setup_shaders(void)
 		goto _init_internal_common_error;;
 	}
 
+	const SceGxmProgramParameter *paramColorCompactPositionAttribute = sceGxmProgramFindParameterByName(colorCompactVertexProgramGxp, "aPosition");
+	const SceGxmProgramParameter *paramColorCompactColorAttribute = sceGxmProgramFindParameterByName(colorCompactVertexProgramGxp, "aColor");
+
+	// create compact color vertex format, used by the built-in primitives
+	/* x,y: 2 float 32 bits */
+	colorVertexAttributes[0].componentCount = 2; // (x, y)
+	colorVertexAttributes[0].regIndex = sceGxmProgramParameterGetResourceIndex(paramColorCompactPositionAttribute);
+	/* color: 4 unsigned char  = 32 bits */
+	colorVertexAttributes[1].offset = 8; // (x, y) * 4 = 8 bytes
+	colorVertexAttributes[1].regIndex = sceGxmProgramParameterGetResourceIndex(paramColorCompactColorAttribute);
+	// 16 bit (short) indices
+	colorVertexStreams[0].stride = sizeof(vita2d_color_compact_vertex);
+
+	err = sceGxmShaderPatcherCreateVertexProgram(
+		shaderPatcher,
+		colorCompactVertexProgramId,
+		colorVertexAttributes,
+		2,
+		colorVertexStreams,
+		1,
+		&_vita2d_colorCompactVertexProgram);
+
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("color_compact sceGxmShaderPatcherCreateVertexProgram(): 0x%X", err);
+		goto _init_internal_common_error;
+	}
+
+	/*
+	 * Unit mesh variant used by circles: x,y come from a shared mesh,
+	 * the single color comes from a second stream indexed by instance (always 0)
+	 */
+	colorVertexAttributes[1].streamIndex = 1;
+	colorVertexAttributes[1].offset = 0;
+	colorVertexStreams[0].stride = 2 * sizeof(float);
+	colorVertexStreams[1].stride = sizeof(unsigned int);
+	colorVertexStreams[1].indexSource = SCE_GXM_INDEX_SOURCE_INSTANCE_16BIT;
+
+	err = sceGxmShaderPatcherCreateVertexProgram(
+		shaderPatcher,
+		colorCompactVertexProgramId,
+		colorVertexAttributes,
+		2,
+		colorVertexStreams,
+		2,
+		&_vita2d_colorMeshVertexProgram);
+
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("color_compact mesh sceGxmShaderPatcherCreateVertexProgram(): 0x%X", err);
+		goto _init_internal_common_error;
+	}
+
 	const SceGxmProgramParameter *paramTexturePositionAttribute = sceGxmProgramFindParameterByName(textureVertexProgramGxp, "aPosition");
 	const SceGxmProgramParameter *paramTextureTexcoordAttribute = sceGxmProgramFindParameterByName(textureVertexProgramGxp, "aTexcoord");
 
@@ -539,33 +885,242 @@ static int vita2d_setup_shaders(void)
 		goto _init_internal_common_error;
 	}
 
-	// Create variations of the fragment program based on blending mode
-	_vita2d_make_fragment_programs(&_vita2d_fragmentPrograms.blend_mode_normal, &blend_info, msaa_s);
-	_vita2d_make_fragment_programs(&_vita2d_fragmentPrograms.blend_mode_add, &blend_info_add, msaa_s);
+	const SceGxmProgramParameter *paramTextureTintPositionAttribute = sceGxmProgramFindParameterByName(textureTintVertexProgramGxp, "aPosition");
+	const SceGxmProgramParameter *paramTextureTintTexcoordAttribute = sceGxmProgramFindParameterByName(textureTintVertexProgramGxp, "aTexcoord");
+	const SceGxmProgramParameter *paramTextureTintColorAttribute = sceGxmProgramFindParameterByName(textureTintVertexProgramGxp, "aColor");
+
+	// create texture tint vertex format
+	SceGxmVertexAttribute textureTintVertexAttributes[3];
+	SceGxmVertexStream textureTintVertexStreams[2];
+	/* x,y: 2 float 32 bits */
+	textureTintVertexAttributes[0].streamIndex = 0;
+	textureTintVertexAttributes[0].offset = 0;
+	textureTintVertexAttributes[0].format = SCE_GXM_ATTRIBUTE_FORMAT_F32;
+	textureTintVertexAttributes[0].componentCount = 2; // (x, y)
+	textureTintVertexAttributes[0].regIndex = sceGxmProgramParameterGetResourceIndex(paramTextureTintPositionAttribute);
+	/* u,v: 2 unsigned short normalized 16 bits */
+	textureTintVertexAttributes[1].streamIndex = 0;
+	textureTintVertexAttributes[1].offset = 8; // (x, y) * 4 = 8 bytes
+	textureTintVertexAttributes[1].format = SCE_GXM_ATTRIBUTE_FORMAT_U16N;
+	textureTintVertexAttributes[1].componentCount = 2; // (u, v)
+	textureTintVertexAttributes[1].regIndex = sceGxmProgramParameterGetResourceIndex(paramTextureTintTexcoordAttribute);
+	/* color: 4 unsigned char  = 32 bits */
+	textureTintVertexAttributes[2].streamIndex = 0;
+	textureTintVertexAttributes[2].offset = 12; // (x, y) * 4 + (u, v) * 2 = 12 bytes
+	textureTintVertexAttributes[2].format = SCE_GXM_ATTRIBUTE_FORMAT_U8N;
+	textureTintVertexAttributes[2].componentCount = 4; // (color)
+	textureTintVertexAttributes[2].regIndex = sceGxmProgramParameterGetResourceIndex(paramTextureTintColorAttribute);
+	// 16 bit (short) indices
+	textureTintVertexStreams[0].stride = sizeof(vita2d_texture_tint_vertex);
+	textureTintVertexStreams[0].indexSource = SCE_GXM_INDEX_SOURCE_INDEX_16BIT;
+
+	// create texture tint shaders
+	err = sceGxmShaderPatcherCreateVertexProgram(
+		shaderPatcher,
+		textureTintVertexProgramId,
+		textureTintVertexAttributes,
+		3,
+		textureTintVertexStreams,
+		1,
+		&_vita2d_textureTintVertexProgram);
+
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("texture_tint sceGxmShaderPatcherCreateVertexProgram(): 0x%X", err);
+		goto _init_internal_common_error;
+	}
+
+	// Same layout with F32 texcoords, for quads whose texcoords leave [0, 1] to tile or wrap
+	textureTintVertexAttributes[1].format = SCE_GXM_ATTRIBUTE_FORMAT_F32;
+	textureTintVertexAttributes[2].offset = 16; // (x, y) * 4 + (u, v) * 4 = 16 bytes
+	textureTintVertexStreams[0].stride = sizeof(vita2d_texture_tint_wide_vertex);
+
+	err = sceGxmShaderPatcherCreateVertexProgram(
+		shaderPatcher,
+		textureTintVertexProgramId,
+		textureTintVertexAttributes,
+		3,
+		textureTintVertexStreams,
+		1,
+		&_vita2d_textureTintWideVertexProgram);
+
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("texture_tint wide sceGxmShaderPatcherCreateVertexProgram(): 0x%X", err);
+		goto _init_internal_common_error;
+	}
+
+	/*
+	 * vita2d_draw_array_textured() variant: position and texcoord come from vita2d_texture_vertex,
+	 * the single tint color comes from a second stream indexed by instance (always 0)
+	 */
+	textureTintVertexAttributes[1].offset = 12; // (x, y, z) * 4 = 12 bytes
+	textureTintVertexAttributes[1].format = SCE_GXM_ATTRIBUTE_FORMAT_F32;
+	textureTintVertexAttributes[2].streamIndex = 1;
+	textureTintVertexAttributes[2].offset = 0;
+	textureTintVertexStreams[0].stride = sizeof(vita2d_texture_vertex);
+	textureTintVertexStreams[0].indexSource = SCE_GXM_INDEX_SOURCE_INDEX_16BIT;
+	textureTintVertexStreams[1].stride = sizeof(unsigned int);
+	textureTintVertexStreams[1].indexSource = SCE_GXM_INDEX_SOURCE_INSTANCE_16BIT;
+
+	err = sceGxmShaderPatcherCreateVertexProgram(
+		shaderPatcher,
+		textureTintVertexProgramId,
+		textureTintVertexAttributes,
+		3,
+		textureTintVertexStreams,
+		2,
+		&_vita2d_textureTintArrayVertexProgram);
+
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("texture_tint array sceGxmShaderPatcherCreateVertexProgram(): 0x%X", err);
+		goto _init_internal_common_error;
+	}
+
+	const SceGxmProgramParameter *paramSpriteCornerAttribute = sceGxmProgramFindParameterByName(spriteVertexProgramGxp, "aCorner");
+	const SceGxmProgramParameter *paramSpritePositionAttribute = sceGxmProgramFindParameterByName(spriteVertexProgramGxp, "aPosition");
+	const SceGxmProgramParameter *paramSpriteScaleAttribute = sceGxmProgramFindParameterByName(spriteVertexProgramGxp, "aScale");
+	const SceGxmProgramParameter *paramSpriteRotationAttribute = sceGxmProgramFindParameterByName(spriteVertexProgramGxp, "aRotation");
+	const SceGxmProgramParameter *paramSpriteHotspotAttribute = sceGxmProgramFindParameterByName(spriteVertexProgramGxp, "aHotspot");
+	const SceGxmProgramParameter *paramSpriteTexRectAttribute = sceGxmProgramFindParameterByName(spriteVertexProgramGxp, "aTexRect");
+	const SceGxmProgramParameter *paramSpriteColorAttribute = sceGxmProgramFindParameterByName(spriteVertexProgramGxp, "aColor");
+
+	// create sprite vertex format: unit quad corners on stream 0, vita2d_sprite_instance records on stream 1
+	SceGxmVertexAttribute spriteVertexAttributes[7];
+	SceGxmVertexStream spriteVertexStreams[2];
+	/* corner: 2 float 32 bits */
+	spriteVertexAttributes[0].streamIndex = 0;
+	spriteVertexAttributes[0].offset = 0;
+	spriteVertexAttributes[0].format = SCE_GXM_ATTRIBUTE_FORMAT_F32;
+	spriteVertexAttributes[0].componentCount = 2;
+	spriteVertexAttributes[0].regIndex = sceGxmProgramParameterGetResourceIndex(paramSpriteCornerAttribute);
+	/* x,y: 2 float 32 bits */
+	spriteVertexAttributes[1].streamIndex = 1;
+	spriteVertexAttributes[1].offset = offsetof(vita2d_sprite_instance, x);
+	spriteVertexAttributes[1].format = SCE_GXM_ATTRIBUTE_FORMAT_F32;
+	spriteVertexAttributes[1].componentCount = 2;
+	spriteVertexAttributes[1].regIndex = sceGxmProgramParameterGetResourceIndex(paramSpritePositionAttribute);
+	/* x_scale,y_scale: 2 float 32 bits */
+	spriteVertexAttributes[2].streamIndex = 1;
+	spriteVertexAttributes[2].offset = offsetof(vita2d_sprite_instance, x_scale);
+	spriteVertexAttributes[2].format = SCE_GXM_ATTRIBUTE_FORMAT_F32;
+	spriteVertexAttributes[2].componentCount = 2;
+	spriteVertexAttributes[2].regIndex = sceGxmProgramParameterGetResourceIndex(paramSpriteScaleAttribute);
+	/* rad: 1 float 32 bits */
+	spriteVertexAttributes[3].streamIndex = 1;
+	spriteVertexAttributes[3].offset = offsetof(vita2d_sprite_instance, rad);
+	spriteVertexAttributes[3].format = SCE_GXM_ATTRIBUTE_FORMAT_F32;
+	spriteVertexAttributes[3].componentCount = 1;
+	spriteVertexAttributes[3].regIndex = sceGxmProgramParameterGetResourceIndex(paramSpriteRotationAttribute);
+	/* center_x,center_y: 2 float 32 bits */
+	spriteVertexAttributes[4].streamIndex = 1;
+	spriteVertexAttributes[4].offset = offsetof(vita2d_sprite_instance, center_x);
+	spriteVertexAttributes[4].format = SCE_GXM_ATTRIBUTE_FORMAT_F32;
+	spriteVertexAttributes[4].componentCount = 2;
+	spriteVertexAttributes[4].regIndex = sceGxmProgramParameterGetResourceIndex(paramSpriteHotspotAttribute);
+	/* tex_x,tex_y,tex_w,tex_h: 4 unsigned short 16 bits */
+	spriteVertexAttributes[5].streamIndex = 1;
+	spriteVertexAttributes[5].offset = offsetof(vita2d_sprite_instance, tex_x);
+	spriteVertexAttributes[5].format = SCE_GXM_ATTRIBUTE_FORMAT_U16;
+	spriteVertexAttributes[5].componentCount = 4;
+	spriteVertexAttributes[5].regIndex = sceGxmProgramParameterGetResourceIndex(paramSpriteTexRectAttribute);
+	/* color: 4 unsigned char  = 32 bits */
+	spriteVertexAttributes[6].streamIndex = 1;
+	spriteVertexAttributes[6].offset = offsetof(vita2d_sprite_instance, color);
+	spriteVertexAttributes[6].format = SCE_GXM_ATTRIBUTE_FORMAT_U8N;
+	spriteVertexAttributes[6].componentCount = 4;
+	spriteVertexAttributes[6].regIndex = sceGxmProgramParameterGetResourceIndex(paramSpriteColorAttribute);
+	// corners are indexed, instance records are fetched by instance index
+	spriteVertexStreams[0].stride = 2 * sizeof(float);
+	spriteVertexStreams[0].indexSource = SCE_GXM_INDEX_SOURCE_INDEX_16BIT;
+	spriteVertexStreams[1].stride = sizeof(vita2d_sprite_instance);
+	spriteVertexStreams[1].indexSource = SCE_GXM_INDEX_SOURCE_INSTANCE_16BIT;
+
+	// create sprite shaders
+	err = sceGxmShaderPatcherCreateVertexProgram(
+		shaderPatcher,
+		spriteVertexProgramId,
+		spriteVertexAttributes,
+		7,
+		spriteVertexStreams,
+		2,
+		&_vita2d_spriteVertexProgram);
+
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("sprite sceGxmShaderPatcherCreateVertexProgram(): 0x%X", err);
+		goto _init_internal_common_error;
+	}
+
+	const SceGxmProgramParameter *paramShapePositionAttribute = sceGxmProgramFindParameterByName(shapeVertexProgramGxp, "aPosition");
+	const SceGxmProgramParameter *paramShapeLocalAttribute = sceGxmProgramFindParameterByName(shapeVertexProgramGxp, "aLocal");
+	const SceGxmProgramParameter *paramShapeShapeAttribute = sceGxmProgramFindParameterByName(shapeVertexProgramGxp, "aShape");
+	const SceGxmProgramParameter *paramShapeColorAttribute = sceGxmProgramFindParameterByName(shapeVertexProgramGxp, "aColor");
+
+	// create shape vertex format
+	SceGxmVertexAttribute shapeVertexAttributes[4];
+	SceGxmVertexStream shapeVertexStreams[1];
+	/* x,y: 2 float 32 bits */
+	shapeVertexAttributes[0].streamIndex = 0;
+	shapeVertexAttributes[0].offset = offsetof(vita2d_shape_vertex, x);
+	shapeVertexAttributes[0].format = SCE_GXM_ATTRIBUTE_FORMAT_F32;
+	shapeVertexAttributes[0].componentCount = 2;
+	shapeVertexAttributes[0].regIndex = sceGxmProgramParameterGetResourceIndex(paramShapePositionAttribute);
+	/* local_x,local_y: 2 float 32 bits */
+	shapeVertexAttributes[1].streamIndex = 0;
+	shapeVertexAttributes[1].offset = offsetof(vita2d_shape_vertex, local_x);
+	shapeVertexAttributes[1].format = SCE_GXM_ATTRIBUTE_FORMAT_F32;
+	shapeVertexAttributes[1].componentCount = 2;
+	shapeVertexAttributes[1].regIndex = sceGxmProgramParameterGetResourceIndex(paramShapeLocalAttribute);
+	/* half_w,half_h,radius,stroke: 4 float 32 bits */
+	shapeVertexAttributes[2].streamIndex = 0;
+	shapeVertexAttributes[2].offset = offsetof(vita2d_shape_vertex, half_w);
+	shapeVertexAttributes[2].format = SCE_GXM_ATTRIBUTE_FORMAT_F32;
+	shapeVertexAttributes[2].componentCount = 4;
+	shapeVertexAttributes[2].regIndex = sceGxmProgramParameterGetResourceIndex(paramShapeShapeAttribute);
+	/* color: 4 unsigned char  = 32 bits */
+	shapeVertexAttributes[3].streamIndex = 0;
+	shapeVertexAttributes[3].offset = offsetof(vita2d_shape_vertex, color);
+	shapeVertexAttributes[3].format = SCE_GXM_ATTRIBUTE_FORMAT_U8N;
+	shapeVertexAttributes[3].componentCount = 4;
+	shapeVertexAttributes[3].regIndex = sceGxmProgramParameterGetResourceIndex(paramShapeColorAttribute);
+	// 16 bit (short) indices
+	shapeVertexStreams[0].stride = sizeof(vita2d_shape_vertex);
+	shapeVertexStreams[0].indexSource = SCE_GXM_INDEX_SOURCE_INDEX_16BIT;
 
-	// Default to "normal" blending mode (non-additive)
-	vita2d_set_blend_mode_add(0);
+	// create shape shaders
+	err = sceGxmShaderPatcherCreateVertexProgram(
+		shaderPatcher,
+		shapeVertexProgramId,
+		shapeVertexAttributes,
+		4,
+		shapeVertexStreams,
+		1,
+		&_vita2d_shapeVertexProgram);
+
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("shape sceGxmShaderPatcherCreateVertexProgram(): 0x%X", err);
+		goto _init_internal_common_error;
+	}
+
+	// Default to "normal" blending mode, other variants are created when first selected
+	err = vita2d_set_blend_mode(VITA2D_BLEND_MODE_NORMAL);
+	if (err != SCE_OK)
+		goto _init_internal_common_error;
 
 	// find vertex uniforms by name and cache parameter information
 	_vita2d_clearClearColorParam = sceGxmProgramFindParameterByName(clearFragmentProgramGxp, "uClearColor");
 	_vita2d_colorWvpParam = sceGxmProgramFindParameterByName(colorVertexProgramGxp, "wvp");
+	_vita2d_colorCompactWvpParam = sceGxmProgramFindParameterByName(colorCompactVertexProgramGxp, "wvp");
 	_vita2d_textureWvpParam = sceGxmProgramFindParameterByName(textureVertexProgramGxp, "wvp");
-	_vita2d_textureTintColorParam = sceGxmProgramFindParameterByName(textureTintFragmentProgramGxp, "uTintColor");
+	_vita2d_textureTintWvpParam = sceGxmProgramFindParameterByName(textureTintVertexProgramGxp, "wvp");
+	_vita2d_spriteWvpParam = sceGxmProgramFindParameterByName(spriteVertexProgramGxp, "wvp");
+	_vita2d_spriteInvTexSizeParam = sceGxmProgramFindParameterByName(spriteVertexProgramGxp, "uInvTexSize");
+	_vita2d_shapeWvpParam = sceGxmProgramFindParameterByName(shapeVertexProgramGxp, "wvp");
 
 	// Allocate memory for the memory pool
-	err = sceGxmAllocDeviceMemLinux(
-		SCE_GXM_DEVICE_HEAP_ID_USER_NC,
-		SCE_GXM_MEMORY_ATTRIB_READ,
-		init_param_s.temp_pool_size,
-		sizeof(void *),
-		&poolMem);
-
-	if (err != SCE_OK) {
-		SCE_DBG_LOG_ERROR("sceGxmAllocDeviceMemLinux(): 0x%X", err);
+	err = _vita2d_pool_init(init_param_s.temp_pool_size);
+	if (err != SCE_OK)
 		goto _init_internal_common_error;
-	}
 
-	matrix_init_orthographic(_vita2d_ortho_matrix, 0.0f, display_hres, display_vres, 0.0f, 0.0f, 1.0f);
+	matrix_init_orthographic(_vita2d_default_ctx.ortho, 0.0f, display_hres, display_vres, 0.0f, 0.0f, 1.0f);
 
 	/* Wait if there are unfinished PTLA operations */
 	SGXWaitTransfer(psDevData, phTransferContext);
@@ -737,6 +1292,8 @@ static int vita2d_init_internal_common()
 		goto _init_internal_common_error;
 	}
 
+	_vita2d_default_ctx.context = _vita2d_context;
+
 	// set up parameters
 	SceGxmRenderTargetParams renderTargetParams;
 	sceClibMemset(&renderTargetParams, 0, sizeof(SceGxmRenderTargetParams));
@@ -765,7 +1322,7 @@ static int vita2d_init_internal_common()
 	SGX_PSP2_CONTROL_STREAM trStream;
 
 	// allocate memory and sync objects for display buffers
-	for (i = 0; i < DISPLAY_BUFFER_COUNT; i++) {
+	for (i = 0; i < displayBufferCount; i++) {
 
 		if (!system_mode_flag) {
 			// allocate memory for display
@@ -979,7 +1536,9 @@ static int vita2d_init_internal_common_external(vita2d_init_param_external *init
 	msaa_s = init_param->msaa;
 
 	_vita2d_context = init_param->imm_context;
+	_vita2d_default_ctx.context = _vita2d_context;
 	renderTarget = init_param->render_target;
+	displayBufferCount = DISPLAY_DEFAULT_BUFFER_COUNT;
 	displayBufferData[0] = init_param->display_buffer_data[0];
 	displayBufferData[1] = init_param->display_buffer_data[1];
 	displayBufferSync[0] = init_param->display_buffer_sync[0];
@@ -1021,6 +1580,12 @@ int vita2d_init(vita2d_init_param *init_param)
 		init_param_s.fragment_ring_buffer_size = SCE_GXM_DEFAULT_FRAGMENT_RING_BUFFER_SIZE;
 	if (!init_param_s.fragment_usse_ring_buffer_size)
 		init_param_s.fragment_usse_ring_buffer_size = SCE_GXM_DEFAULT_FRAGMENT_USSE_RING_BUFFER_SIZE;
+	if (!init_param_s.display_buffer_count)
+		init_param_s.display_buffer_count = DISPLAY_DEFAULT_BUFFER_COUNT;
+
+	if (init_param_s.display_buffer_count < DISPLAY_DEFAULT_BUFFER_COUNT
+		|| init_param_s.display_buffer_count > DISPLAY_MAX_BUFFER_COUNT)
+		return VITA2D_SYS_ERROR_INVALID_ARGUMENT;
 
 	vita2d_heap_internal = heap_create_heap("vita2d_heap", init_param_s.heap_size, HEAP_AUTO_EXTEND, NULL);
 
@@ -1035,7 +1600,7 @@ int vita2d_init(vita2d_init_param *init_param)
 		SceGxmInitializeParams gxm_init_params_internal;
 		sceClibMemset(&gxm_init_params_internal, 0, sizeof(SceGxmInitializeParams));
 		gxm_init_params_internal.flags = SCE_GXM_INITIALIZE_FLAG_PBDESCFLAGS_ZLS_OVERRIDE | SCE_GXM_INITIALIZE_FLAG_DRIVER_MEM_SHARE;
-		gxm_init_params_internal.displayQueueMaxPendingCount = 2;
+		gxm_init_params_internal.displayQueueMaxPendingCount = DISPLAY_MAX_PENDING_SWAPS;
 
 		err = sceGxmInitializeInternal(&gxm_init_params_internal);
 
@@ -1065,17 +1630,32 @@ int vita2d_init(vita2d_init_param *init_param)
 			return err;
 		}
 
+		// shared framebuffer always has a front and a back buffer
+		displayBufferCount = DISPLAY_DEFAULT_BUFFER_COUNT;
 		displayBufferData[0] = info.frontBuffer;
 		displayBufferData[1] = info.backBuffer;
 
-		return vita2d_init_internal_common();
+		err = vita2d_init_internal_common();
+		if (err != SCE_OK)
+			return err;
+
+		shfb_acquired = 0;
+		if (init_param_s.present_thread) {
+			err = _vita2d_present_init(shfb_id);
+			if (err != SCE_OK)
+				SCE_DBG_LOG_WARNING("present thread unavailable, presenting on the rendering thread");
+		}
+
+		return SCE_OK;
 	}
 	else {
 
+		displayBufferCount = init_param_s.display_buffer_count;
+
 		SceGxmInitializeParams initializeParams;
 		sceClibMemset(&initializeParams, 0, sizeof(SceGxmInitializeParams));
 		initializeParams.flags = 0;
-		initializeParams.displayQueueMaxPendingCount = 2;
+		initializeParams.displayQueueMaxPendingCount = DISPLAY_MAX_PENDING_SWAPS;
 		initializeParams.displayQueueCallback = display_callback;
 		initializeParams.displayQueueCallbackDataSize = sizeof(vita2d_display_data);
 		initializeParams.parameterBufferSize = init_param_s.param_buffer_size;
@@ -1166,7 +1746,7 @@ int vita2d_display_set_resolution(int hRes, int vRes)
 		break;
 	}
 
-	matrix_init_orthographic(_vita2d_ortho_matrix, 0.0f, display_hres, display_vres, 0.0f, 0.0f, 1.0f);
+	matrix_init_orthographic(_vita2d_default_ctx.ortho, 0.0f, display_hres, display_vres, 0.0f, 0.0f, 1.0f);
 
 	validRegion.xMax = hRes - 1;
 	validRegion.yMax = vRes - 1;
@@ -1232,6 +1812,9 @@ int vita2d_fini()
 		goto _fini_error;
 	}
 
+	_vita2d_present_fini();
+	shfb_acquired = 0;
+
 	if (system_mode_flag)
 		sceSharedFbBegin(shfb_id, &info);
 
@@ -1254,18 +1837,70 @@ int vita2d_fini()
 		goto _fini_error;
 	}
 
+	err = sceGxmShaderPatcherReleaseVertexProgram(shaderPatcher, _vita2d_colorCompactVertexProgram);
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("_vita2d_colorCompactVertexProgram sceGxmShaderPatcherReleaseVertexProgram(): 0x%X", err);
+		goto _fini_error;
+	}
+
+	err = sceGxmShaderPatcherReleaseVertexProgram(shaderPatcher, _vita2d_colorMeshVertexProgram);
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("_vita2d_colorMeshVertexProgram sceGxmShaderPatcherReleaseVertexProgram(): 0x%X", err);
+		goto _fini_error;
+	}
+
 	err = sceGxmShaderPatcherReleaseVertexProgram(shaderPatcher, _vita2d_textureVertexProgram);
 	if (err != SCE_OK) {
 		SCE_DBG_LOG_ERROR("_vita2d_textureVertexProgram sceGxmShaderPatcherReleaseVertexProgram(): 0x%X", err);
 		goto _fini_error;
 	}
 
-	_vita2d_free_fragment_programs(&_vita2d_fragmentPrograms.blend_mode_normal);
-	_vita2d_free_fragment_programs(&_vita2d_fragmentPrograms.blend_mode_add);
+	err = sceGxmShaderPatcherReleaseVertexProgram(shaderPatcher, _vita2d_textureTintVertexProgram);
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("_vita2d_textureTintVertexProgram sceGxmShaderPatcherReleaseVertexProgram(): 0x%X", err);
+		goto _fini_error;
+	}
+
+	err = sceGxmShaderPatcherReleaseVertexProgram(shaderPatcher, _vita2d_textureTintWideVertexProgram);
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("_vita2d_textureTintWideVertexProgram sceGxmShaderPatcherReleaseVertexProgram(): 0x%X", err);
+		goto _fini_error;
+	}
+
+	err = sceGxmShaderPatcherReleaseVertexProgram(shaderPatcher, _vita2d_textureTintArrayVertexProgram);
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("_vita2d_textureTintArrayVertexProgram sceGxmShaderPatcherReleaseVertexProgram(): 0x%X", err);
+		goto _fini_error;
+	}
+
+	err = sceGxmShaderPatcherReleaseVertexProgram(shaderPatcher, _vita2d_spriteVertexProgram);
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("_vita2d_spriteVertexProgram sceGxmShaderPatcherReleaseVertexProgram(): 0x%X", err);
+		goto _fini_error;
+	}
+
+	err = sceGxmShaderPatcherReleaseVertexProgram(shaderPatcher, _vita2d_shapeVertexProgram);
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("_vita2d_shapeVertexProgram sceGxmShaderPatcherReleaseVertexProgram(): 0x%X", err);
+		goto _fini_error;
+	}
+
+	for (i = 0; i < VITA2D_BLEND_MODE_COUNT; i++) {
+		if (fragment_programs_created & (1 << i))
+			_vita2d_free_fragment_programs(&fragment_programs[i]);
+	}
+	fragment_programs_created = 0;
 
+	_vita2d_deferred_fini();
+	_vita2d_display_list_fini();
+	_vita2d_polyline_release(&_vita2d_default_ctx);
+	_vita2d_queue_fini();
+	_vita2d_batch_fini();
+	_vita2d_circle_fini();
 	sceGxmFreeDeviceMemLinux(linearIndicesMem);
 	sceGxmFreeDeviceMemLinux(clearIndicesMem);
 	sceGxmFreeDeviceMemLinux(clearVerticesMem);
+	sceGxmFreeDeviceMemLinux(spriteQuadMem);
 
 	// wait until display queue is finished before deallocating display buffers
 	if (!system_mode_flag) {
@@ -1277,7 +1912,7 @@ int vita2d_fini()
 		}
 	}
 
-	for (i = 0; i < DISPLAY_BUFFER_COUNT; i++) {
+	for (i = 0; i < displayBufferCount; i++) {
 		if (!system_mode_flag) {
 			sceGxmFreeDeviceMemLinux(displayBufferMem[i]);
 
@@ -1309,8 +1944,13 @@ int vita2d_fini()
 	sceGxmShaderPatcherUnregisterProgram(shaderPatcher, clearVertexProgramId);
 	sceGxmShaderPatcherUnregisterProgram(shaderPatcher, colorFragmentProgramId);
 	sceGxmShaderPatcherUnregisterProgram(shaderPatcher, colorVertexProgramId);
+	sceGxmShaderPatcherUnregisterProgram(shaderPatcher, colorCompactVertexProgramId);
 	sceGxmShaderPatcherUnregisterProgram(shaderPatcher, textureFragmentProgramId);
 	sceGxmShaderPatcherUnregisterProgram(shaderPatcher, textureTintFragmentProgramId);
+	sceGxmShaderPatcherUnregisterProgram(shaderPatcher, textureTintVertexProgramId);
+	sceGxmShaderPatcherUnregisterProgram(shaderPatcher, spriteVertexProgramId);
+	sceGxmShaderPatcherUnregisterProgram(shaderPatcher, shapeVertexProgramId);
+	sceGxmShaderPatcherUnregisterProgram(shaderPatcher, shapeFragmentProgramId);
 	sceGxmShaderPatcherUnregisterProgram(shaderPatcher, textureVertexProgramId);
 
 	err = sceGxmShaderPatcherDestroy(shaderPatcher);
@@ -1371,7 +2011,7 @@ int vita2d_fini()
 		sceGxmFreeDeviceMemLinux((SceGxmDeviceMemInfo *)vdmRingBufferMem);
 
 	PVRSRVFreeUserModeMem(contextParams.hostMem);
-	sceGxmFreeDeviceMemLinux(poolMem);
+	_vita2d_pool_fini();
 
 	if (system_mode_flag) {
 
@@ -1429,30 +2069,108 @@ _fini_error:
 
 void vita2d_clear_screen()
 {
+	_vita2d_clip_require_stencil();
+	_vita2d_batch_flush();
+
 	// set clear shaders
-	sceGxmSetVertexProgram(_vita2d_context, clearVertexProgram);
-	sceGxmSetFragmentProgram(_vita2d_context, clearFragmentProgram);
+	_vita2d_set_vertex_program(clearVertexProgram);
+	_vita2d_set_fragment_program(clearFragmentProgram);
 
 	// set the clear color
 	void *color_buffer;
-	sceGxmReserveFragmentDefaultUniformBuffer(_vita2d_context, &color_buffer);
+	sceGxmReserveFragmentDefaultUniformBuffer(_vita2d_ctx()->context, &color_buffer);
 	sceGxmSetUniformDataF(color_buffer, _vita2d_clearClearColorParam, 0, 4, clear_color);
 
 	// draw the clear triangle
-	sceGxmSetVertexStream(_vita2d_context, 0, clearVertices);
-	sceGxmDraw(_vita2d_context, SCE_GXM_PRIMITIVE_TRIANGLES, SCE_GXM_INDEX_FORMAT_U16, clearIndices, 6);
+	_vita2d_set_front_polygon_mode(SCE_GXM_POLYGON_MODE_TRIANGLE_FILL);
+	_vita2d_set_vertex_stream(0, clearVertices);
+	_vita2d_draw(SCE_GXM_PRIMITIVE_TRIANGLES, clearIndices, 6, 4);
+}
+
+#ifndef VITA2D_SYS_NO_STATS
+void _vita2d_stats_reset(vita2d_draw_ctx *ctx)
+{
+	sceClibMemset(&ctx->counters, 0, sizeof(vita2d_frame_counters));
+}
+
+void _vita2d_stats_merge(vita2d_draw_ctx *dst, const vita2d_draw_ctx *src)
+{
+	dst->counters.drawCalls += src->counters.drawCalls;
+	dst->counters.vertices += src->counters.vertices;
+	dst->counters.indices += src->counters.indices;
+	dst->counters.programBinds += src->counters.programBinds;
+	dst->counters.textureBinds += src->counters.textureBinds;
+	dst->counters.glyphMisses += src->counters.glyphMisses;
+	dst->counters.textDraws += src->counters.textDraws;
+	dst->counters.clipChanges += src->counters.clipChanges;
+}
+
+static void stats_snapshot(void)
+{
+	const vita2d_frame_counters *counters = &_vita2d_default_ctx.counters;
+	vita2d_pool_stats pool;
+	SceUInt64 frame_time, frame_wait;
+
+	vita2d_get_pool_stats(&pool);
+
+	frame_stats.draw_calls = counters->drawCalls;
+	frame_stats.vertices = counters->vertices;
+	frame_stats.indices = counters->indices;
+	frame_stats.program_binds = counters->programBinds;
+	frame_stats.texture_binds = counters->textureBinds;
+	frame_stats.pool_used = pool.used;
+	frame_stats.pool_high_water = pool.used > pool.high_water ? pool.used : pool.high_water;
+	frame_stats.glyph_misses = counters->glyphMisses;
+	frame_stats.text_draws = counters->textDraws;
+	frame_stats.clip_changes = counters->clipChanges;
+
+	// Waits after the previous snapshot (vita2d_end_shfb()) count for this frame, but not for its CPU time
+	frame_time = stats_frame_start ? sceKernelGetProcessTimeWide() - stats_frame_start : 0;
+	frame_wait = stats_wait - stats_frame_start_wait;
+	frame_stats.cpu_us = frame_time > frame_wait ? (unsigned int)(frame_time - frame_wait) : 0;
+	frame_stats.vblank_wait_us = (unsigned int)stats_wait;
+	stats_wait = 0;
+	stats_frame_start_wait = 0;
+}
+#endif
+
+void vita2d_get_frame_stats(vita2d_frame_stats *stats)
+{
+	if (!stats)
+		return;
+
+#ifndef VITA2D_SYS_NO_STATS
+	*stats = frame_stats;
+#else
+	sceClibMemset(stats, 0, sizeof(vita2d_frame_stats));
+#endif
 }
 
 void vita2d_start_drawing()
 {
-	vita2d_pool_reset();
+#ifndef VITA2D_SYS_NO_STATS
+	stats_frame_start = sceKernelGetProcessTimeWide();
+	stats_frame_start_wait = stats_wait;
+#endif
+	_vita2d_pool_next_frame();
+	_vita2d_batch_reset_stats();
+	_vita2d_state_reset_stats();
+	_vita2d_stats_reset(&_vita2d_default_ctx);
+	cull_stats.drawn = 0;
+	cull_stats.culled = 0;
 	vita2d_start_drawing_advanced(NULL, 0);
 }
 
 void vita2d_start_drawing_advanced(vita2d_texture *target, unsigned int flags)
 {
 	if (system_mode_flag) {
-		sceSharedFbBegin(shfb_id, &info);
+		if (!_vita2d_present_enabled())
+			STATS_WAIT(sceSharedFbBegin(shfb_id, &info));
+		else if (!shfb_acquired) {
+			// Begun by the present thread, only waits if the previous frame is not ended yet
+			STATS_WAIT(_vita2d_present_acquire(&info));
+			shfb_acquired = 1;
+		}
 		info.owner = 1;
 		if (info.curbuf == 1)
 			bufferIndex = 0;
@@ -1487,6 +2205,9 @@ void vita2d_start_drawing_advanced(vita2d_texture *target, unsigned int flags)
 				displayBufferData[bufferIndex]);
 		}
 
+		viewport_w = system_mode_flag ? info.width : display_hres;
+		viewport_h = system_mode_flag ? info.height : display_vres;
+
 		sceGxmBeginScene(
 			_vita2d_context,
 			flags,
@@ -1498,6 +2219,9 @@ void vita2d_start_drawing_advanced(vita2d_texture *target, unsigned int flags)
 			&depthSurface);
 	}
 	else {
+		viewport_w = vita2d_texture_get_width(target);
+		viewport_h = vita2d_texture_get_height(target);
+
 		sceGxmBeginScene(
 			_vita2d_context,
 			flags,
@@ -1509,55 +2233,124 @@ void vita2d_start_drawing_advanced(vita2d_texture *target, unsigned int flags)
 			&target->gxm_sfd);
 	}
 
+	_vita2d_state_invalidate();
+	_vita2d_queue_scene_begin();
+
 	drawing = 1;
+	display_scene = target == NULL;
 	// in the current way, the library keeps the region clip across scenes
-	if (clipping_enabled) {
-		vita2d_set_clip_rectangle(clip_rect_x_min, clip_rect_y_min, clip_rect_x_max, clip_rect_y_max);
+	if (_vita2d_default_ctx.clip.enabled) {
+		vita2d_set_clip_rectangle(
+			_vita2d_default_ctx.clip.x_min,
+			_vita2d_default_ctx.clip.y_min,
+			_vita2d_default_ctx.clip.x_max,
+			_vita2d_default_ctx.clip.y_max);
 	}
 }
 
 void vita2d_end_drawing()
 {
-	sceGxmEndScene(_vita2d_context, NULL, NULL);
+	// Last chance to sample input for this scene, draws made by the callback are still part of it
+	if (display_scene && late_latch_callback)
+		late_latch_callback(late_latch_user_data);
+
+	_vita2d_batch_flush();
+
+	sceGxmEndScene(_vita2d_context, NULL, _vita2d_pool_scene_notification());
 	sceGxmPadHeartbeat(&displaySurface[bufferIndex], displayBufferSync[bufferIndex]);
 
-	if (system_mode_flag && vblank_wait)
-		sceDisplayWaitVblankStart();
+	// Render to texture scenes are not shown, they must not take a swap interval
+	if (display_scene && system_mode_flag && !_vita2d_present_enabled())
+		STATS_WAIT(_vita2d_frame_pacing_wait());
 	drawing = 0;
+
+#ifndef VITA2D_SYS_NO_STATS
+	// Texture scenes add to the counters of the frame they are drawn in
+	if (display_scene)
+		stats_snapshot();
+#endif
 }
 
 void vita2d_end_shfb()
 {
-	if (system_mode_flag)
-		sceSharedFbEnd(shfb_id);
+	if (system_mode_flag) {
+		if (!_vita2d_present_enabled())
+			STATS_WAIT(sceSharedFbEnd(shfb_id));
+		else if (shfb_acquired) {
+			unsigned int pending;
+
+			// The present thread paces and ends the frame while the next one is drawn
+			_vita2d_present_submit();
+			shfb_acquired = 0;
+
+			pending = _vita2d_present_pending();
+			if (pending > displayQueueHighWater)
+				displayQueueHighWater = pending;
+		}
+	}
 	else {
 
-		int oldFb = (bufferIndex + 1) % DISPLAY_BUFFER_COUNT;
+		// previous frame, the one on screen once this one is queued
+		int oldFb = (bufferIndex + displayBufferCount - 1) % displayBufferCount;
+		unsigned int pending;
 
 		// queue the display swap for this frame
 		vita2d_display_data displayData;
 		displayData.address = displayBufferData[bufferIndex];
-		sceGxmDisplayQueueAddEntry(
+		// Blocks while every display buffer is queued, until the display callback shows one
+		STATS_WAIT(sceGxmDisplayQueueAddEntry(
 			displayBufferSync[oldFb],	// OLD fb
 			displayBufferSync[bufferIndex],	// NEW fb
-			&displayData);
+			&displayData));
+
+		displayQueueSubmitted++;
+		pending = displayQueueSubmitted - displayQueueShown;
+		if (pending > displayQueueHighWater)
+			displayQueueHighWater = pending;
 
 		// update buffer indices
-		bufferIndex = (bufferIndex + 1) % DISPLAY_BUFFER_COUNT;
+		bufferIndex = (bufferIndex + 1) % displayBufferCount;
 	}
 }
 
+void vita2d_get_display_queue_stats(vita2d_display_queue_stats *stats)
+{
+	if (!stats)
+		return;
+
+	stats->buffer_count = displayBufferCount;
+	stats->pending = system_mode_flag ? _vita2d_present_pending() : displayQueueSubmitted - displayQueueShown;
+	stats->high_water = displayQueueHighWater;
+}
+
+/*
+ * Clip state belongs to the draw context of the calling thread. Deferred
+ * contexts are only bound while recording, their clip state is applied to
+ * the command list right away.
+ */
+static int ctx_drawing(const vita2d_draw_ctx *ctx)
+{
+	return ctx->deferred || drawing;
+}
+
 void vita2d_enable_clipping()
 {
-	clipping_enabled = 1;
-	vita2d_set_clip_rectangle(clip_rect_x_min, clip_rect_y_min, clip_rect_x_max, clip_rect_y_max);
+	vita2d_draw_ctx *ctx = _vita2d_ctx();
+
+	ctx->clip.enabled = 1;
+	vita2d_set_clip_rectangle(ctx->clip.x_min, ctx->clip.y_min, ctx->clip.x_max, ctx->clip.y_max);
 }
 
 void vita2d_disable_clipping()
 {
-	clipping_enabled = 0;
-	sceGxmSetFrontStencilFunc(
-		_vita2d_context,
+	vita2d_draw_ctx *ctx = _vita2d_ctx();
+
+	ctx->clip.enabled = 0;
+	ctx->clipStencilValid = 0;
+	_vita2d_batch_flush();
+	sceGxmSetRegionClip(ctx->context, SCE_GXM_REGION_CLIP_NONE, 0, 0, 0, 0);
+	VITA2D_STAT_ADD(ctx, clipChanges, 1);
+	_vita2d_set_front_stencil_func(
 		SCE_GXM_STENCIL_FUNC_ALWAYS,
 		SCE_GXM_STENCIL_OP_KEEP,
 		SCE_GXM_STENCIL_OP_KEEP,
@@ -1568,67 +2361,343 @@ void vita2d_disable_clipping()
 
 int vita2d_get_clipping_enabled()
 {
-	return clipping_enabled;
+	return _vita2d_ctx()->clip.enabled;
+}
+
+/*
+ * Clipping is done in three layers:
+ * - the region clip rejects whole tiles outside the clip rectangle,
+ * - axis-aligned quads (rectangles, unrotated textures, text) are clipped on the CPU to the exact rectangle,
+ * - anything else (rotated quads, lines, circles, arrays, clear) asks for the stencil mask,
+ *   which is only written the first time such a draw happens under a given rectangle.
+ */
+
+static void clip_stencil_rectangle(vita2d_draw_ctx *ctx, float x, float y, float w, float h)
+{
+	// Drawn directly, the mask must not end up in a deferred queue or display list
+	vita2d_color_compact_vertex *vertices = (vita2d_color_compact_vertex *)vita2d_pool_memalign(
+		4 * sizeof(vita2d_color_compact_vertex),
+		sizeof(float));
+	if (!vertices)
+		return;
+
+	vertices[0].x = x;
+	vertices[0].y = y;
+	vertices[0].color = 0;
+
+	vertices[1].x = x + w;
+	vertices[1].y = y;
+	vertices[1].color = 0;
+
+	vertices[2].x = x;
+	vertices[2].y = y + h;
+	vertices[2].color = 0;
+
+	vertices[3].x = x + w;
+	vertices[3].y = y + h;
+	vertices[3].color = 0;
+
+	_vita2d_batch_draw_quads(_vita2d_colorCompactVertexProgram, ctx->programs->colorCompact,
+		_vita2d_colorCompactWvpParam, NULL, vertices, sizeof(vita2d_color_compact_vertex), 1, ctx->ortho);
+}
+
+void _vita2d_clip_require_stencil(void)
+{
+	vita2d_draw_ctx *ctx = _vita2d_ctx();
+
+	if (!ctx->clip.enabled || ctx->clipStencilValid || !ctx_drawing(ctx))
+		return;
+
+	ctx->clipStencilValid = 1;
+
+	_vita2d_batch_flush();
+	// clear the stencil buffer to 0
+	_vita2d_set_front_stencil_func(
+		SCE_GXM_STENCIL_FUNC_NEVER,
+		SCE_GXM_STENCIL_OP_ZERO,
+		SCE_GXM_STENCIL_OP_ZERO,
+		SCE_GXM_STENCIL_OP_ZERO,
+		0xFF,
+		0xFF);
+	clip_stencil_rectangle(ctx, 0, 0, display_hres, display_vres);
+	// set the stencil to 1 in the desired region
+	_vita2d_set_front_stencil_func(
+		SCE_GXM_STENCIL_FUNC_NEVER,
+		SCE_GXM_STENCIL_OP_REPLACE,
+		SCE_GXM_STENCIL_OP_REPLACE,
+		SCE_GXM_STENCIL_OP_REPLACE,
+		0xFF,
+		0xFF);
+	clip_stencil_rectangle(ctx, ctx->clip.x_min, ctx->clip.y_min,
+		ctx->clip.x_max - ctx->clip.x_min, ctx->clip.y_max - ctx->clip.y_min);
+	// set the stencil function to only accept pixels where the stencil is 1
+	_vita2d_set_front_stencil_func(
+		SCE_GXM_STENCIL_FUNC_EQUAL,
+		SCE_GXM_STENCIL_OP_KEEP,
+		SCE_GXM_STENCIL_OP_KEEP,
+		SCE_GXM_STENCIL_OP_KEEP,
+		0xFF,
+		0xFF);
+}
+
+static int clip_axis(float *p0, float *p1, float *t0, float *t1, float min, float max)
+{
+	const float p0_in = *p0;
+	const float p1_in = *p1;
+	const float d = p1_in - p0_in;
+
+	// Quads may be mirrored, so p1 is not always the larger one
+	if (d == 0.0f)
+		return 0;
+	if ((d > 0.0f ? p1_in : p0_in) <= min || (d > 0.0f ? p0_in : p1_in) >= max)
+		return 0;
+
+	*p0 = p0_in < min ? min : (p0_in > max ? max : p0_in);
+	*p1 = p1_in < min ? min : (p1_in > max ? max : p1_in);
+
+	if (t0) {
+		const float t0_in = *t0;
+		const float dt = *t1 - t0_in;
+		*t0 = t0_in + dt * (*p0 - p0_in) / d;
+		*t1 = t0_in + dt * (*p1 - p0_in) / d;
+	}
+
+	return 1;
+}
+
+int _vita2d_clip_quad(float *x0, float *y0, float *x1, float *y1, float *u0, float *v0, float *u1, float *v1)
+{
+	const vita2d_clip_state *clip = &_vita2d_ctx()->clip;
+
+	if (!clip->enabled)
+		return 1;
+
+	if (!clip_axis(x0, x1, u0, u1, clip->x_min, clip->x_max))
+		return 0;
+
+	return clip_axis(y0, y1, v0, v1, clip->y_min, clip->y_max);
 }
 
 void vita2d_set_clip_rectangle(int x_min, int y_min, int x_max, int y_max)
 {
-	clip_rect_x_min = x_min;
-	clip_rect_y_min = y_min;
-	clip_rect_x_max = x_max;
-	clip_rect_y_max = y_max;
+	vita2d_draw_ctx *ctx = _vita2d_ctx();
+
+	ctx->clip.x_min = x_min;
+	ctx->clip.y_min = y_min;
+	ctx->clip.x_max = x_max;
+	ctx->clip.y_max = y_max;
 	// we can only draw during a scene, but we can cache the values since they're not going to have any visible effect till the scene starts anyways
-	if (drawing) {
-		// clear the stencil buffer to 0
-		sceGxmSetFrontStencilFunc(
-			_vita2d_context,
-			SCE_GXM_STENCIL_FUNC_NEVER,
-			SCE_GXM_STENCIL_OP_ZERO,
-			SCE_GXM_STENCIL_OP_ZERO,
-			SCE_GXM_STENCIL_OP_ZERO,
-			0xFF,
-			0xFF);
-		vita2d_draw_rectangle(0, 0, display_hres, display_vres, 0);
-		// set the stencil to 1 in the desired region
-		sceGxmSetFrontStencilFunc(
-			_vita2d_context,
-			SCE_GXM_STENCIL_FUNC_NEVER,
-			SCE_GXM_STENCIL_OP_REPLACE,
-			SCE_GXM_STENCIL_OP_REPLACE,
-			SCE_GXM_STENCIL_OP_REPLACE,
+	if (ctx_drawing(ctx)) {
+		_vita2d_batch_flush();
+		ctx->clipStencilValid = 0;
+		VITA2D_STAT_ADD(ctx, clipChanges, 1);
+		if (ctx->clip.enabled) {
+			// region clip works on whole tiles, expand the rectangle to the tiles it touches
+			int tile_x_min = x_min < 0 ? 0 : x_min & ~(SCE_GXM_TILE_SIZEX - 1);
+			int tile_y_min = y_min < 0 ? 0 : y_min & ~(SCE_GXM_TILE_SIZEY - 1);
+			int tile_x_max = ALIGN(x_max, SCE_GXM_TILE_SIZEX) - 1;
+			int tile_y_max = ALIGN(y_max, SCE_GXM_TILE_SIZEY) - 1;
+			if (tile_x_max < tile_x_min)
+				tile_x_max = tile_x_min;
+			if (tile_y_max < tile_y_min)
+				tile_y_max = tile_y_min;
+			sceGxmSetRegionClip(ctx->context, SCE_GXM_REGION_CLIP_OUTSIDE, tile_x_min, tile_y_min, tile_x_max, tile_y_max);
+		}
+		// the stencil mask is written on demand by _vita2d_clip_require_stencil()
+		_vita2d_set_front_stencil_func(
+			SCE_GXM_STENCIL_FUNC_ALWAYS,
+			SCE_GXM_STENCIL_OP_KEEP,
+			SCE_GXM_STENCIL_OP_KEEP,
+			SCE_GXM_STENCIL_OP_KEEP,
 			0xFF,
 			0xFF);
-		vita2d_draw_rectangle(x_min, y_min, x_max - x_min, y_max - y_min, 0);
-		if (clipping_enabled) {
-			// set the stencil function to only accept pixels where the stencil is 1
-			sceGxmSetFrontStencilFunc(
-				_vita2d_context,
-				SCE_GXM_STENCIL_FUNC_EQUAL,
-				SCE_GXM_STENCIL_OP_KEEP,
-				SCE_GXM_STENCIL_OP_KEEP,
-				SCE_GXM_STENCIL_OP_KEEP,
-				0xFF,
-				0xFF);
-		}
-		else {
-			sceGxmSetFrontStencilFunc(
-				_vita2d_context,
-				SCE_GXM_STENCIL_FUNC_ALWAYS,
-				SCE_GXM_STENCIL_OP_KEEP,
-				SCE_GXM_STENCIL_OP_KEEP,
-				SCE_GXM_STENCIL_OP_KEEP,
-				0xFF,
-				0xFF);
-		}
 	}
 }
 
 void vita2d_get_clip_rectangle(int *x_min, int *y_min, int *x_max, int *y_max)
 {
-	*x_min = clip_rect_x_min;
-	*y_min = clip_rect_y_min;
-	*x_max = clip_rect_x_max;
-	*y_max = clip_rect_y_max;
+	const vita2d_clip_state *clip = &_vita2d_ctx()->clip;
+
+	*x_min = clip->x_min;
+	*y_min = clip->y_min;
+	*x_max = clip->x_max;
+	*y_max = clip->y_max;
+}
+
+void _vita2d_clip_restore(void)
+{
+	vita2d_draw_ctx *ctx = _vita2d_ctx();
+
+	// Executed command lists leave the stencil and region clip state unknown
+	ctx->clipStencilValid = 0;
+
+	if (ctx->clip.enabled)
+		vita2d_set_clip_rectangle(ctx->clip.x_min, ctx->clip.y_min, ctx->clip.x_max, ctx->clip.y_max);
+	else
+		vita2d_disable_clipping();
+}
+
+void _vita2d_ctx_reset(vita2d_draw_ctx *ctx)
+{
+	// Normal blending is created by init, picking it does not touch the shader patcher
+	ctx->programs = &fragment_programs[VITA2D_BLEND_MODE_NORMAL];
+	ctx->blendMode = VITA2D_BLEND_MODE_NORMAL;
+
+	ctx->clip.enabled = 0;
+	ctx->clip.x_min = 0;
+	ctx->clip.y_min = 0;
+	ctx->clip.x_max = display_hres;
+	ctx->clip.y_max = display_vres;
+	ctx->clipStencilValid = 0;
+	ctx->clipStackDepth = 0;
+
+	matrix_copy(ctx->ortho, _vita2d_default_ctx.ortho);
+}
+
+int _vita2d_clip_test(float x_min, float y_min, float x_max, float y_max)
+{
+	const vita2d_clip_state *clip = &_vita2d_ctx()->clip;
+
+	if (!clip->enabled)
+		return VITA2D_CLIP_INSIDE;
+
+	if (x_max <= clip->x_min || x_min >= clip->x_max
+		|| y_max <= clip->y_min || y_min >= clip->y_max)
+		return VITA2D_CLIP_OUTSIDE;
+
+	if (x_min >= clip->x_min && x_max <= clip->x_max
+		&& y_min >= clip->y_min && y_max <= clip->y_max)
+		return VITA2D_CLIP_INSIDE;
+
+	return VITA2D_CLIP_PARTIAL;
+}
+
+int _vita2d_visibility(float x_min, float y_min, float x_max, float y_max)
+{
+	int result;
+	float t;
+
+	// Mirrored quads come with swapped bounds
+	if (x_max < x_min) {
+		t = x_min;
+		x_min = x_max;
+		x_max = t;
+	}
+	if (y_max < y_min) {
+		t = y_min;
+		y_min = y_max;
+		y_max = t;
+	}
+
+	result = _vita2d_clip_test(x_min, y_min, x_max, y_max);
+
+	if (!culling_enabled)
+		return result;
+
+	if (result != VITA2D_CLIP_OUTSIDE
+		&& (x_max <= 0.0f || y_max <= 0.0f || x_min >= viewport_w || y_min >= viewport_h))
+		result = VITA2D_CLIP_OUTSIDE;
+
+	// Counted for the rendering thread only
+	if (_vita2d_ctx()->deferred)
+		return result;
+
+	if (result == VITA2D_CLIP_OUTSIDE)
+		cull_stats.culled++;
+	else
+		cull_stats.drawn++;
+
+	return result;
+}
+
+void vita2d_set_culling(int enable)
+{
+	culling_enabled = enable;
+}
+
+int vita2d_get_culling_enabled()
+{
+	return culling_enabled;
+}
+
+void vita2d_get_cull_stats(vita2d_cull_stats *stats)
+{
+	if (stats)
+		*stats = cull_stats;
+}
+
+static void clip_apply(vita2d_draw_ctx *ctx, const vita2d_clip_state *clip)
+{
+	// Nested views often push the same effective rectangle, leave the GPU state alone then
+	if (clip->enabled == ctx->clip.enabled && (!clip->enabled
+		|| (clip->x_min == ctx->clip.x_min && clip->y_min == ctx->clip.y_min
+		&& clip->x_max == ctx->clip.x_max && clip->y_max == ctx->clip.y_max)))
+		return;
+
+	if (clip->enabled) {
+		ctx->clip.enabled = 1;
+		vita2d_set_clip_rectangle(clip->x_min, clip->y_min, clip->x_max, clip->y_max);
+	}
+	else {
+		ctx->clip = *clip;
+		vita2d_disable_clipping();
+	}
+}
+
+int vita2d_push_clip(int x_min, int y_min, int x_max, int y_max)
+{
+	vita2d_draw_ctx *ctx = _vita2d_ctx();
+	vita2d_clip_state clip;
+
+	if (ctx->clipStackDepth == CLIP_STACK_DEPTH) {
+		SCE_DBG_LOG_ERROR("vita2d_push_clip(): clip stack is full");
+		return VITA2D_SYS_ERROR_STACK_OVERFLOW;
+	}
+
+	ctx->clipStack[ctx->clipStackDepth] = ctx->clip;
+	ctx->clipStackDepth++;
+
+	clip.enabled = 1;
+	clip.x_min = x_min;
+	clip.y_min = y_min;
+	clip.x_max = x_max;
+	clip.y_max = y_max;
+
+	if (ctx->clip.enabled) {
+		if (clip.x_min < ctx->clip.x_min)
+			clip.x_min = ctx->clip.x_min;
+		if (clip.y_min < ctx->clip.y_min)
+			clip.y_min = ctx->clip.y_min;
+		if (clip.x_max > ctx->clip.x_max)
+			clip.x_max = ctx->clip.x_max;
+		if (clip.y_max > ctx->clip.y_max)
+			clip.y_max = ctx->clip.y_max;
+	}
+
+	// Disjoint rectangles leave an empty clip
+	if (clip.x_max < clip.x_min)
+		clip.x_max = clip.x_min;
+	if (clip.y_max < clip.y_min)
+		clip.y_max = clip.y_min;
+
+	clip_apply(ctx, &clip);
+
+	return SCE_OK;
+}
+
+int vita2d_pop_clip()
+{
+	vita2d_draw_ctx *ctx = _vita2d_ctx();
+
+	if (ctx->clipStackDepth == 0) {
+		SCE_DBG_LOG_ERROR("vita2d_pop_clip(): clip stack is empty");
+		return VITA2D_SYS_ERROR_STACK_UNDERFLOW;
+	}
+
+	ctx->clipStackDepth--;
+	clip_apply(ctx, &ctx->clipStack[ctx->clipStackDepth]);
+
+	return SCE_OK;
 }
 
 int vita2d_common_dialog_update()
@@ -1677,7 +2746,64 @@ unsigned int vita2d_get_clear_color()
 
 void vita2d_set_vblank_wait(int enable)
 {
-	vblank_wait = enable;
+	swap_interval = enable ? 1 : 0;
+}
+
+int vita2d_set_swap_interval(unsigned int interval)
+{
+	if (interval > SWAP_INTERVAL_MAX)
+		return VITA2D_SYS_ERROR_INVALID_ARGUMENT;
+
+	swap_interval = interval;
+
+	return SCE_OK;
+}
+
+unsigned int vita2d_get_swap_interval()
+{
+	return swap_interval;
+}
+
+void vita2d_set_adaptive_vsync(int enable)
+{
+	adaptive_vsync = enable;
+}
+
+int vita2d_get_adaptive_vsync()
+{
+	return adaptive_vsync;
+}
+
+void vita2d_set_late_latch_callback(vita2d_late_latch_callback callback, void *user_data)
+{
+	late_latch_callback = callback;
+	late_latch_user_data = user_data;
+}
+
+void vita2d_get_frame_interval_stats(vita2d_frame_interval_stats *stats)
+{
+	unsigned int seq;
+
+	if (!stats)
+		return;
+
+	do {
+		// The writer may be preempted by this thread, don't spin on it
+		while ((seq = pacing_seq) & 1)
+			sceKernelDelayThread(100);
+		__sync_synchronize();
+		*stats = frame_interval_stats;
+		__sync_synchronize();
+	} while (seq != pacing_seq);
+
+	if (pacing_reset)
+		sceClibMemset(stats, 0, sizeof(vita2d_frame_interval_stats));
+}
+
+void vita2d_reset_frame_interval_stats()
+{
+	// Done by the thread showing frames before it records the next one
+	pacing_reset = 1;
 }
 
 SceUID vita2d_get_shfbid()
@@ -1687,6 +2813,13 @@ SceUID vita2d_get_shfbid()
 
 SceGxmContext *vita2d_get_context()
 {
+	// Caller may issue GXM commands directly, submit what was queued so far
+	// and leave the context in its default polygon mode. The stencil mask of
+	// an unaligned clip rectangle is written now, raw draws are clipped by it.
+	_vita2d_clip_require_stencil();
+	_vita2d_batch_flush();
+	_vita2d_set_front_polygon_mode(SCE_GXM_POLYGON_MODE_TRIANGLE_FILL);
+	_vita2d_state_invalidate();
 	return _vita2d_context;
 }
 
@@ -1702,48 +2835,48 @@ const uint16_t *vita2d_get_linear_indices()
 
 void vita2d_set_region_clip(SceGxmRegionClipMode mode, unsigned int x_min, unsigned int y_min, unsigned int x_max, unsigned int y_max)
 {
+	_vita2d_batch_flush();
 	sceGxmSetRegionClip(_vita2d_context, mode, x_min, y_min, x_max, y_max);
+	VITA2D_STAT_ADD(&_vita2d_default_ctx, clipChanges, 1);
 }
 
-void *vita2d_pool_malloc(unsigned int size)
+int vita2d_set_blend_mode(vita2d_blend_mode mode)
 {
-	if ((pool_index + size) < init_param_s.temp_pool_size) {
-		void *addr = (void *)((unsigned int)poolMem->mappedBase + pool_index);
-		pool_index += size;
-		return addr;
-	}
-	return NULL;
-}
+	int err;
 
-void *vita2d_pool_memalign(unsigned int size, unsigned int alignment)
-{
-	unsigned int new_index = (pool_index + alignment - 1) & ~(alignment - 1);
-	if ((new_index + size) < init_param_s.temp_pool_size) {
-		void *addr = (void *)((unsigned int)poolMem->mappedBase + new_index);
-		pool_index = new_index + size;
-		return addr;
+	vita2d_draw_ctx *ctx = _vita2d_ctx();
+
+	if ((unsigned int)mode >= VITA2D_BLEND_MODE_COUNT)
+		return VITA2D_SYS_ERROR_INVALID_ARGUMENT;
+
+	if (!(fragment_programs_created & (1 << mode))) {
+		// The shader patcher belongs to the rendering thread
+		if (ctx->deferred) {
+			SCE_DBG_LOG_ERROR("vita2d_set_blend_mode(): blend mode %d was never selected on the rendering thread", mode);
+			return VITA2D_SYS_ERROR_INVALID_STATE;
+		}
+
+		err = _vita2d_make_fragment_programs(&fragment_programs[mode],
+			mode == VITA2D_BLEND_MODE_OPAQUE ? NULL : &blend_infos[mode], msaa_s);
+		if (err != SCE_OK)
+			return err;
+		fragment_programs_created |= 1 << mode;
 	}
-	return NULL;
-}
 
-unsigned int vita2d_pool_free_space()
-{
-	return init_param_s.temp_pool_size - pool_index;
+	ctx->programs = &fragment_programs[mode];
+	ctx->blendMode = mode;
+
+	return SCE_OK;
 }
 
-void vita2d_pool_reset()
+vita2d_blend_mode vita2d_get_blend_mode()
 {
-	pool_index = 0;
+	return _vita2d_ctx()->blendMode;
 }
 
 void vita2d_set_blend_mode_add(int enable)
 {
-	vita2d_fragment_programs *in = enable ? &_vita2d_fragmentPrograms.blend_mode_add
-		: &_vita2d_fragmentPrograms.blend_mode_normal;
-
-	_vita2d_colorFragmentProgram = in->color;
-	_vita2d_textureFragmentProgram = in->texture;
-	_vita2d_textureTintFragmentProgram = in->textureTint;
+	vita2d_set_blend_mode(enable ? VITA2D_BLEND_MODE_ADD : VITA2D_BLEND_MODE_NORMAL);
 }
 
 int vita2d_check_version(int vita2d_version)
@@ -0,0 +1,211 @@
+#include <kernel.h>
+#include <libdbg.h>
+#include "vita2d_sys.h"
+
+#include "shared.h"
+
+/*
+ * Quad batcher.
+ *
+ * Consecutive quads that share vertex program, fragment program and texture
+ * are written back-to-back into the temp pool and submitted with a single
+ * indexed triangle-list draw. Any change of state, non-contiguous pool
+ * allocation or direct draw flushes the pending batch first. Every draw
+ * context batches on its own.
+ */
+
+#define BATCH_MAX_QUADS		4096
+
+static SceGxmDeviceMemInfo *quadIndicesMem = NULL;
+static uint16_t *quadIndices = NULL;
+
+int _vita2d_batch_init(void)
+{
+	int err;
+	unsigned int i;
+
+	err = sceGxmAllocDeviceMemLinux(
+		SCE_GXM_DEVICE_HEAP_ID_USER_NC,
+		SCE_GXM_MEMORY_ATTRIB_READ,
+		BATCH_MAX_QUADS * 6 * sizeof(uint16_t),
+		sizeof(uint16_t),
+		&quadIndicesMem);
+
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("[BATCH] sceGxmAllocDeviceMemLinux(): 0x%X", err);
+		return err;
+	}
+
+	quadIndices = (uint16_t *)(quadIndicesMem->mappedBase);
+
+	// 0-1-2, 2-1-3 for every quad, matching the triangle strip vertex order
+	for (i = 0; i < BATCH_MAX_QUADS; i++) {
+		quadIndices[i * 6 + 0] = i * 4 + 0;
+		quadIndices[i * 6 + 1] = i * 4 + 1;
+		quadIndices[i * 6 + 2] = i * 4 + 2;
+		quadIndices[i * 6 + 3] = i * 4 + 2;
+		quadIndices[i * 6 + 4] = i * 4 + 1;
+		quadIndices[i * 6 + 5] = i * 4 + 3;
+	}
+
+	sceClibMemset(&_vita2d_default_ctx.batch, 0, sizeof(vita2d_batch));
+
+	return SCE_OK;
+}
+
+void _vita2d_batch_fini(void)
+{
+	sceGxmFreeDeviceMemLinux(quadIndicesMem);
+	quadIndicesMem = NULL;
+	quadIndices = NULL;
+}
+
+void _vita2d_draw(SceGxmPrimitiveType type, const void *indices, unsigned int count, unsigned int vertexCount)
+{
+	vita2d_draw_ctx *ctx = _vita2d_ctx();
+
+	sceGxmDraw(ctx->context, type, SCE_GXM_INDEX_FORMAT_U16, indices, count);
+	ctx->drawCallCount++;
+	VITA2D_STAT_ADD(ctx, drawCalls, 1);
+	VITA2D_STAT_ADD(ctx, vertices, vertexCount);
+	VITA2D_STAT_ADD(ctx, indices, count);
+}
+
+void _vita2d_draw_u32(SceGxmPrimitiveType type, const void *indices, unsigned int count, unsigned int vertexCount)
+{
+	vita2d_draw_ctx *ctx = _vita2d_ctx();
+
+	sceGxmDraw(ctx->context, type, SCE_GXM_INDEX_FORMAT_U32, indices, count);
+	ctx->drawCallCount++;
+	VITA2D_STAT_ADD(ctx, drawCalls, 1);
+	VITA2D_STAT_ADD(ctx, vertices, vertexCount);
+	VITA2D_STAT_ADD(ctx, indices, count);
+}
+
+void _vita2d_draw_instanced(const void *indices, unsigned int count, unsigned int wrap, unsigned int vertexCount)
+{
+	vita2d_draw_ctx *ctx = _vita2d_ctx();
+
+	sceGxmDrawInstanced(ctx->context, SCE_GXM_PRIMITIVE_TRIANGLES, SCE_GXM_INDEX_FORMAT_U16, indices, count, wrap);
+	ctx->drawCallCount++;
+	VITA2D_STAT_ADD(ctx, drawCalls, 1);
+	VITA2D_STAT_ADD(ctx, vertices, vertexCount);
+	VITA2D_STAT_ADD(ctx, indices, count);
+}
+
+void _vita2d_batch_draw_quads(const SceGxmVertexProgram *vertexProgram, const SceGxmFragmentProgram *fragmentProgram,
+	const SceGxmProgramParameter *wvpParam, const SceGxmTexture *texture, const void *vertices, unsigned int stride, unsigned int count,
+	const float *wvp)
+{
+	_vita2d_set_vertex_program(vertexProgram);
+	_vita2d_set_fragment_program(fragmentProgram);
+	_vita2d_set_wvp(wvpParam, wvp);
+
+	// Set the texture to the TEXUNIT0
+	if (texture)
+		_vita2d_set_fragment_texture(texture);
+
+	_vita2d_set_front_polygon_mode(SCE_GXM_POLYGON_MODE_TRIANGLE_FILL);
+
+	// The index buffer covers BATCH_MAX_QUADS quads
+	while (count) {
+		unsigned int n = count > BATCH_MAX_QUADS ? BATCH_MAX_QUADS : count;
+
+		_vita2d_set_vertex_stream(0, vertices);
+		_vita2d_draw(SCE_GXM_PRIMITIVE_TRIANGLES, quadIndices, n * 6, n * 4);
+
+		vertices = (const void *)((unsigned int)vertices + n * 4 * stride);
+		count -= n;
+	}
+}
+
+void _vita2d_batch_flush(void)
+{
+	vita2d_draw_ctx *ctx = _vita2d_ctx();
+	vita2d_batch *batch = &ctx->batch;
+
+	// In deferred mode every flush point is a barrier for the queue
+	if (!ctx->deferred && _vita2d_queue_enabled()) {
+		_vita2d_queue_submit();
+		return;
+	}
+
+	if (batch->quadCount == 0)
+		return;
+
+	_vita2d_batch_draw_quads(batch->vertexProgram, batch->fragmentProgram, batch->wvpParam,
+		batch->texture, batch->vertices, batch->stride, batch->quadCount, ctx->ortho);
+
+	batch->quadCount = 0;
+}
+
+void _vita2d_batch_flush_texture(const SceGxmTexture *texture)
+{
+	vita2d_draw_ctx *ctx = _vita2d_ctx();
+
+	if (!ctx->deferred && _vita2d_queue_enabled())
+		_vita2d_queue_submit();
+	else if (ctx->batch.quadCount && ctx->batch.texture == texture)
+		_vita2d_batch_flush();
+}
+
+void *_vita2d_batch_alloc_quads(const SceGxmVertexProgram *vertexProgram, const SceGxmFragmentProgram *fragmentProgram,
+	const SceGxmProgramParameter *wvpParam, const SceGxmTexture *texture, unsigned int stride, unsigned int count)
+{
+	vita2d_draw_ctx *ctx = _vita2d_ctx();
+	vita2d_batch *batch = &ctx->batch;
+
+	// Display lists and the deferred queue belong to the rendering thread
+	if (!ctx->deferred) {
+		if (_vita2d_display_list_recording())
+			return _vita2d_display_list_alloc_quads(vertexProgram, fragmentProgram, wvpParam, texture, stride, count);
+
+		if (_vita2d_queue_enabled())
+			return _vita2d_queue_alloc_quads(vertexProgram, fragmentProgram, wvpParam, texture, stride, count);
+	}
+
+	if (batch->quadCount) {
+		if (batch->vertexProgram != vertexProgram
+			|| batch->fragmentProgram != fragmentProgram
+			|| batch->texture != texture
+			|| batch->quadCount + count > BATCH_MAX_QUADS)
+			_vita2d_batch_flush();
+	}
+
+	void *vertices = vita2d_pool_memalign(count * 4 * stride, sizeof(float));
+	if (!vertices)
+		return NULL;
+
+	// User pool allocations between two quads break contiguity
+	if (batch->quadCount && vertices != batch->verticesEnd)
+		_vita2d_batch_flush();
+
+	if (batch->quadCount == 0) {
+		batch->vertexProgram = vertexProgram;
+		batch->fragmentProgram = fragmentProgram;
+		batch->wvpParam = wvpParam;
+		batch->texture = texture;
+		batch->vertices = vertices;
+		batch->stride = stride;
+	}
+
+	batch->quadCount += count;
+	batch->verticesEnd = (void *)((unsigned int)vertices + count * 4 * stride);
+
+	return vertices;
+}
+
+void _vita2d_batch_reset_stats(void)
+{
+	_vita2d_ctx()->drawCallCount = 0;
+}
+
+void vita2d_batch_flush()
+{
+	_vita2d_batch_flush();
+}
+
+unsigned int vita2d_get_draw_call_count()
+{
+	return _vita2d_ctx()->drawCallCount;
+}
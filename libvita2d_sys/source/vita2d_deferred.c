@@ -0,0 +1,336 @@
+#include <kernel.h>
+#include <gxm.h>
+#include <libdbg.h>
+#include "vita2d_sys.h"
+
+#include "utils.h"
+#include "shared.h"
+#include "heap.h"
+
+extern void* vita2d_heap_internal;
+
+/*
+ * Deferred contexts.
+ *
+ * A deferred context wraps a GXM deferred context and a draw context of its
+ * own, so worker threads can build command lists with the regular drawing
+ * functions while the rendering thread keeps drawing into _vita2d_context.
+ * Beginning a recording binds the context to the calling thread, every
+ * internal lookup of the draw context (_vita2d_ctx()) then resolves to it on
+ * that thread only. Blend mode, clip and projection are reset at the start of
+ * each recording, so a command list does not depend on the thread that
+ * recorded it before.
+ *
+ * The pool slice is split in two halves used in turn, one can be recorded
+ * while the command list of the other is still read by the GPU. VDM, vertex
+ * and fragment memory GXM asks for while recording comes from the same half.
+ */
+
+#define DEFERRED_MAX_CONTEXTS		8
+#define DEFERRED_DEFAULT_POOL_SIZE	(256 * 1024)
+#define DEFERRED_POOL_ALIGN			256
+#define DEFERRED_CALLBACK_SIZE		(16 * 1024)
+#define DEFERRED_HALF_COUNT			2
+
+enum {
+	DEFERRED_STATUS_IDLE,
+	DEFERRED_STATUS_RECORDING,
+	DEFERRED_STATUS_RECORDED
+};
+
+struct vita2d_deferred_context {
+	vita2d_draw_ctx ctx;
+	void *hostMem;
+	SceGxmDeviceMemInfo *mem;
+	unsigned int halfSize;
+	unsigned int half;
+	int halfExecuted[DEFERRED_HALF_COUNT];
+	unsigned int halfSerial[DEFERRED_HALF_COUNT];	// Pool frame of the last execution
+	SceGxmCommandList list;
+	int status;
+	SceUID thread;				// Thread recording into the context
+};
+
+// Written by the rendering thread only, looked up by every thread
+static vita2d_deferred_context *contexts[DEFERRED_MAX_CONTEXTS];
+// Recordings in progress, changed by the recording threads
+static volatile unsigned int recording_count = 0;
+
+vita2d_draw_ctx *_vita2d_ctx(void)
+{
+	SceUID thread;
+	unsigned int i;
+
+	// A thread only gets its own context while it records, which it counted before
+	if (!recording_count)
+		return &_vita2d_default_ctx;
+
+	thread = sceKernelGetThreadId();
+
+	for (i = 0; i < DEFERRED_MAX_CONTEXTS; i++) {
+		vita2d_deferred_context *context = contexts[i];
+		if (context && context->thread == thread)
+			return &context->ctx;
+	}
+
+	return &_vita2d_default_ctx;
+}
+
+static void *deferred_callback(void *userData, uint32_t minSize, uint32_t *size)
+{
+	vita2d_draw_ctx *ctx = &((vita2d_deferred_context *)userData)->ctx;
+	unsigned int index = ALIGN(ctx->sliceIndex, DEFERRED_POOL_ALIGN);
+	unsigned int available;
+
+	if (index + minSize > ctx->sliceSize) {
+		SCE_DBG_LOG_ERROR("[DEFERRED] pool slice is too small");
+		return NULL;
+	}
+
+	// Hand out more than asked for, fewer callbacks while recording
+	available = ctx->sliceSize - index;
+	*size = available < DEFERRED_CALLBACK_SIZE ? available : (minSize > DEFERRED_CALLBACK_SIZE ? minSize : DEFERRED_CALLBACK_SIZE);
+	ctx->sliceIndex = index + *size;
+
+	return (void *)(ctx->sliceBase + index);
+}
+
+vita2d_deferred_context *vita2d_create_deferred_context(unsigned int pool_size)
+{
+	SceGxmDeferredContextParams params;
+	vita2d_deferred_context *context;
+	unsigned int i;
+	int err;
+
+	for (i = 0; i < DEFERRED_MAX_CONTEXTS; i++) {
+		if (!contexts[i])
+			break;
+	}
+
+	if (i == DEFERRED_MAX_CONTEXTS) {
+		SCE_DBG_LOG_ERROR("[DEFERRED] too many deferred contexts");
+		return NULL;
+	}
+
+	if (!pool_size)
+		pool_size = DEFERRED_DEFAULT_POOL_SIZE;
+
+	context = heap_alloc_heap_memory(vita2d_heap_internal, sizeof(*context));
+	if (!context) {
+		SCE_DBG_LOG_ERROR("[DEFERRED] heap_alloc_heap_memory() returned NULL");
+		return NULL;
+	}
+
+	sceClibMemset(context, 0, sizeof(*context));
+	context->thread = SCE_UID_INVALID_UID;
+	context->ctx.deferred = 1;
+	context->halfSize = ALIGN(pool_size / DEFERRED_HALF_COUNT, DEFERRED_POOL_ALIGN);
+
+	context->hostMem = heap_alloc_heap_memory(vita2d_heap_internal, SCE_GXM_MINIMUM_CONTEXT_HOST_MEM_SIZE);
+	if (!context->hostMem) {
+		SCE_DBG_LOG_ERROR("[DEFERRED] heap_alloc_heap_memory() returned NULL");
+		goto _create_error_free_context;
+	}
+
+	err = sceGxmAllocDeviceMemLinux(
+		SCE_GXM_DEVICE_HEAP_ID_USER_NC,
+		SCE_GXM_MEMORY_ATTRIB_READ,
+		context->halfSize * DEFERRED_HALF_COUNT,
+		DEFERRED_POOL_ALIGN,
+		&context->mem);
+
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("[DEFERRED] sceGxmAllocDeviceMemLinux(): 0x%X", err);
+		goto _create_error_free_host;
+	}
+
+	sceClibMemset(&params, 0, sizeof(params));
+	params.hostMem = context->hostMem;
+	params.hostMemSize = SCE_GXM_MINIMUM_CONTEXT_HOST_MEM_SIZE;
+	params.vdmCallback = deferred_callback;
+	params.vertexCallback = deferred_callback;
+	params.fragmentCallback = deferred_callback;
+	params.userData = context;
+
+	err = sceGxmCreateDeferredContext(&params, &context->ctx.context);
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("[DEFERRED] sceGxmCreateDeferredContext(): 0x%X", err);
+		goto _create_error_free_mem;
+	}
+
+	contexts[i] = context;
+
+	return context;
+
+_create_error_free_mem:
+	sceGxmFreeDeviceMemLinux(context->mem);
+_create_error_free_host:
+	heap_free_heap_memory(vita2d_heap_internal, context->hostMem);
+_create_error_free_context:
+	heap_free_heap_memory(vita2d_heap_internal, context);
+
+	return NULL;
+}
+
+int vita2d_free_deferred_context(vita2d_deferred_context *context)
+{
+	unsigned int i;
+
+	if (!context)
+		return VITA2D_SYS_ERROR_INVALID_POINTER;
+
+	if (context->status == DEFERRED_STATUS_RECORDING)
+		return VITA2D_SYS_ERROR_INVALID_STATE;
+
+	for (i = 0; i < DEFERRED_MAX_CONTEXTS; i++) {
+		if (contexts[i] == context) {
+			contexts[i] = NULL;
+			break;
+		}
+	}
+
+	// The GPU may still read a command list executed in the last frames
+	for (i = 0; i < DEFERRED_HALF_COUNT; i++) {
+		if (context->halfExecuted[i] && !_vita2d_pool_frame_done(context->halfSerial[i])) {
+			sceGxmFinish(_vita2d_context);
+			break;
+		}
+	}
+
+	sceGxmDestroyDeferredContext(context->ctx.context);
+	sceGxmFreeDeviceMemLinux(context->mem);
+	_vita2d_polyline_release(&context->ctx);
+	heap_free_heap_memory(vita2d_heap_internal, context->hostMem);
+	heap_free_heap_memory(vita2d_heap_internal, context);
+
+	return SCE_OK;
+}
+
+void _vita2d_deferred_fini(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < DEFERRED_MAX_CONTEXTS; i++) {
+		if (contexts[i])
+			vita2d_free_deferred_context(contexts[i]);
+	}
+}
+
+int vita2d_deferred_context_begin(vita2d_deferred_context *context)
+{
+	vita2d_draw_ctx *ctx;
+	unsigned int half;
+	int err;
+
+	if (!context)
+		return VITA2D_SYS_ERROR_INVALID_POINTER;
+
+	if (context->status == DEFERRED_STATUS_RECORDING)
+		return VITA2D_SYS_ERROR_INVALID_STATE;
+
+	half = (context->half + 1) % DEFERRED_HALF_COUNT;
+
+	// Recording ahead of the GPU would overwrite vertices it has not read yet
+	if (context->halfExecuted[half] && !_vita2d_pool_frame_done(context->halfSerial[half]))
+		return VITA2D_SYS_ERROR_INVALID_STATE;
+
+	ctx = &context->ctx;
+	ctx->sliceBase = (unsigned int)context->mem->mappedBase + half * context->halfSize;
+	ctx->sliceSize = context->halfSize;
+	ctx->sliceIndex = 0;
+
+	err = sceGxmBeginCommandList(ctx->context);
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("[DEFERRED] sceGxmBeginCommandList(): 0x%X", err);
+		return err;
+	}
+
+	context->half = half;
+	context->halfExecuted[half] = 0;
+	context->status = DEFERRED_STATUS_RECORDING;
+
+	// Command lists start without state, nothing set on another context applies
+	sceClibMemset(&ctx->state, 0, sizeof(ctx->state));
+	sceClibMemset(&ctx->batch, 0, sizeof(ctx->batch));
+	ctx->stateStats.issued = 0;
+	ctx->stateStats.elided = 0;
+	ctx->drawCallCount = 0;
+	_vita2d_stats_reset(ctx);
+	_vita2d_ctx_reset(ctx);
+
+	__sync_fetch_and_add(&recording_count, 1);
+	context->thread = sceKernelGetThreadId();
+
+	sceGxmSetRegionClip(ctx->context, SCE_GXM_REGION_CLIP_NONE, 0, 0, 0, 0);
+
+	_vita2d_set_front_polygon_mode(SCE_GXM_POLYGON_MODE_TRIANGLE_FILL);
+	_vita2d_set_back_polygon_mode(SCE_GXM_POLYGON_MODE_TRIANGLE_FILL);
+	_vita2d_set_front_stencil_func(
+		SCE_GXM_STENCIL_FUNC_ALWAYS,
+		SCE_GXM_STENCIL_OP_KEEP,
+		SCE_GXM_STENCIL_OP_KEEP,
+		SCE_GXM_STENCIL_OP_KEEP,
+		0xFF,
+		0xFF);
+	_vita2d_set_depth_func(SCE_GXM_DEPTH_FUNC_ALWAYS, SCE_GXM_DEPTH_WRITE_DISABLED);
+
+	return SCE_OK;
+}
+
+int vita2d_deferred_context_end(vita2d_deferred_context *context)
+{
+	int err;
+
+	if (!context)
+		return VITA2D_SYS_ERROR_INVALID_POINTER;
+
+	if (context->status != DEFERRED_STATUS_RECORDING || context->thread != sceKernelGetThreadId())
+		return VITA2D_SYS_ERROR_INVALID_STATE;
+
+	_vita2d_batch_flush();
+
+	context->thread = SCE_UID_INVALID_UID;
+	__sync_fetch_and_sub(&recording_count, 1);
+
+	err = sceGxmEndCommandList(context->ctx.context, &context->list);
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("[DEFERRED] sceGxmEndCommandList(): 0x%X", err);
+		context->status = DEFERRED_STATUS_IDLE;
+		return err;
+	}
+
+	context->status = DEFERRED_STATUS_RECORDED;
+
+	return SCE_OK;
+}
+
+int vita2d_deferred_context_execute(vita2d_deferred_context *context)
+{
+	int err;
+
+	if (!context)
+		return VITA2D_SYS_ERROR_INVALID_POINTER;
+
+	if (context->status != DEFERRED_STATUS_RECORDED || _vita2d_ctx()->deferred)
+		return VITA2D_SYS_ERROR_INVALID_STATE;
+
+	// Everything drawn so far goes first, lists run in the order they are executed
+	_vita2d_batch_flush();
+
+	err = sceGxmExecuteCommandList(_vita2d_context, &context->list);
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("[DEFERRED] sceGxmExecuteCommandList(): 0x%X", err);
+		return err;
+	}
+
+	context->halfExecuted[context->half] = 1;
+	context->halfSerial[context->half] = _vita2d_pool_frame_serial();
+
+	// Counted while recording, the work runs as part of this frame
+	_vita2d_stats_merge(_vita2d_ctx(), &context->ctx);
+
+	_vita2d_state_invalidate();
+	_vita2d_clip_restore();
+
+	return SCE_OK;
+}
@@ -0,0 +1,246 @@
+#include <kernel.h>
+#include <gxm.h>
+#include <libdbg.h>
+#include "vita2d_sys.h"
+
+#include "utils.h"
+#include "shared.h"
+#include "heap.h"
+
+extern void* vita2d_heap_internal;
+
+/*
+ * Display lists.
+ *
+ * While a list is being recorded, batchable quads (rectangles, texture quads,
+ * text) are written into a growing heap staging buffer instead of the temp
+ * pool, consecutive quads with the same programs and texture sharing one
+ * command. Ending the list copies the vertices once into persistent device
+ * memory, replaying it only sets state and issues one draw per command.
+ * Translation is applied by offsetting the wvp matrix, vertices are never
+ * touched again.
+ */
+
+#define DISPLAY_LIST_STAGING_SIZE	(16 * 1024)
+#define DISPLAY_LIST_COMMANDS		32
+#define DISPLAY_LIST_ALIGN			256
+
+typedef struct vita2d_display_list_command {
+	const SceGxmVertexProgram *vertexProgram;
+	const SceGxmFragmentProgram *fragmentProgram;
+	const SceGxmProgramParameter *wvpParam;
+	const SceGxmTexture *texture;
+	unsigned int stride;
+	unsigned int offset;
+	unsigned int quadCount;
+} vita2d_display_list_command;
+
+struct vita2d_display_list {
+	SceGxmDeviceMemInfo *mem;
+	vita2d_display_list_command *commands;
+	unsigned int command_count;
+};
+
+static int recording = 0;
+static unsigned char *staging = NULL;
+static unsigned int staging_size = 0;
+static unsigned int staging_index = 0;
+static vita2d_display_list_command *commands = NULL;
+static unsigned int command_size = 0;
+static unsigned int command_count = 0;
+
+static void recording_reset(void)
+{
+	if (staging)
+		heap_free_heap_memory(vita2d_heap_internal, staging);
+	if (commands)
+		heap_free_heap_memory(vita2d_heap_internal, commands);
+
+	staging = NULL;
+	staging_size = 0;
+	staging_index = 0;
+	commands = NULL;
+	command_size = 0;
+	command_count = 0;
+	recording = 0;
+}
+
+void _vita2d_display_list_fini(void)
+{
+	recording_reset();
+}
+
+int _vita2d_display_list_recording(void)
+{
+	return recording;
+}
+
+void *_vita2d_display_list_alloc_quads(const SceGxmVertexProgram *vertexProgram, const SceGxmFragmentProgram *fragmentProgram,
+	const SceGxmProgramParameter *wvpParam, const SceGxmTexture *texture, unsigned int stride, unsigned int count)
+{
+	vita2d_display_list_command *command = NULL;
+	unsigned int size = count * 4 * stride;
+	void *ptr;
+
+	// Both quad vertex strides are multiples of sizeof(float), offsets stay aligned
+	if (staging_index + size > staging_size) {
+		unsigned int new_size = staging_size ? staging_size : DISPLAY_LIST_STAGING_SIZE;
+		while (staging_index + size > new_size)
+			new_size *= 2;
+
+		ptr = heap_realloc_heap_memory(vita2d_heap_internal, staging, new_size);
+		if (!ptr) {
+			SCE_DBG_LOG_ERROR("[DISPLAY_LIST] heap_realloc_heap_memory() returned NULL");
+			return NULL;
+		}
+
+		staging = ptr;
+		staging_size = new_size;
+	}
+
+	if (command_count) {
+		command = &commands[command_count - 1];
+		if (command->vertexProgram != vertexProgram
+			|| command->fragmentProgram != fragmentProgram
+			|| command->texture != texture)
+			command = NULL;
+	}
+
+	if (!command) {
+		if (command_count == command_size) {
+			unsigned int new_size = command_size ? command_size * 2 : DISPLAY_LIST_COMMANDS;
+
+			ptr = heap_realloc_heap_memory(vita2d_heap_internal, commands, new_size * sizeof(vita2d_display_list_command));
+			if (!ptr) {
+				SCE_DBG_LOG_ERROR("[DISPLAY_LIST] heap_realloc_heap_memory() returned NULL");
+				return NULL;
+			}
+
+			commands = ptr;
+			command_size = new_size;
+		}
+
+		command = &commands[command_count++];
+		command->vertexProgram = vertexProgram;
+		command->fragmentProgram = fragmentProgram;
+		command->wvpParam = wvpParam;
+		command->texture = texture;
+		command->stride = stride;
+		command->offset = staging_index;
+		command->quadCount = 0;
+	}
+
+	ptr = staging + staging_index;
+	command->quadCount += count;
+	staging_index += size;
+
+	return ptr;
+}
+
+int vita2d_display_list_begin()
+{
+	if (recording)
+		return VITA2D_SYS_ERROR_INVALID_STATE;
+
+	// Quads drawn before the list must not end up in it
+	_vita2d_batch_flush();
+
+	staging_index = 0;
+	command_count = 0;
+	recording = 1;
+
+	return SCE_OK;
+}
+
+vita2d_display_list *vita2d_display_list_end()
+{
+	int err;
+	vita2d_display_list *list = NULL;
+
+	if (!recording)
+		return NULL;
+
+	recording = 0;
+
+	if (command_count == 0)
+		goto _display_list_end_done;
+
+	list = heap_alloc_heap_memory(vita2d_heap_internal, sizeof(*list));
+	if (!list) {
+		SCE_DBG_LOG_ERROR("[DISPLAY_LIST] heap_alloc_heap_memory() returned NULL");
+		goto _display_list_end_done;
+	}
+
+	list->commands = heap_alloc_heap_memory(vita2d_heap_internal, command_count * sizeof(vita2d_display_list_command));
+	if (!list->commands) {
+		SCE_DBG_LOG_ERROR("[DISPLAY_LIST] heap_alloc_heap_memory() returned NULL");
+		goto _display_list_end_free_list;
+	}
+
+	err = sceGxmAllocDeviceMemLinux(
+		SCE_GXM_DEVICE_HEAP_ID_USER_NC,
+		SCE_GXM_MEMORY_ATTRIB_READ,
+		ALIGN(staging_index, DISPLAY_LIST_ALIGN),
+		DISPLAY_LIST_ALIGN,
+		&list->mem);
+
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("[DISPLAY_LIST] sceGxmAllocDeviceMemLinux(): 0x%X", err);
+		goto _display_list_end_free_commands;
+	}
+
+	sceClibMemcpy(list->mem->mappedBase, staging, staging_index);
+	sceClibMemcpy(list->commands, commands, command_count * sizeof(vita2d_display_list_command));
+	list->command_count = command_count;
+
+	goto _display_list_end_done;
+
+_display_list_end_free_commands:
+	heap_free_heap_memory(vita2d_heap_internal, list->commands);
+_display_list_end_free_list:
+	heap_free_heap_memory(vita2d_heap_internal, list);
+	list = NULL;
+_display_list_end_done:
+
+	// Staging memory is only needed while recording
+	recording_reset();
+
+	return list;
+}
+
+void vita2d_display_list_draw(const vita2d_display_list *list, float x, float y)
+{
+	float wvp[4 * 4];
+	unsigned int i, r;
+
+	if (!list)
+		return;
+
+	_vita2d_batch_flush();
+
+	// Recorded quads were CPU-clipped against the rectangle active while recording
+	_vita2d_clip_require_stencil();
+
+	// wvp * translate(x, y), only the translation column changes
+	matrix_copy(wvp, _vita2d_ctx()->ortho);
+	for (r = 0; r < 4; r++)
+		wvp[12 + r] += wvp[r] * x + wvp[4 + r] * y;
+
+	for (i = 0; i < list->command_count; i++) {
+		const vita2d_display_list_command *command = &list->commands[i];
+
+		_vita2d_batch_draw_quads(command->vertexProgram, command->fragmentProgram, command->wvpParam,
+			command->texture, (const void *)((unsigned int)list->mem->mappedBase + command->offset),
+			command->stride, command->quadCount, wvp);
+	}
+}
+
+void vita2d_free_display_list(vita2d_display_list *list)
+{
+	if (!list)
+		return;
+
+	sceGxmFreeDeviceMemLinux(list->mem);
+	heap_free_heap_memory(vita2d_heap_internal, list->commands);
+	heap_free_heap_memory(vita2d_heap_internal, list);
+}
@@ -1,168 +1,675 @@
+#include <kernel.h>
 #include <math.h>
 #include <sceconst.h>
 #include <libfpu.h>
+#include <libdbg.h>
 #include "vita2d_sys.h"
 #include "shared.h"
 
+#define CIRCLE_MIN_SEGMENTS	8
+#define CIRCLE_MAX_SEGMENTS	256
+#define CIRCLE_LEVEL_COUNT	6
+
+#define RECTANGLE_CHUNK		64
+
 void vita2d_draw_pixel(float x, float y, unsigned int color)
 {
-	vita2d_color_vertex *vertex = (vita2d_color_vertex *)vita2d_pool_memalign(
-		1 * sizeof(vita2d_color_vertex), // 1 vertex
-		sizeof(vita2d_color_vertex));
+	int visibility = _vita2d_visibility(x, y, x + 1.0f, y + 1.0f);
+	if (visibility == VITA2D_CLIP_OUTSIDE)
+		return;
+	if (visibility == VITA2D_CLIP_PARTIAL)
+		_vita2d_clip_require_stencil();
+
+	_vita2d_batch_flush();
+
+	vita2d_color_compact_vertex *vertex = (vita2d_color_compact_vertex *)vita2d_pool_memalign(
+		1 * sizeof(vita2d_color_compact_vertex), // 1 vertex
+		sizeof(float));
 
 	uint16_t *index = (uint16_t *)vita2d_pool_memalign(
 		1 * sizeof(uint16_t), // 1 index
 		sizeof(uint16_t));
 
+	if (!vertex || !index)
+		return;
+
 	vertex->x = x;
 	vertex->y = y;
-	vertex->z = +0.5f;
 	vertex->color = color;
 
 	*index = 0;
 
-	sceGxmSetVertexProgram(_vita2d_context, _vita2d_colorVertexProgram);
-	sceGxmSetFragmentProgram(_vita2d_context, _vita2d_colorFragmentProgram);
+	const vita2d_draw_ctx *ctx = _vita2d_ctx();
 
-	void *vertexDefaultBuffer;
-	sceGxmReserveVertexDefaultUniformBuffer(_vita2d_context, &vertexDefaultBuffer);
-	sceGxmSetUniformDataF(vertexDefaultBuffer, _vita2d_colorWvpParam, 0, 16, _vita2d_ortho_matrix);
+	_vita2d_set_vertex_program(_vita2d_colorCompactVertexProgram);
+	_vita2d_set_fragment_program(ctx->programs->colorCompact);
+	_vita2d_set_wvp(_vita2d_colorCompactWvpParam, ctx->ortho);
 
-	sceGxmSetVertexStream(_vita2d_context, 0, vertex);
-	sceGxmSetFrontPolygonMode(_vita2d_context, SCE_GXM_POLYGON_MODE_POINT);
-	sceGxmDraw(_vita2d_context, SCE_GXM_PRIMITIVE_POINTS, SCE_GXM_INDEX_FORMAT_U16, index, 1);
-	sceGxmSetFrontPolygonMode(_vita2d_context, SCE_GXM_POLYGON_MODE_TRIANGLE_FILL);
+	_vita2d_set_vertex_stream(0, vertex);
+	_vita2d_set_front_polygon_mode(SCE_GXM_POLYGON_MODE_POINT);
+	_vita2d_draw(SCE_GXM_PRIMITIVE_POINTS, index, 1, 1);
 }
 
 void vita2d_draw_line(float x0, float y0, float x1, float y1, unsigned int color)
 {
-	vita2d_color_vertex *vertices = (vita2d_color_vertex *)vita2d_pool_memalign(
-		2 * sizeof(vita2d_color_vertex), // 2 vertices
-		sizeof(vita2d_color_vertex));
+	// Widen the bounds by a pixel so the rasterized line is covered
+	int visibility = _vita2d_visibility(
+		(x0 < x1 ? x0 : x1) - 1.0f, (y0 < y1 ? y0 : y1) - 1.0f,
+		(x0 > x1 ? x0 : x1) + 1.0f, (y0 > y1 ? y0 : y1) + 1.0f);
+	if (visibility == VITA2D_CLIP_OUTSIDE)
+		return;
+	if (visibility == VITA2D_CLIP_PARTIAL)
+		_vita2d_clip_require_stencil();
+
+	_vita2d_batch_flush();
+
+	vita2d_color_compact_vertex *vertices = (vita2d_color_compact_vertex *)vita2d_pool_memalign(
+		2 * sizeof(vita2d_color_compact_vertex), // 2 vertices
+		sizeof(float));
+
+	if (!vertices)
+		return;
 
 	vertices[0].x = x0;
 	vertices[0].y = y0;
-	vertices[0].z = +0.5f;
 	vertices[0].color = color;
 
 	vertices[1].x = x1;
 	vertices[1].y = y1;
-	vertices[1].z = +0.5f;
 	vertices[1].color = color;
 
-	sceGxmSetVertexProgram(_vita2d_context, _vita2d_colorVertexProgram);
-	sceGxmSetFragmentProgram(_vita2d_context, _vita2d_colorFragmentProgram);
+	const vita2d_draw_ctx *ctx = _vita2d_ctx();
 
-	void *vertexDefaultBuffer;
-	sceGxmReserveVertexDefaultUniformBuffer(_vita2d_context, &vertexDefaultBuffer);
-	sceGxmSetUniformDataF(vertexDefaultBuffer, _vita2d_colorWvpParam, 0, 16, _vita2d_ortho_matrix);
+	_vita2d_set_vertex_program(_vita2d_colorCompactVertexProgram);
+	_vita2d_set_fragment_program(ctx->programs->colorCompact);
+	_vita2d_set_wvp(_vita2d_colorCompactWvpParam, ctx->ortho);
 
-	sceGxmSetVertexStream(_vita2d_context, 0, vertices);
-	sceGxmSetFrontPolygonMode(_vita2d_context, SCE_GXM_POLYGON_MODE_LINE);
-	sceGxmDraw(_vita2d_context, SCE_GXM_PRIMITIVE_LINES, SCE_GXM_INDEX_FORMAT_U16, vita2d_get_linear_indices(), 2);
-	sceGxmSetFrontPolygonMode(_vita2d_context, SCE_GXM_POLYGON_MODE_TRIANGLE_FILL);
+	_vita2d_set_vertex_stream(0, vertices);
+	_vita2d_set_front_polygon_mode(SCE_GXM_POLYGON_MODE_LINE);
+	_vita2d_draw(SCE_GXM_PRIMITIVE_LINES, vita2d_get_linear_indices(), 2, 2);
 }
 
 void vita2d_draw_rectangle(float x, float y, float w, float h, unsigned int color)
 {
-	vita2d_color_vertex *vertices = (vita2d_color_vertex *)vita2d_pool_memalign(
-		4 * sizeof(vita2d_color_vertex), // 4 vertices
-		sizeof(vita2d_color_vertex));
+	float x0 = x;
+	float y0 = y;
+	float x1 = x + w;
+	float y1 = y + h;
+
+	if (_vita2d_visibility(x0, y0, x1, y1) == VITA2D_CLIP_OUTSIDE)
+		return;
+
+	if (!_vita2d_clip_quad(&x0, &y0, &x1, &y1, NULL, NULL, NULL, NULL))
+		return;
+
+	vita2d_color_compact_vertex *vertices = (vita2d_color_compact_vertex *)_vita2d_batch_alloc_quads(
+		_vita2d_colorCompactVertexProgram,
+		_vita2d_ctx()->programs->colorCompact,
+		_vita2d_colorCompactWvpParam,
+		NULL,
+		sizeof(vita2d_color_compact_vertex),
+		1);
+	if (!vertices)
+		return;
 
-	vertices[0].x = x;
-	vertices[0].y = y;
-	vertices[0].z = +0.5f;
+	vertices[0].x = x0;
+	vertices[0].y = y0;
 	vertices[0].color = color;
 
-	vertices[1].x = x + w;
-	vertices[1].y = y;
-	vertices[1].z = +0.5f;
+	vertices[1].x = x1;
+	vertices[1].y = y0;
 	vertices[1].color = color;
 
-	vertices[2].x = x;
-	vertices[2].y = y + h;
-	vertices[2].z = +0.5f;
+	vertices[2].x = x0;
+	vertices[2].y = y1;
 	vertices[2].color = color;
 
-	vertices[3].x = x + w;
-	vertices[3].y = y + h;
-	vertices[3].z = +0.5f;
+	vertices[3].x = x1;
+	vertices[3].y = y1;
 	vertices[3].color = color;
+}
+
+static void draw_compact_vertices(SceGxmPrimitiveType type, SceGxmPolygonMode mode, const vita2d_color_compact_vertex *vertices, unsigned int count)
+{
+	const vita2d_draw_ctx *ctx = _vita2d_ctx();
+
+	_vita2d_set_vertex_program(_vita2d_colorCompactVertexProgram);
+	_vita2d_set_fragment_program(ctx->programs->colorCompact);
+	_vita2d_set_wvp(_vita2d_colorCompactWvpParam, ctx->ortho);
+
+	_vita2d_set_front_polygon_mode(mode);
+
+	// Linear indices cover 65536 vertices, keep chunks a multiple of 2 for lines
+	while (count) {
+		unsigned int n = count > UINT16_MAX ? UINT16_MAX - 1 : count;
+
+		_vita2d_set_vertex_stream(0, vertices);
+		_vita2d_draw(type, vita2d_get_linear_indices(), n, n);
+
+		vertices += n;
+		count -= n;
+	}
+}
+
+void vita2d_draw_pixels(const vita2d_point *points, unsigned int count)
+{
+	unsigned int i, visible = 0;
+	int visibility;
+
+	if (!count)
+		return;
+
+	_vita2d_batch_flush();
+
+	vita2d_color_compact_vertex *vertices = (vita2d_color_compact_vertex *)vita2d_pool_memalign(
+		count * sizeof(vita2d_color_compact_vertex),
+		sizeof(float));
+
+	if (!vertices)
+		return;
+
+	for (i = 0; i < count; i++) {
+		visibility = _vita2d_visibility(points[i].x, points[i].y, points[i].x + 1.0f, points[i].y + 1.0f);
+		if (visibility == VITA2D_CLIP_OUTSIDE)
+			continue;
+		if (visibility == VITA2D_CLIP_PARTIAL)
+			_vita2d_clip_require_stencil();
+
+		vertices[visible].x = points[i].x;
+		vertices[visible].y = points[i].y;
+		vertices[visible].color = points[i].color;
+		visible++;
+	}
+
+	if (visible)
+		draw_compact_vertices(SCE_GXM_PRIMITIVE_POINTS, SCE_GXM_POLYGON_MODE_POINT, vertices, visible);
+}
+
+void vita2d_draw_lines(const vita2d_line *lines, unsigned int count)
+{
+	unsigned int i, visible = 0;
+	int visibility;
+
+	if (!count)
+		return;
+
+	_vita2d_batch_flush();
 
-	sceGxmSetVertexProgram(_vita2d_context, _vita2d_colorVertexProgram);
-	sceGxmSetFragmentProgram(_vita2d_context, _vita2d_colorFragmentProgram);
+	vita2d_color_compact_vertex *vertices = (vita2d_color_compact_vertex *)vita2d_pool_memalign(
+		count * 2 * sizeof(vita2d_color_compact_vertex),
+		sizeof(float));
 
-	void *vertexDefaultBuffer;
-	sceGxmReserveVertexDefaultUniformBuffer(_vita2d_context, &vertexDefaultBuffer);
-	sceGxmSetUniformDataF(vertexDefaultBuffer, _vita2d_colorWvpParam, 0, 16, _vita2d_ortho_matrix);
+	if (!vertices)
+		return;
 
-	sceGxmSetVertexStream(_vita2d_context, 0, vertices);
-	sceGxmDraw(_vita2d_context, SCE_GXM_PRIMITIVE_TRIANGLE_STRIP, SCE_GXM_INDEX_FORMAT_U16, vita2d_get_linear_indices(), 4);
+	for (i = 0; i < count; i++) {
+		const vita2d_line *line = &lines[i];
+
+		// Widen the bounds by a pixel so the rasterized line is covered
+		visibility = _vita2d_visibility(
+			(line->x0 < line->x1 ? line->x0 : line->x1) - 1.0f, (line->y0 < line->y1 ? line->y0 : line->y1) - 1.0f,
+			(line->x0 > line->x1 ? line->x0 : line->x1) + 1.0f, (line->y0 > line->y1 ? line->y0 : line->y1) + 1.0f);
+		if (visibility == VITA2D_CLIP_OUTSIDE)
+			continue;
+		if (visibility == VITA2D_CLIP_PARTIAL)
+			_vita2d_clip_require_stencil();
+
+		vertices[visible * 2 + 0].x = line->x0;
+		vertices[visible * 2 + 0].y = line->y0;
+		vertices[visible * 2 + 0].color = line->color;
+
+		vertices[visible * 2 + 1].x = line->x1;
+		vertices[visible * 2 + 1].y = line->y1;
+		vertices[visible * 2 + 1].color = line->color;
+		visible++;
+	}
+
+	if (visible)
+		draw_compact_vertices(SCE_GXM_PRIMITIVE_LINES, SCE_GXM_POLYGON_MODE_LINE, vertices, visible * 2);
+}
+
+static int rectangles_submit(const vita2d_color_compact_vertex *staging, unsigned int count)
+{
+	void *vertices = _vita2d_batch_alloc_quads(
+		_vita2d_colorCompactVertexProgram,
+		_vita2d_ctx()->programs->colorCompact,
+		_vita2d_colorCompactWvpParam,
+		NULL,
+		sizeof(vita2d_color_compact_vertex),
+		count);
+	if (!vertices)
+		return 0;
+
+	sceClibMemcpy(vertices, staging, count * 4 * sizeof(vita2d_color_compact_vertex));
+	return 1;
+}
+
+void vita2d_draw_rectangles(const vita2d_rectangle *rectangles, unsigned int count)
+{
+	vita2d_color_compact_vertex staging[RECTANGLE_CHUNK * 4];
+	unsigned int i, visible = 0;
+
+	/*
+	 * Rectangles are CPU-clipped like vita2d_draw_rectangle(), survivors are
+	 * gathered on the stack and go through the batcher a chunk at a time, so
+	 * the whole array ends up in as few draws as the batch allows.
+	 */
+	for (i = 0; i < count; i++) {
+		const vita2d_rectangle *rectangle = &rectangles[i];
+		float x0 = rectangle->x;
+		float y0 = rectangle->y;
+		float x1 = rectangle->x + rectangle->w;
+		float y1 = rectangle->y + rectangle->h;
+
+		if (_vita2d_visibility(x0, y0, x1, y1) == VITA2D_CLIP_OUTSIDE)
+			continue;
+
+		if (!_vita2d_clip_quad(&x0, &y0, &x1, &y1, NULL, NULL, NULL, NULL))
+			continue;
+
+		vita2d_color_compact_vertex *vertices = &staging[visible * 4];
+
+		vertices[0].x = x0;
+		vertices[0].y = y0;
+		vertices[0].color = rectangle->color;
+
+		vertices[1].x = x1;
+		vertices[1].y = y0;
+		vertices[1].color = rectangle->color;
+
+		vertices[2].x = x0;
+		vertices[2].y = y1;
+		vertices[2].color = rectangle->color;
+
+		vertices[3].x = x1;
+		vertices[3].y = y1;
+		vertices[3].color = rectangle->color;
+
+		if (++visible == RECTANGLE_CHUNK) {
+			if (!rectangles_submit(staging, visible))
+				return;
+			visible = 0;
+		}
+	}
+
+	if (visible)
+		rectangles_submit(staging, visible);
+}
+
+/*
+ * Anti-aliased shapes.
+ *
+ * Every shape is a single batched quad with one pixel of margin. The shape
+ * fragment program evaluates the signed distance to a rounded box from the
+ * pixel position relative to the center and fades coverage across the edge,
+ * circles being boxes with full corner radius.
+ */
+
+static void draw_shape(float cx, float cy, float half_w, float half_h, float radius, float stroke, unsigned int color)
+{
+	unsigned int i;
+
+	half_w = half_w < 0.0f ? -half_w : half_w;
+	half_h = half_h < 0.0f ? -half_h : half_h;
+
+	if (radius < 0.0f)
+		radius = 0.0f;
+	if (radius > half_w)
+		radius = half_w;
+	if (radius > half_h)
+		radius = half_h;
+
+	float u0 = -half_w - 1.0f;
+	float v0 = -half_h - 1.0f;
+	float u1 = half_w + 1.0f;
+	float v1 = half_h + 1.0f;
+	float x0 = cx + u0;
+	float y0 = cy + v0;
+	float x1 = cx + u1;
+	float y1 = cy + v1;
+
+	if (_vita2d_visibility(x0, y0, x1, y1) == VITA2D_CLIP_OUTSIDE)
+		return;
+
+	// Local coordinates are linear in the position, so they clip like texture coordinates
+	if (!_vita2d_clip_quad(&x0, &y0, &x1, &y1, &u0, &v0, &u1, &v1))
+		return;
+
+	vita2d_shape_vertex *vertices = (vita2d_shape_vertex *)_vita2d_batch_alloc_quads(
+		_vita2d_shapeVertexProgram,
+		_vita2d_ctx()->programs->shape,
+		_vita2d_shapeWvpParam,
+		NULL,
+		sizeof(vita2d_shape_vertex),
+		1);
+	if (!vertices)
+		return;
+
+	vertices[0].x = x0;
+	vertices[0].y = y0;
+	vertices[0].local_x = u0;
+	vertices[0].local_y = v0;
+
+	vertices[1].x = x1;
+	vertices[1].y = y0;
+	vertices[1].local_x = u1;
+	vertices[1].local_y = v0;
+
+	vertices[2].x = x0;
+	vertices[2].y = y1;
+	vertices[2].local_x = u0;
+	vertices[2].local_y = v1;
+
+	vertices[3].x = x1;
+	vertices[3].y = y1;
+	vertices[3].local_x = u1;
+	vertices[3].local_y = v1;
+
+	for (i = 0; i < 4; i++) {
+		vertices[i].half_w = half_w;
+		vertices[i].half_h = half_h;
+		vertices[i].radius = radius;
+		vertices[i].stroke = stroke;
+		vertices[i].color = color;
+	}
+}
+
+void vita2d_draw_fill_rounded_rectangle(float x, float y, float w, float h, float radius, unsigned int color)
+{
+	draw_shape(x + w * 0.5f, y + h * 0.5f, w * 0.5f, h * 0.5f, radius, 0.0f, color);
+}
+
+void vita2d_draw_rounded_rectangle(float x, float y, float w, float h, float radius, float thickness, unsigned int color)
+{
+	if (thickness <= 0.0f)
+		return;
+
+	draw_shape(x + w * 0.5f, y + h * 0.5f, w * 0.5f, h * 0.5f, radius, thickness, color);
+}
+
+void vita2d_draw_smooth_circle(float x, float y, float radius, unsigned int color)
+{
+	draw_shape(x, y, radius, radius, radius < 0.0f ? -radius : radius, 0.0f, color);
+}
+
+void vita2d_draw_ring(float x, float y, float radius, float thickness, unsigned int color)
+{
+	if (thickness <= 0.0f)
+		return;
+
+	draw_shape(x, y, radius, radius, radius < 0.0f ? -radius : radius, thickness, color);
+}
+
+/*
+ * Circles, ellipses and arcs.
+ *
+ * Full shapes are drawn from a unit circle kept in GPU memory: a center and
+ * CIRCLE_MAX_SEGMENTS ring vertices, shared by index lists for every power of
+ * two segment count down to CIRCLE_MIN_SEGMENTS. Position and radii are folded
+ * into the wvp matrix and the color is a single pool word fetched by instance
+ * index, so a draw writes 4 bytes of vertex data. Arcs have arbitrary end
+ * angles and are written to the pool in the same unit space.
+ */
+
+static SceGxmDeviceMemInfo *circleMeshMem = NULL;
+static const uint16_t *circleFanIndices[CIRCLE_LEVEL_COUNT];
+static const uint16_t *circleLineIndices[CIRCLE_LEVEL_COUNT];
+static const float *circleVertices = NULL;
+
+int _vita2d_circle_init(void)
+{
+	int err;
+	unsigned int level, n, i, stride;
+	unsigned int index_count = 0;
+
+	for (level = 0, n = CIRCLE_MIN_SEGMENTS; level < CIRCLE_LEVEL_COUNT; level++, n *= 2)
+		index_count += (n + 2) + 2 * n;
+
+	err = sceGxmAllocDeviceMemLinux(
+		SCE_GXM_DEVICE_HEAP_ID_USER_NC,
+		SCE_GXM_MEMORY_ATTRIB_READ,
+		(CIRCLE_MAX_SEGMENTS + 1) * 2 * sizeof(float) + index_count * sizeof(uint16_t),
+		4,
+		&circleMeshMem);
+
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("[CIRCLE] sceGxmAllocDeviceMemLinux(): 0x%X", err);
+		return err;
+	}
+
+	float *vertices = (float *)(circleMeshMem->mappedBase);
+	uint16_t *indices = (uint16_t *)(vertices + (CIRCLE_MAX_SEGMENTS + 1) * 2);
+
+	vertices[0] = 0.0f;
+	vertices[1] = 0.0f;
+
+	for (i = 0; i < CIRCLE_MAX_SEGMENTS; i++) {
+		float theta = 2 * SCE_MATH_PI * (float)i / (float)CIRCLE_MAX_SEGMENTS;
+		vertices[2 + i * 2 + 0] = sceFpuCosf(theta);
+		vertices[2 + i * 2 + 1] = sceFpuSinf(theta);
+	}
+
+	// Coarser levels pick every stride-th ring vertex
+	for (level = 0, n = CIRCLE_MIN_SEGMENTS; level < CIRCLE_LEVEL_COUNT; level++, n *= 2) {
+		stride = CIRCLE_MAX_SEGMENTS / n;
+
+		circleFanIndices[level] = indices;
+		*indices++ = 0;
+		for (i = 0; i <= n; i++)
+			*indices++ = 1 + (i % n) * stride;
+
+		circleLineIndices[level] = indices;
+		for (i = 0; i < n; i++) {
+			*indices++ = 1 + i * stride;
+			*indices++ = 1 + ((i + 1) % n) * stride;
+		}
+	}
+
+	circleVertices = vertices;
+
+	return SCE_OK;
+}
+
+void _vita2d_circle_fini(void)
+{
+	sceGxmFreeDeviceMemLinux(circleMeshMem);
+	circleMeshMem = NULL;
+	circleVertices = NULL;
+}
+
+static unsigned int circle_level(float rx, float ry)
+{
+	float r = rx < 0.0f ? -rx : rx;
+	float r_y = ry < 0.0f ? -ry : ry;
+	unsigned int level = 0;
+	unsigned int n = CIRCLE_MIN_SEGMENTS;
+
+	if (r_y > r)
+		r = r_y;
+
+	// Chord error r * pi^2 / (2 * n^2) stays below a quarter pixel
+	while (level < CIRCLE_LEVEL_COUNT - 1 && (float)(n * n) < 20.0f * r) {
+		level++;
+		n *= 2;
+	}
+
+	return level;
+}
+
+static int circle_begin(float x, float y, float rx, float ry, unsigned int color, SceGxmPolygonMode mode)
+{
+	const vita2d_draw_ctx *ctx = _vita2d_ctx();
+	float wvp[4 * 4];
+	unsigned int r;
+
+	int visibility = _vita2d_visibility(x - rx, y - ry, x + rx, y + ry);
+	if (visibility == VITA2D_CLIP_OUTSIDE)
+		return 0;
+	if (visibility == VITA2D_CLIP_PARTIAL)
+		_vita2d_clip_require_stencil();
+
+	_vita2d_batch_flush();
+
+	unsigned int *mesh_color = (unsigned int *)vita2d_pool_memalign(
+		sizeof(unsigned int),
+		sizeof(unsigned int));
+
+	if (!mesh_color)
+		return 0;
+
+	*mesh_color = color;
+
+	// wvp * translate(x, y) * scale(rx, ry)
+	for (r = 0; r < 4; r++) {
+		wvp[r] = ctx->ortho[r] * rx;
+		wvp[4 + r] = ctx->ortho[4 + r] * ry;
+		wvp[8 + r] = ctx->ortho[8 + r];
+		wvp[12 + r] = ctx->ortho[12 + r] + ctx->ortho[r] * x + ctx->ortho[4 + r] * y;
+	}
+
+	_vita2d_set_vertex_program(_vita2d_colorMeshVertexProgram);
+	_vita2d_set_fragment_program(ctx->programs->colorCompact);
+	_vita2d_set_wvp(_vita2d_colorCompactWvpParam, wvp);
+
+	_vita2d_set_front_polygon_mode(mode);
+	_vita2d_set_back_polygon_mode(mode);
+
+	_vita2d_set_vertex_stream(1, mesh_color);
+
+	return 1;
+}
+
+void vita2d_draw_fill_ellipse(float x, float y, float rx, float ry, unsigned int color)
+{
+	unsigned int level = circle_level(rx, ry);
+
+	if (!circle_begin(x, y, rx, ry, color, SCE_GXM_POLYGON_MODE_TRIANGLE_FILL))
+		return;
+
+	_vita2d_set_vertex_stream(0, circleVertices);
+	_vita2d_draw(SCE_GXM_PRIMITIVE_TRIANGLE_FAN, circleFanIndices[level], (CIRCLE_MIN_SEGMENTS << level) + 2,
+		(CIRCLE_MIN_SEGMENTS << level) + 1);
+}
+
+void vita2d_draw_ellipse(float x, float y, float rx, float ry, unsigned int color)
+{
+	unsigned int level = circle_level(rx, ry);
+
+	if (!circle_begin(x, y, rx, ry, color, SCE_GXM_POLYGON_MODE_LINE))
+		return;
+
+	_vita2d_set_vertex_stream(0, circleVertices);
+	_vita2d_draw(SCE_GXM_PRIMITIVE_LINES, circleLineIndices[level], (CIRCLE_MIN_SEGMENTS << level) * 2,
+		CIRCLE_MIN_SEGMENTS << level);
 }
 
 void vita2d_draw_fill_circle(float x, float y, float radius, unsigned int color)
 {
-	static const int num_segments = 100;
+	vita2d_draw_fill_ellipse(x, y, radius, radius, color);
+}
 
-	vita2d_color_vertex *vertices = (vita2d_color_vertex *)vita2d_pool_memalign(
-		(num_segments + 1) * sizeof(vita2d_color_vertex),
-		sizeof(vita2d_color_vertex));
+void vita2d_draw_circle(float x, float y, float radius, unsigned int color)
+{
+	vita2d_draw_ellipse(x, y, radius, radius, color);
+}
 
-	uint16_t *indices = (uint16_t *)vita2d_pool_memalign(
-		(num_segments + 2) * sizeof(uint16_t),
-		sizeof(uint16_t));
+static void draw_arc_generic(float x, float y, float radius, float start_rad, float end_rad, unsigned int color, int fill)
+{
+	float span = end_rad - start_rad;
+	float turns = (span < 0.0f ? -span : span) / (2 * SCE_MATH_PI);
+	unsigned int i, segments;
+
+	if (span == 0.0f)
+		return;
+
+	if (turns >= 1.0f) {
+		if (fill)
+			vita2d_draw_fill_circle(x, y, radius, color);
+		else
+			vita2d_draw_circle(x, y, radius, color);
+		return;
+	}
 
-	vertices[0].x = x;
-	vertices[0].y = y;
-	vertices[0].z = +0.5f;
-	vertices[0].color = color;
-	indices[0] = 0;
+	// Same density as a full circle of this radius, at least one segment
+	segments = (unsigned int)((float)(CIRCLE_MIN_SEGMENTS << circle_level(radius, radius)) * turns) + 1;
+
+	if (!circle_begin(x, y, radius, radius, color, fill ? SCE_GXM_POLYGON_MODE_TRIANGLE_FILL : SCE_GXM_POLYGON_MODE_LINE))
+		return;
+
+	// Center followed by segments + 1 unit ring vertices
+	float *vertices = (float *)vita2d_pool_memalign(
+		(segments + 2) * 2 * sizeof(float),
+		sizeof(float));
+
+	uint16_t *indices = NULL;
+	if (!fill) {
+		indices = (uint16_t *)vita2d_pool_memalign(
+			segments * 2 * sizeof(uint16_t),
+			sizeof(uint16_t));
+	}
 
-	float theta = 2 * SCE_MATH_PI / (float)num_segments;
+	if (!vertices || (!fill && !indices))
+		return;
+
+	float theta = span / (float)segments;
 	float c = sceFpuCosf(theta);
 	float s = sceFpuSinf(theta);
 	float t;
 
-	float xx = radius;
-	float yy = 0;
-	int i;
+	float xx = sceFpuCosf(start_rad);
+	float yy = sceFpuSinf(start_rad);
 
-	for (i = 1; i <= num_segments; i++) {
-		vertices[i].x = x + xx;
-		vertices[i].y = y + yy;
-		vertices[i].z = +0.5f;
-		vertices[i].color = color;
-		indices[i] = i;
+	vertices[0] = 0.0f;
+	vertices[1] = 0.0f;
+
+	for (i = 0; i <= segments; i++) {
+		vertices[2 + i * 2 + 0] = xx;
+		vertices[2 + i * 2 + 1] = yy;
 
 		t = xx;
 		xx = c * xx - s * yy;
 		yy = s * t + c * yy;
 	}
 
-	indices[num_segments + 1] = 1;
+	_vita2d_set_vertex_stream(0, vertices);
 
-	sceGxmSetVertexProgram(_vita2d_context, _vita2d_colorVertexProgram);
-	sceGxmSetFragmentProgram(_vita2d_context, _vita2d_colorFragmentProgram);
+	if (fill) {
+		_vita2d_draw(SCE_GXM_PRIMITIVE_TRIANGLE_FAN, vita2d_get_linear_indices(), segments + 2, segments + 2);
+		return;
+	}
 
-	void *vertexDefaultBuffer;
-	sceGxmReserveVertexDefaultUniformBuffer(_vita2d_context, &vertexDefaultBuffer);
-	sceGxmSetUniformDataF(vertexDefaultBuffer, _vita2d_colorWvpParam, 0, 16, _vita2d_ortho_matrix);
+	for (i = 0; i < segments; i++) {
+		indices[i * 2 + 0] = 1 + i;
+		indices[i * 2 + 1] = 2 + i;
+	}
+
+	_vita2d_draw(SCE_GXM_PRIMITIVE_LINES, indices, segments * 2, segments + 1);
+}
+
+void vita2d_draw_arc(float x, float y, float radius, float start_rad, float end_rad, unsigned int color)
+{
+	draw_arc_generic(x, y, radius, start_rad, end_rad, color, 0);
+}
 
-	sceGxmSetVertexStream(_vita2d_context, 0, vertices);
-	sceGxmDraw(_vita2d_context, SCE_GXM_PRIMITIVE_TRIANGLE_FAN, SCE_GXM_INDEX_FORMAT_U16, indices, num_segments + 2);
+void vita2d_draw_fill_arc(float x, float y, float radius, float start_rad, float end_rad, unsigned int color)
+{
+	draw_arc_generic(x, y, radius, start_rad, end_rad, color, 1);
 }
 
 void vita2d_draw_array(SceGxmPrimitiveType mode, const vita2d_color_vertex *vertices, size_t count)
 {
-	sceGxmSetVertexProgram(_vita2d_context, _vita2d_colorVertexProgram);
-	sceGxmSetFragmentProgram(_vita2d_context, _vita2d_colorFragmentProgram);
+	_vita2d_clip_require_stencil();
+	_vita2d_batch_flush();
+
+	const vita2d_draw_ctx *ctx = _vita2d_ctx();
 
-	void *vertexDefaultBuffer;
-	sceGxmReserveVertexDefaultUniformBuffer(_vita2d_context, &vertexDefaultBuffer);
-	sceGxmSetUniformDataF(vertexDefaultBuffer, _vita2d_colorWvpParam, 0, 16, _vita2d_ortho_matrix);
+	_vita2d_set_vertex_program(_vita2d_colorVertexProgram);
+	_vita2d_set_fragment_program(ctx->programs->color);
+	_vita2d_set_wvp(_vita2d_colorWvpParam, ctx->ortho);
 
-	sceGxmSetBackPolygonMode(_vita2d_context, SCE_GXM_POLYGON_MODE_TRIANGLE_FILL);
+	_vita2d_set_front_polygon_mode(SCE_GXM_POLYGON_MODE_TRIANGLE_FILL);
+	_vita2d_set_back_polygon_mode(SCE_GXM_POLYGON_MODE_TRIANGLE_FILL);
 
-	sceGxmSetVertexStream(_vita2d_context, 0, vertices);
-	sceGxmDraw(_vita2d_context, mode, SCE_GXM_INDEX_FORMAT_U16, vita2d_get_linear_indices(), count);
+	_vita2d_set_vertex_stream(0, vertices);
+	_vita2d_draw(mode, vita2d_get_linear_indices(), count, count);
 }
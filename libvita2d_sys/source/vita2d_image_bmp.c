@@ -4,7 +4,9 @@
 #include <fios2.h>
 #include "vita2d_sys.h"
 
+#include "utils.h"
 #include "heap.h"
+#include "premultiply.h"
 
 #define BMP_SIGNATURE (0x4D42)
 
@@ -65,6 +67,8 @@ static vita2d_texture *_vita2d_load_BMP_generic(
 	unsigned int tex_stride = vita2d_texture_get_stride(texture);
 
 	int i, x, y;
+	// Only 32 bpp bitmaps carry alpha, the others load opaque
+	int premultiply = bmp_ih->biBitCount == 32 && vita2d_texture_get_premultiplied_alpha();
 
 	seek_fn(user_data, bmp_fh->bfOffBits);
 
@@ -97,6 +101,9 @@ static vita2d_texture *_vita2d_load_BMP_generic(
 
 			tex_ptr++;
 		}
+
+		if (premultiply)
+			premultiply_alpha(texture_data + y*tex_stride, bmp_ih->biWidth);
 	}
 
 	heap_free_heap_memory(vita2d_heap_internal, buffer);
@@ -7,6 +7,7 @@
 
 #include "utils.h"
 #include "heap.h"
+#include "premultiply.h"
 
 #define PNG_SIGSIZE (8)
 
@@ -21,6 +22,7 @@ vita2d_texture *vita2d_load_PNG_file(char *filename, vita2d_io_type io_type)
 	unsigned char *pPng;
 	SceSize isize;
 	unsigned char *texture_data;
+	unsigned int pixel_count;
 	int width, height, outputFormat, streamFormat;
 
 	vita2d_texture *texture = heap_alloc_heap_memory(vita2d_heap_internal, sizeof(*texture));
@@ -115,8 +117,12 @@ vita2d_texture *vita2d_load_PNG_file(char *filename, vita2d_io_type io_type)
 		streamBufMemblock = SCE_UID_INVALID_UID;
 	}
 
+	pixel_count = width * height;
+
 	if (outputFormat != SCE_PNG_FORMAT_RGBA8888) {
 
+		pixel_count = ((width + 7) & ~7) * height;
+
 		ret = sceGxmAllocDeviceMemLinux(SCE_GXM_DEVICE_HEAP_ID_USER_NC, SCE_GXM_MEMORY_ATTRIB_READ, ((width + 7) & ~7) * height * 4, 4096, &texture->data_mem);
 		if (ret < 0) {
 			SCE_DBG_LOG_ERROR("[PNG] sceGxmAllocDeviceMemLinux(): 0x%X", ret);
@@ -138,6 +144,9 @@ vita2d_texture *vita2d_load_PNG_file(char *filename, vita2d_io_type io_type)
 		texture_data = (unsigned char *)texture->data_mem->mappedBase;
 	}
 
+	if (vita2d_texture_get_premultiplied_alpha())
+		premultiply_alpha(texture_data, pixel_count);
+
 	/* Create the gxm texture */
 	ret = sceGxmTextureInitLinear(
 		&texture->gxm_tex,
@@ -183,6 +192,7 @@ vita2d_texture *vita2d_load_PNG_buffer(const void *buffer, unsigned long buffer_
 	unsigned char *pPng = (unsigned char *)buffer;
 	SceSize isize = buffer_size;
 	unsigned char *texture_data;
+	unsigned int pixel_count;
 	int width, height, outputFormat, streamFormat;
 
 	vita2d_texture *texture = heap_alloc_heap_memory(vita2d_heap_internal, sizeof(*texture));
@@ -244,8 +254,12 @@ vita2d_texture *vita2d_load_PNG_buffer(const void *buffer, unsigned long buffer_
 		goto error_free_out_buf;
 	}
 
+	pixel_count = width * height;
+
 	if (outputFormat != SCE_PNG_FORMAT_RGBA8888) {
 
+		pixel_count = ((width + 7) & ~7) * height;
+
 		ret = sceGxmAllocDeviceMemLinux(SCE_GXM_DEVICE_HEAP_ID_USER_NC, SCE_GXM_MEMORY_ATTRIB_READ, ((width + 7) & ~7) * height * 4, 4096, &texture->data_mem);
 		if (ret < 0) {
 			SCE_DBG_LOG_ERROR("[PNG] sceGxmAllocDeviceMemLinux(): 0x%X", ret);
@@ -267,6 +281,9 @@ vita2d_texture *vita2d_load_PNG_buffer(const void *buffer, unsigned long buffer_
 		texture_data = (unsigned char *)texture->data_mem->mappedBase;
 	}
 
+	if (vita2d_texture_get_premultiplied_alpha())
+		premultiply_alpha(texture_data, pixel_count);
+
 	/* Create the gxm texture */
 	ret = sceGxmTextureInitLinear(
 		&texture->gxm_tex,
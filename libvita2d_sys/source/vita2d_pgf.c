@@ -319,6 +319,9 @@ int generic_pgf_draw_text(vita2d_pgf *font, int draw, int *height,
 	int pen_x = x;
 	int pen_y = y;
 
+	if (draw)
+		VITA2D_STAT_ADD(_vita2d_ctx(), textDraws, 1);
+
 	for (i = 0; text[i];) {
 		i += utf8_to_ucs2(&text[i], &character);
 
@@ -331,6 +334,8 @@ int generic_pgf_draw_text(vita2d_pgf *font, int draw, int *height,
 		}
 
 		if (!texture_atlas_get(font->atlas, character, &rect, &data)) {
+			VITA2D_STAT_ADD(_vita2d_ctx(), glyphMisses, 1);
+
 			if (!atlas_add_glyph(font, character)) {
 				continue;
 			}
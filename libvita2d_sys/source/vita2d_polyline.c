@@ -0,0 +1,640 @@
+#include <kernel.h>
+#include <libdbg.h>
+#include <arm_neon.h>
+#include <sceconst.h>
+#include <libfpu.h>
+#include "vita2d_sys.h"
+
+#include "shared.h"
+#include "heap.h"
+
+extern void* vita2d_heap_internal;
+
+/*
+ * Thick polylines.
+ *
+ * Every joint is extruded into 4 vertices across the line: the outer two are
+ * fully transparent and 1 pixel away from the inner two, so the edges fade out
+ * over a pixel instead of aliasing. Segments are 3 quads between the vertex
+ * groups of their ends and the whole polyline goes into one indexed draw,
+ * with 32 bit indices once it needs more than 65536 vertices.
+ *
+ * Miter joins share one group per joint, pushed out along the bisector and
+ * clamped to POLYLINE_MITER_LIMIT half widths. Round joins share the inner
+ * side of the joint, where both segments end at the miter point, and fill the
+ * outer side with a feathered wedge between the two segment edges. Nothing is
+ * covered twice, so translucent lines blend evenly across joints.
+ */
+
+#define POLYLINE_MITER_LIMIT	4.0f
+#define POLYLINE_FEATHER		1.0f
+#define POLYLINE_DISC_SEGMENTS	32
+#define POLYLINE_U16_VERTICES	65536
+
+static float disc_ring[POLYLINE_DISC_SEGMENTS * 2];
+
+static inline float32x4_t rsqrt_q(float32x4_t x)
+{
+	// Estimate refined with two Newton-Raphson steps
+	float32x4_t e = vrsqrteq_f32(x);
+	e = vmulq_f32(e, vrsqrtsq_f32(vmulq_f32(x, e), e));
+	e = vmulq_f32(e, vrsqrtsq_f32(vmulq_f32(x, e), e));
+	return e;
+}
+
+static inline float rsqrt(float x)
+{
+	return vgetq_lane_f32(rsqrt_q(vdupq_n_f32(x)), 0);
+}
+
+static inline float32x4_t recip_q(float32x4_t x)
+{
+	// Estimate refined with two Newton-Raphson steps
+	float32x4_t e = vrecpeq_f32(x);
+	e = vmulq_f32(e, vrecpsq_f32(x, e));
+	e = vmulq_f32(e, vrecpsq_f32(x, e));
+	return e;
+}
+
+static float *normals_reserve(vita2d_draw_ctx *ctx, unsigned int count)
+{
+	// Kept in the draw context, polylines may be built on several threads at once
+	if (count * 2 <= ctx->scratchSize)
+		return ctx->scratch;
+
+	float *ptr = heap_realloc_heap_memory(vita2d_heap_internal, ctx->scratch, count * 2 * sizeof(float));
+	if (!ptr) {
+		SCE_DBG_LOG_ERROR("[POLYLINE] heap_realloc_heap_memory() returned NULL");
+		return NULL;
+	}
+
+	ctx->scratch = ptr;
+	ctx->scratchSize = count * 2;
+	return ptr;
+}
+
+/*
+ * Unit normals of all count - 1 segments into normals[].
+ * Returns 0 if all points coincide.
+ */
+static int polyline_normals(float *normals, const float *points, unsigned int count)
+{
+	unsigned int segments = count - 1;
+	unsigned int i = 0;
+	int first_valid = -1;
+
+	const float32x4_t eps = vdupq_n_f32(1e-12f);
+
+	for (; i + 4 <= segments; i += 4) {
+		float32x4x2_t p0 = vld2q_f32(points + i * 2);
+		float32x4x2_t p1 = vld2q_f32(points + i * 2 + 2);
+		float32x4x2_t n;
+
+		float32x4_t dx = vsubq_f32(p1.val[0], p0.val[0]);
+		float32x4_t dy = vsubq_f32(p1.val[1], p0.val[1]);
+		float32x4_t len2 = vmlaq_f32(vmulq_f32(dx, dx), dy, dy);
+
+		// Zero length segments get a zero normal, patched below
+		uint32x4_t valid = vcgtq_f32(len2, eps);
+		float32x4_t inv_len = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(rsqrt_q(vmaxq_f32(len2, eps))), valid));
+
+		n.val[0] = vnegq_f32(vmulq_f32(dy, inv_len));
+		n.val[1] = vmulq_f32(dx, inv_len);
+		vst2q_f32(normals + i * 2, n);
+	}
+
+	for (; i < segments; i++) {
+		float dx = points[i * 2 + 2] - points[i * 2 + 0];
+		float dy = points[i * 2 + 3] - points[i * 2 + 1];
+		float len2 = dx * dx + dy * dy;
+		float inv_len = len2 > 1e-12f ? rsqrt(len2) : 0.0f;
+
+		normals[i * 2 + 0] = -dy * inv_len;
+		normals[i * 2 + 1] = dx * inv_len;
+	}
+
+	// Degenerate segments take the direction of the closest earlier one, leading ones the first valid one
+	for (i = 0; i < segments; i++) {
+		if (normals[i * 2 + 0] != 0.0f || normals[i * 2 + 1] != 0.0f) {
+			if (first_valid < 0)
+				first_valid = i;
+		}
+		else if (first_valid >= 0) {
+			normals[i * 2 + 0] = normals[i * 2 - 2];
+			normals[i * 2 + 1] = normals[i * 2 - 1];
+		}
+	}
+
+	if (first_valid < 0)
+		return 0;
+
+	for (i = 0; i < (unsigned int)first_valid; i++) {
+		normals[i * 2 + 0] = normals[first_valid * 2 + 0];
+		normals[i * 2 + 1] = normals[first_valid * 2 + 1];
+	}
+
+	return 1;
+}
+
+/* Returns 0 when the offset is not the exact miter, because the line folds back or the limit applies */
+static int miter_bisector(const float *n0, const float *n1, float *ox, float *oy)
+{
+	float mx = n0[0] + n1[0];
+	float my = n0[1] + n1[1];
+	float len2 = mx * mx + my * my;
+
+	// The line folds back onto itself, there is no bisector to follow
+	if (len2 < 1e-6f) {
+		*ox = n0[0];
+		*oy = n0[1];
+		return 0;
+	}
+
+	float inv_len = rsqrt(len2);
+	mx *= inv_len;
+	my *= inv_len;
+
+	// Half width along the bisector is 1 / cos(half angle), clamped by the miter limit
+	float cos_half = mx * n1[0] + my * n1[1];
+	int exact = cos_half * POLYLINE_MITER_LIMIT > 1.0f;
+	float scale = exact ? 1.0f / cos_half : POLYLINE_MITER_LIMIT;
+
+	*ox = mx * scale;
+	*oy = my * scale;
+
+	return exact;
+}
+
+static void miter_offset(const float *normals, unsigned int joint, unsigned int count, float *ox, float *oy)
+{
+	const float *n0 = &normals[(joint == 0 ? 0 : joint - 1) * 2];
+	const float *n1 = &normals[(joint == count - 1 ? joint - 1 : joint) * 2];
+
+	miter_bisector(n0, n1, ox, oy);
+}
+
+static void emit_group(vita2d_color_compact_vertex *vertices, float x, float y, float ox, float oy,
+	float inner, float outer, unsigned int color, unsigned int edge_color)
+{
+	vertices[0].x = x + ox * outer;
+	vertices[0].y = y + oy * outer;
+	vertices[0].color = edge_color;
+
+	vertices[1].x = x + ox * inner;
+	vertices[1].y = y + oy * inner;
+	vertices[1].color = color;
+
+	vertices[2].x = x - ox * inner;
+	vertices[2].y = y - oy * inner;
+	vertices[2].color = color;
+
+	vertices[3].x = x - ox * outer;
+	vertices[3].y = y - oy * outer;
+	vertices[3].color = edge_color;
+}
+
+/*
+ * Miter groups of 4 interior joints at once, points and normals point at the
+ * first joint and the normal of the segment after it. Same result as
+ * miter_offset() and emit_group() per joint.
+ */
+static void emit_miter_groups_q(vita2d_color_compact_vertex *vertices, const float *points, const float *normals,
+	float inner, float outer, float32x4_t colors)
+{
+	const float32x4_t eps = vdupq_n_f32(1e-6f);
+	const float32x4_t one = vdupq_n_f32(1.0f);
+	const float32x4_t limit = vdupq_n_f32(POLYLINE_MITER_LIMIT);
+	float32x4x2_t p = vld2q_f32(points);
+	float32x4x2_t n0 = vld2q_f32(normals - 2);
+	float32x4x2_t n1 = vld2q_f32(normals);
+	float32x4_t x[4], y[4];
+	float32x4x2_t tx01, tx23, ty01, ty23;
+	float32x4x3_t out;
+
+	float32x4_t mx = vaddq_f32(n0.val[0], n1.val[0]);
+	float32x4_t my = vaddq_f32(n0.val[1], n1.val[1]);
+	float32x4_t len2 = vmlaq_f32(vmulq_f32(mx, mx), my, my);
+	float32x4_t inv_len = rsqrt_q(vmaxq_f32(len2, eps));
+
+	mx = vmulq_f32(mx, inv_len);
+	my = vmulq_f32(my, inv_len);
+
+	float32x4_t cos_half = vmlaq_f32(vmulq_f32(mx, n1.val[0]), my, n1.val[1]);
+	uint32x4_t within = vcgtq_f32(vmulq_f32(cos_half, limit), one);
+	float32x4_t scale = vbslq_f32(within, recip_q(cos_half), limit);
+
+	// Folded back joints extrude along the normal of the segment before them
+	uint32x4_t fold = vcltq_f32(len2, eps);
+	mx = vbslq_f32(fold, n0.val[0], mx);
+	my = vbslq_f32(fold, n0.val[1], my);
+	scale = vbslq_f32(fold, one, scale);
+
+	float32x4_t ox = vmulq_f32(mx, scale);
+	float32x4_t oy = vmulq_f32(my, scale);
+
+	// Slots of emit_group(), one joint per lane
+	x[0] = vmlaq_n_f32(p.val[0], ox, outer);
+	y[0] = vmlaq_n_f32(p.val[1], oy, outer);
+	x[1] = vmlaq_n_f32(p.val[0], ox, inner);
+	y[1] = vmlaq_n_f32(p.val[1], oy, inner);
+	x[2] = vmlsq_n_f32(p.val[0], ox, inner);
+	y[2] = vmlsq_n_f32(p.val[1], oy, inner);
+	x[3] = vmlsq_n_f32(p.val[0], ox, outer);
+	y[3] = vmlsq_n_f32(p.val[1], oy, outer);
+
+	// Transpose to one joint per register, then interleave x, y, color into 4 vertices per store
+	tx01 = vtrnq_f32(x[0], x[1]);
+	tx23 = vtrnq_f32(x[2], x[3]);
+	ty01 = vtrnq_f32(y[0], y[1]);
+	ty23 = vtrnq_f32(y[2], y[3]);
+
+	out.val[2] = colors;
+
+	out.val[0] = vcombine_f32(vget_low_f32(tx01.val[0]), vget_low_f32(tx23.val[0]));
+	out.val[1] = vcombine_f32(vget_low_f32(ty01.val[0]), vget_low_f32(ty23.val[0]));
+	vst3q_f32((float *)&vertices[0], out);
+
+	out.val[0] = vcombine_f32(vget_low_f32(tx01.val[1]), vget_low_f32(tx23.val[1]));
+	out.val[1] = vcombine_f32(vget_low_f32(ty01.val[1]), vget_low_f32(ty23.val[1]));
+	vst3q_f32((float *)&vertices[4], out);
+
+	out.val[0] = vcombine_f32(vget_high_f32(tx01.val[0]), vget_high_f32(tx23.val[0]));
+	out.val[1] = vcombine_f32(vget_high_f32(ty01.val[0]), vget_high_f32(ty23.val[0]));
+	vst3q_f32((float *)&vertices[8], out);
+
+	out.val[0] = vcombine_f32(vget_high_f32(tx01.val[1]), vget_high_f32(tx23.val[1]));
+	out.val[1] = vcombine_f32(vget_high_f32(ty01.val[1]), vget_high_f32(ty23.val[1]));
+	vst3q_f32((float *)&vertices[12], out);
+}
+
+/* Groups of all count joints, interior joints go through NEON 4 at a time */
+static void emit_miter_groups(vita2d_color_compact_vertex *vertices, const float *points, const float *normals,
+	unsigned int count, float inner, float outer, unsigned int color, unsigned int edge_color)
+{
+	const uint32_t slot_colors[4] = { edge_color, color, color, edge_color };
+	const float32x4_t colors = vreinterpretq_f32_u32(vld1q_u32(slot_colors));
+	unsigned int j = 0;
+	float ox, oy;
+
+	while (j < count) {
+		if (j > 0 && j + 4 < count) {
+			emit_miter_groups_q(&vertices[j * 4], &points[j * 2], &normals[j * 2], inner, outer, colors);
+			j += 4;
+		}
+		else {
+			miter_offset(normals, j, count, &ox, &oy);
+			emit_group(&vertices[j * 4], points[j * 2], points[j * 2 + 1], ox, oy, inner, outer, color, edge_color);
+			j++;
+		}
+	}
+}
+
+/* Index output, u32 is set instead of u16 for polylines past POLYLINE_U16_VERTICES */
+typedef struct polyline_indices {
+	uint16_t *u16;
+	uint32_t *u32;
+} polyline_indices;
+
+static inline void put_index(polyline_indices *indices, unsigned int index)
+{
+	if (indices->u32)
+		*indices->u32++ = index;
+	else
+		*indices->u16++ = index;
+}
+
+/* Triangles between two vertex groups, given as emit_group() slots */
+static void emit_segment(polyline_indices *indices, const unsigned int *a, const unsigned int *b)
+{
+	unsigned int k;
+
+	// Feather, core, feather
+	for (k = 0; k < 3; k++) {
+		put_index(indices, a[k]);
+		put_index(indices, a[k + 1]);
+		put_index(indices, b[k]);
+		put_index(indices, b[k]);
+		put_index(indices, a[k + 1]);
+		put_index(indices, b[k + 1]);
+	}
+}
+
+static inline void group_slots(unsigned int *slots, unsigned int base)
+{
+	slots[0] = base;
+	slots[1] = base + 1;
+	slots[2] = base + 2;
+	slots[3] = base + 3;
+}
+
+/* Wedge steps of a round joint: the turn angle in steps of the ring, rounded up */
+static unsigned int round_steps(const float *n0, const float *n1, unsigned int segments)
+{
+	const float dot = n0[0] * n1[0] + n0[1] * n1[1];
+	const unsigned int stride = POLYLINE_DISC_SEGMENTS / segments;
+	unsigned int steps = 0;
+
+	while (steps < segments / 2 && disc_ring[steps * stride * 2] > dot + 1e-4f)
+		steps++;
+
+	return steps;
+}
+
+static inline unsigned int round_joint_vertex_count(unsigned int steps)
+{
+	return 5 + 2 * (steps + 1);
+}
+
+/*
+ * Round joint at points[0], points[1] between the segments from points[-2],
+ * points[-1] with normal n0 and to points[2], points[3] with normal n1.
+ *
+ * Vertex 0 is the apex of the wedge, 1 and 2 close the inner side of the
+ * first segment, 3 and 4 open the inner side of the second one, core and
+ * feather pairs of the outer arc follow. When the inner edges meet within
+ * both segments, they all sit on the inner miter point and nothing overlaps.
+ * Otherwise (sharp turns, short segments) each segment keeps its own inner
+ * side and the wedge fans out from the joint. end[] and start[] receive the
+ * groups closing the first segment and opening the second one.
+ *
+ * Returns the number of vertices written.
+ */
+static unsigned int emit_round_joint(vita2d_color_compact_vertex *vertices, polyline_indices *indices, unsigned int base,
+	const float *points, const float *n0, const float *n1, unsigned int segments, float inner, float outer,
+	unsigned int color, unsigned int edge_color, unsigned int *end, unsigned int *start)
+{
+	const float x = points[0];
+	const float y = points[1];
+	const unsigned int stride = POLYLINE_DISC_SEGMENTS / segments;
+	const unsigned int steps = round_steps(n0, n1, segments);
+	const float cross = n0[0] * n1[1] - n0[1] * n1[0];
+	// Outer side of the turn along the segment normals, the rotation from n0 to n1 has the sign of cross
+	const float side = cross > 0.0f ? -1.0f : 1.0f;
+	const float step_cos = disc_ring[stride * 2 + 0];
+	const float step_sin = cross > 0.0f ? disc_ring[stride * 2 + 1] : -disc_ring[stride * 2 + 1];
+	float mx, my, dx, dy, t, reach2, len2, shortest2;
+	unsigned int k;
+
+	// The feather edges meet outer * tan(half angle) along the segments, both segment ends may need it
+	int shared = miter_bisector(n0, n1, &mx, &my);
+	if (shared) {
+		reach2 = outer * outer * (mx * mx + my * my - 1.0f) * 4.0f;
+		dx = x - points[-2];
+		dy = y - points[-1];
+		shortest2 = dx * dx + dy * dy;
+		dx = points[2] - x;
+		dy = points[3] - y;
+		len2 = dx * dx + dy * dy;
+		if (len2 < shortest2)
+			shortest2 = len2;
+		shared = reach2 <= shortest2;
+	}
+
+	if (shared) {
+		vertices[0].x = x - side * mx * inner;
+		vertices[0].y = y - side * my * inner;
+		vertices[0].color = color;
+
+		vertices[2].x = x - side * mx * outer;
+		vertices[2].y = y - side * my * outer;
+		vertices[2].color = edge_color;
+
+		vertices[1] = vertices[0];
+		vertices[3] = vertices[0];
+		vertices[4] = vertices[2];
+	}
+	else {
+		vertices[0].x = x;
+		vertices[0].y = y;
+		vertices[0].color = color;
+
+		vertices[1].x = x - side * n0[0] * inner;
+		vertices[1].y = y - side * n0[1] * inner;
+		vertices[1].color = color;
+
+		vertices[2].x = x - side * n0[0] * outer;
+		vertices[2].y = y - side * n0[1] * outer;
+		vertices[2].color = edge_color;
+
+		vertices[3].x = x - side * n1[0] * inner;
+		vertices[3].y = y - side * n1[1] * inner;
+		vertices[3].color = color;
+
+		vertices[4].x = x - side * n1[0] * outer;
+		vertices[4].y = y - side * n1[1] * outer;
+		vertices[4].color = edge_color;
+	}
+
+	dx = side * n0[0];
+	dy = side * n0[1];
+
+	for (k = 0; k <= steps; k++) {
+		if (k == steps && k > 0) {
+			dx = side * n1[0];
+			dy = side * n1[1];
+		}
+
+		vertices[5 + k * 2].x = x + dx * inner;
+		vertices[5 + k * 2].y = y + dy * inner;
+		vertices[5 + k * 2].color = color;
+
+		vertices[6 + k * 2].x = x + dx * outer;
+		vertices[6 + k * 2].y = y + dy * outer;
+		vertices[6 + k * 2].color = edge_color;
+
+		t = dx * step_cos - dy * step_sin;
+		dy = dx * step_sin + dy * step_cos;
+		dx = t;
+	}
+
+	// emit_group() order runs from the positive normal side to the negative one
+	if (side > 0.0f) {
+		end[0] = base + 6;
+		end[1] = base + 5;
+		end[2] = base + 1;
+		end[3] = base + 2;
+		start[0] = base + 6 + steps * 2;
+		start[1] = base + 5 + steps * 2;
+		start[2] = base + 3;
+		start[3] = base + 4;
+	}
+	else {
+		end[0] = base + 2;
+		end[1] = base + 1;
+		end[2] = base + 5;
+		end[3] = base + 6;
+		start[0] = base + 4;
+		start[1] = base + 3;
+		start[2] = base + 5 + steps * 2;
+		start[3] = base + 6 + steps * 2;
+	}
+
+	for (k = 0; k < steps; k++) {
+		const unsigned int c0 = base + 5 + k * 2;
+		const unsigned int c1 = c0 + 2;
+
+		// Core fans out from the apex, the feather follows the arc
+		put_index(indices, base);
+		put_index(indices, c0);
+		put_index(indices, c1);
+
+		put_index(indices, c0);
+		put_index(indices, c0 + 1);
+		put_index(indices, c1);
+		put_index(indices, c1);
+		put_index(indices, c0 + 1);
+		put_index(indices, c1 + 1);
+	}
+
+	return round_joint_vertex_count(steps);
+}
+
+void vita2d_draw_polyline(const float *points, unsigned int count, float thickness, vita2d_line_join join, unsigned int color)
+{
+	unsigned int i, base, vertex_count, index_count, disc_segments = 0;
+	unsigned int start[4], end[4];
+	unsigned int edge_color, alpha;
+	polyline_indices indices;
+	int wide;
+	float x_min, y_min, x_max, y_max, extent;
+	float inner, outer;
+	float *normals;
+
+	if (!points || count < 2 || thickness <= 0.0f)
+		return;
+
+	// Thinner than the feather: draw a pixel wide line with the coverage folded into alpha
+	if (thickness < POLYLINE_FEATHER) {
+		alpha = (unsigned int)((float)(color >> 24) * thickness);
+		color = (color & 0x00FFFFFF) | (alpha << 24);
+		inner = 0.0f;
+	}
+	else {
+		inner = (thickness - POLYLINE_FEATHER) * 0.5f;
+	}
+
+	outer = inner + POLYLINE_FEATHER;
+	edge_color = color & 0x00FFFFFF;
+
+	x_min = x_max = points[0];
+	y_min = y_max = points[1];
+	for (i = 1; i < count; i++) {
+		if (points[i * 2 + 0] < x_min) x_min = points[i * 2 + 0];
+		if (points[i * 2 + 0] > x_max) x_max = points[i * 2 + 0];
+		if (points[i * 2 + 1] < y_min) y_min = points[i * 2 + 1];
+		if (points[i * 2 + 1] > y_max) y_max = points[i * 2 + 1];
+	}
+
+	extent = join == VITA2D_LINE_JOIN_MITER ? outer * POLYLINE_MITER_LIMIT : outer;
+
+	int visibility = _vita2d_visibility(x_min - extent, y_min - extent, x_max + extent, y_max + extent);
+	if (visibility == VITA2D_CLIP_OUTSIDE)
+		return;
+	if (visibility == VITA2D_CLIP_PARTIAL)
+		_vita2d_clip_require_stencil();
+
+	normals = normals_reserve(_vita2d_ctx(), count - 1);
+	if (!normals || !polyline_normals(normals, points, count))
+		return;
+
+	if (join == VITA2D_LINE_JOIN_ROUND) {
+		unsigned int steps;
+
+		disc_segments = outer < 4.0f ? 8 : outer < 16.0f ? 16 : POLYLINE_DISC_SEGMENTS;
+
+		vertex_count = 8;
+		index_count = (count - 1) * 18;
+		for (i = 1; i < count - 1; i++) {
+			steps = round_steps(&normals[i * 2 - 2], &normals[i * 2], disc_segments);
+			vertex_count += round_joint_vertex_count(steps);
+			index_count += steps * 9;
+		}
+	}
+	else {
+		vertex_count = count * 4;
+		index_count = (count - 1) * 18;
+	}
+
+	_vita2d_batch_flush();
+
+	const vita2d_draw_ctx *ctx = _vita2d_ctx();
+
+	_vita2d_set_vertex_program(_vita2d_colorCompactVertexProgram);
+	_vita2d_set_fragment_program(ctx->programs->colorCompact);
+	_vita2d_set_wvp(_vita2d_colorCompactWvpParam, ctx->ortho);
+
+	// Winding flips with the direction of every turn
+	_vita2d_set_front_polygon_mode(SCE_GXM_POLYGON_MODE_TRIANGLE_FILL);
+	_vita2d_set_back_polygon_mode(SCE_GXM_POLYGON_MODE_TRIANGLE_FILL);
+
+	// One draw for the whole polyline, long ones need 32 bit indices
+	wide = vertex_count > POLYLINE_U16_VERTICES;
+
+	vita2d_color_compact_vertex *vertices = (vita2d_color_compact_vertex *)vita2d_pool_memalign(
+		vertex_count * sizeof(vita2d_color_compact_vertex),
+		sizeof(float));
+
+	void *index_data = vita2d_pool_memalign(
+		index_count * (wide ? sizeof(uint32_t) : sizeof(uint16_t)),
+		wide ? sizeof(uint32_t) : sizeof(uint16_t));
+
+	if (!vertices || !index_data)
+		return;
+
+	indices.u16 = wide ? NULL : (uint16_t *)index_data;
+	indices.u32 = wide ? (uint32_t *)index_data : NULL;
+
+	if (join == VITA2D_LINE_JOIN_ROUND) {
+		emit_group(&vertices[0], points[0], points[1], normals[0], normals[1], inner, outer, color, edge_color);
+		group_slots(start, 0);
+		base = 4;
+
+		for (i = 1; i < count - 1; i++) {
+			unsigned int next[4];
+
+			base += emit_round_joint(&vertices[base], &indices, base, &points[i * 2],
+				&normals[i * 2 - 2], &normals[i * 2], disc_segments, inner, outer, color, edge_color, end, next);
+			emit_segment(&indices, start, end);
+			sceClibMemcpy(start, next, sizeof(start));
+		}
+
+		emit_group(&vertices[base], points[i * 2], points[i * 2 + 1], normals[i * 2 - 2], normals[i * 2 - 1], inner, outer, color, edge_color);
+		group_slots(end, base);
+		emit_segment(&indices, start, end);
+	}
+	else {
+		emit_miter_groups(vertices, points, normals, count, inner, outer, color, edge_color);
+
+		for (i = 0; i < count - 1; i++) {
+			group_slots(start, i * 4);
+			group_slots(end, i * 4 + 4);
+			emit_segment(&indices, start, end);
+		}
+	}
+
+	_vita2d_set_vertex_stream(0, vertices);
+	if (wide)
+		_vita2d_draw_u32(SCE_GXM_PRIMITIVE_TRIANGLES, index_data, index_count, vertex_count);
+	else
+		_vita2d_draw(SCE_GXM_PRIMITIVE_TRIANGLES, index_data, index_count, vertex_count);
+}
+
+void _vita2d_polyline_init(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < POLYLINE_DISC_SEGMENTS; i++) {
+		float theta = 2 * SCE_MATH_PI * (float)i / (float)POLYLINE_DISC_SEGMENTS;
+		disc_ring[i * 2 + 0] = sceFpuCosf(theta);
+		disc_ring[i * 2 + 1] = sceFpuSinf(theta);
+	}
+}
+
+void _vita2d_polyline_release(vita2d_draw_ctx *ctx)
+{
+	if (ctx->scratch)
+		heap_free_heap_memory(vita2d_heap_internal, ctx->scratch);
+
+	ctx->scratch = NULL;
+	ctx->scratchSize = 0;
+}
@@ -0,0 +1,330 @@
+#include <kernel.h>
+#include <gxm.h>
+#include <libdbg.h>
+#include "vita2d_sys.h"
+
+#include "shared.h"
+#include "heap.h"
+
+extern void* vita2d_heap_internal;
+
+/*
+ * Temp memory pool.
+ *
+ * The pool memory is split into POOL_FRAME_COUNT regions used round-robin,
+ * one per frame. Every scene ended while a region is current signals that
+ * region's notification once the GPU is done with its fragments, so moving
+ * to the next frame only waits if the GPU is still reading the region that
+ * is about to be reused, instead of serializing with sceGxmFinish().
+ *
+ * When a frame runs out of its region, allocations continue in overflow
+ * chunks chained to the frame. Chunks are kept and reused by the frame the
+ * next time around, they are only freed by vita2d_fini().
+ *
+ * Deferred contexts allocate from their own slice instead, it does not grow.
+ */
+
+#define POOL_FRAME_COUNT	2
+#define POOL_FRAME_ALIGN	256
+#define POOL_CHUNK_SIZE		(256 * 1024)
+
+// Notification slots are taken from the end of the region, reserved for the pool in vita2d_sys.h
+#define POOL_NOTIFICATION_INDEX	(SCE_GXM_NOTIFICATION_COUNT - POOL_FRAME_COUNT)
+
+typedef struct vita2d_pool_chunk {
+	struct vita2d_pool_chunk *next;
+	SceGxmDeviceMemInfo *mem;
+	unsigned int base;
+	unsigned int size;
+	unsigned int index;
+} vita2d_pool_chunk;
+
+typedef struct vita2d_pool_frame {
+	unsigned int base;
+	unsigned int index;
+	unsigned int used;
+	vita2d_pool_chunk *chunks;
+	vita2d_pool_chunk *chunk;		// Chunk being filled, NULL while the region still serves allocations
+	SceGxmNotification notification;
+} vita2d_pool_frame;
+
+static SceGxmDeviceMemInfo *poolMem = NULL;
+static vita2d_pool_frame frames[POOL_FRAME_COUNT];
+static vita2d_pool_frame *frame = NULL;
+static unsigned int frame_index = 0;
+static unsigned int frame_size = 0;
+static unsigned int frame_serial = 0;
+static unsigned int notification_value = 0;
+static vita2d_pool_stats stats;
+
+int _vita2d_pool_init(unsigned int size)
+{
+	int err;
+	unsigned int i;
+	volatile unsigned int *notificationRegion = sceGxmGetNotificationRegion();
+
+	err = sceGxmAllocDeviceMemLinux(
+		SCE_GXM_DEVICE_HEAP_ID_USER_NC,
+		SCE_GXM_MEMORY_ATTRIB_READ,
+		size,
+		POOL_FRAME_ALIGN,
+		&poolMem);
+
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("[POOL] sceGxmAllocDeviceMemLinux(): 0x%X", err);
+		return err;
+	}
+
+	frame_size = (size / POOL_FRAME_COUNT) & ~(POOL_FRAME_ALIGN - 1);
+	notification_value = 0;
+	sceClibMemset(&stats, 0, sizeof(stats));
+
+	for (i = 0; i < POOL_FRAME_COUNT; i++) {
+		frames[i].base = (unsigned int)poolMem->mappedBase + i * frame_size;
+		frames[i].index = 0;
+		frames[i].used = 0;
+		frames[i].chunks = NULL;
+		frames[i].chunk = NULL;
+		frames[i].notification.address = &notificationRegion[POOL_NOTIFICATION_INDEX + i];
+		frames[i].notification.value = notification_value;
+		*frames[i].notification.address = notification_value;
+	}
+
+	frame_index = 0;
+	frame = &frames[frame_index];
+
+	return SCE_OK;
+}
+
+void _vita2d_pool_fini(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < POOL_FRAME_COUNT; i++) {
+		vita2d_pool_chunk *chunk = frames[i].chunks;
+		while (chunk) {
+			vita2d_pool_chunk *next = chunk->next;
+			sceGxmFreeDeviceMemLinux(chunk->mem);
+			heap_free_heap_memory(vita2d_heap_internal, chunk);
+			chunk = next;
+		}
+		frames[i].chunks = NULL;
+		frames[i].chunk = NULL;
+	}
+
+	sceGxmFreeDeviceMemLinux(poolMem);
+	poolMem = NULL;
+	frame = NULL;
+}
+
+void _vita2d_pool_next_frame(void)
+{
+	_vita2d_batch_flush();
+
+	frame_index = (frame_index + 1) % POOL_FRAME_COUNT;
+	frame = &frames[frame_index];
+	frame_serial++;
+
+	// The GPU may still be reading vertices written into this region POOL_FRAME_COUNT frames ago
+	if (*frame->notification.address != frame->notification.value)
+		sceGxmNotificationWait(&frame->notification);
+
+	frame->index = 0;
+	frame->used = 0;
+	frame->chunk = NULL;
+}
+
+const SceGxmNotification *_vita2d_pool_scene_notification(void)
+{
+	/*
+	 * Scenes complete in submission order, a fresh value per scene makes the
+	 * last scene that used the region the one the next reuse waits for.
+	 */
+	frame->notification.value = ++notification_value;
+	return &frame->notification;
+}
+
+unsigned int _vita2d_pool_frame_serial(void)
+{
+	return frame_serial;
+}
+
+int _vita2d_pool_frame_done(unsigned int serial)
+{
+	// Moving to a frame waited for the GPU to finish the one POOL_FRAME_COUNT frames before it
+	return frame_serial - serial >= POOL_FRAME_COUNT;
+}
+
+static vita2d_pool_chunk *pool_chunk_create(unsigned int size)
+{
+	int err;
+
+	vita2d_pool_chunk *chunk = heap_alloc_heap_memory(vita2d_heap_internal, sizeof(*chunk));
+	if (!chunk) {
+		SCE_DBG_LOG_ERROR("[POOL] heap_alloc_heap_memory() returned NULL");
+		return NULL;
+	}
+
+	size = (size + POOL_FRAME_ALIGN - 1) & ~(POOL_FRAME_ALIGN - 1);
+	if (size < POOL_CHUNK_SIZE)
+		size = POOL_CHUNK_SIZE;
+
+	err = sceGxmAllocDeviceMemLinux(
+		SCE_GXM_DEVICE_HEAP_ID_USER_NC,
+		SCE_GXM_MEMORY_ATTRIB_READ,
+		size,
+		POOL_FRAME_ALIGN,
+		&chunk->mem);
+
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("[POOL] sceGxmAllocDeviceMemLinux(): 0x%X", err);
+		heap_free_heap_memory(vita2d_heap_internal, chunk);
+		return NULL;
+	}
+
+	chunk->next = NULL;
+	chunk->base = (unsigned int)chunk->mem->mappedBase;
+	chunk->size = size;
+	chunk->index = 0;
+
+	stats.chunk_count++;
+	stats.chunk_size += size;
+
+	return chunk;
+}
+
+static void *pool_chunk_alloc(unsigned int size, unsigned int alignment)
+{
+	vita2d_pool_chunk *chunk = frame->chunk;
+	vita2d_pool_chunk *last = NULL;
+	unsigned int new_index;
+
+	if (!chunk) {
+		// First overflow of this frame
+		stats.overflow_count++;
+		chunk = frame->chunks;
+		if (chunk)
+			chunk->index = 0;
+	}
+
+	// Continue in the current chunk, then in the ones kept from earlier frames
+	while (chunk) {
+		new_index = (chunk->index + alignment - 1) & ~(alignment - 1);
+		if ((new_index + size) <= chunk->size)
+			break;
+		last = chunk;
+		chunk = chunk->next;
+		if (chunk)
+			chunk->index = 0;
+	}
+
+	if (!chunk) {
+		chunk = pool_chunk_create(size + alignment);
+		if (!chunk)
+			return NULL;
+
+		if (last)
+			last->next = chunk;
+		else
+			frame->chunks = chunk;
+
+		new_index = 0;
+	}
+
+	frame->chunk = chunk;
+	frame->used += new_index - chunk->index + size;
+	chunk->index = new_index + size;
+
+	return (void *)(chunk->base + new_index);
+}
+
+static void *pool_slice_alloc(vita2d_draw_ctx *ctx, unsigned int size, unsigned int alignment)
+{
+	unsigned int new_index = (ctx->sliceIndex + alignment - 1) & ~(alignment - 1);
+
+	if ((new_index + size) > ctx->sliceSize)
+		return NULL;
+
+	ctx->sliceIndex = new_index + size;
+
+	return (void *)(ctx->sliceBase + new_index);
+}
+
+static void *pool_alloc(unsigned int size, unsigned int alignment)
+{
+	vita2d_draw_ctx *ctx = _vita2d_ctx();
+	void *addr;
+
+	if (ctx->sliceSize)
+		return pool_slice_alloc(ctx, size, alignment);
+
+	/*
+	 * Once a frame overflowed it stays in the chunks, going back to the tail of
+	 * the region would only break up consecutive allocations.
+	 */
+	if (!frame->chunk) {
+		unsigned int new_index = (frame->index + alignment - 1) & ~(alignment - 1);
+		if ((new_index + size) < frame_size) {
+			addr = (void *)(frame->base + new_index);
+			frame->used += new_index - frame->index + size;
+			frame->index = new_index + size;
+			goto _pool_alloc_done;
+		}
+	}
+
+	addr = pool_chunk_alloc(size, alignment);
+	if (!addr)
+		return NULL;
+
+_pool_alloc_done:
+
+	if (frame->used > stats.high_water)
+		stats.high_water = frame->used;
+
+	return addr;
+}
+
+void *vita2d_pool_malloc(unsigned int size)
+{
+	return pool_alloc(size, 1);
+}
+
+void *vita2d_pool_memalign(unsigned int size, unsigned int alignment)
+{
+	return pool_alloc(size, alignment);
+}
+
+unsigned int vita2d_pool_free_space()
+{
+	vita2d_draw_ctx *ctx = _vita2d_ctx();
+
+	if (ctx->sliceSize)
+		return ctx->sliceSize - ctx->sliceIndex;
+
+	if (frame->chunk)
+		return frame->chunk->size - frame->chunk->index;
+
+	return frame_size - frame->index;
+}
+
+void vita2d_pool_reset()
+{
+	_vita2d_batch_flush();
+
+	// A slice is referenced by the command list being recorded until it is executed
+	if (_vita2d_ctx()->sliceSize)
+		return;
+
+	frame->index = 0;
+	frame->used = 0;
+	frame->chunk = NULL;
+}
+
+void vita2d_get_pool_stats(vita2d_pool_stats *out)
+{
+	if (!out)
+		return;
+
+	*out = stats;
+	out->used = frame->used;
+}
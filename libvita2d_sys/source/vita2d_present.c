@@ -0,0 +1,211 @@
+#include <kernel.h>
+#include <appmgr.h>
+#include <libdbg.h>
+#include "vita2d_sys.h"
+
+#include "present.h"
+#include "shared.h"
+
+/*
+ * Present thread.
+ *
+ * In system mode the shared framebuffer has to be begun before a frame can
+ * be drawn and ended, after the vblank wait, once it is done. Both block, so
+ * with a present thread they are moved off the rendering thread: finished
+ * frames are handed over through a single-producer/single-consumer ring, the
+ * present thread paces the frame, ends it and begins the next one right
+ * away. The rendering thread only waits in vita2d_start_drawing() if it got
+ * ahead of the display.
+ *
+ * The ring itself is lock-free, the semaphores only let either side sleep
+ * instead of spinning.
+ */
+
+#define PRESENT_QUEUE_SIZE			4	// Power of two
+#define PRESENT_THREAD_STACK_SIZE	(4 * 1024)
+
+// Orders ring slot writes against the index that publishes them
+#define PRESENT_BARRIER()			__builtin_dmb()
+
+typedef struct vita2d_present_item {
+	int quit;
+	int pace;		// Wait for the swap interval before ending the frame
+} vita2d_present_item;
+
+static vita2d_present_item queue[PRESENT_QUEUE_SIZE];
+static volatile unsigned int queue_head = 0;	// Written by the rendering thread only
+static volatile unsigned int queue_tail = 0;	// Written by the present thread only
+static volatile unsigned int presented = 0;
+
+static SceUID present_thread_id = SCE_UID_INVALID_UID;
+static SceUID item_sema = SCE_UID_INVALID_UID;		// Frames in the ring
+static SceUID ready_sema = SCE_UID_INVALID_UID;		// Back buffer begun by the present thread
+static SceUID present_shfb_id;
+static SceSharedFbInfo present_info;
+
+static int queue_push(int quit, int pace)
+{
+	unsigned int head = queue_head;
+	vita2d_present_item *item;
+
+	if (head - queue_tail == PRESENT_QUEUE_SIZE)
+		return 0;
+
+	item = &queue[head & (PRESENT_QUEUE_SIZE - 1)];
+	item->quit = quit;
+	item->pace = pace;
+
+	PRESENT_BARRIER();
+	queue_head = head + 1;
+
+	sceKernelSignalSema(item_sema, 1);
+
+	return 1;
+}
+
+static void queue_pop(vita2d_present_item *item)
+{
+	unsigned int tail = queue_tail;
+
+	sceKernelWaitSema(item_sema, 1, NULL);
+
+	PRESENT_BARRIER();
+	*item = queue[tail & (PRESENT_QUEUE_SIZE - 1)];
+
+	PRESENT_BARRIER();
+	queue_tail = tail + 1;
+}
+
+static int present_thread(SceSize args, void *argp)
+{
+	vita2d_present_item item;
+
+	while (1) {
+		// Begin the next frame right away, the rendering thread picks it up in vita2d_start_drawing()
+		sceSharedFbBegin(present_shfb_id, &present_info);
+		sceKernelSignalSema(ready_sema, 1);
+
+		queue_pop(&item);
+
+		if (item.pace)
+			_vita2d_frame_pacing_wait();
+
+		sceSharedFbEnd(present_shfb_id);
+
+		if (item.quit)
+			break;
+
+		presented++;
+	}
+
+	return 0;
+}
+
+int _vita2d_present_init(SceUID shfb_id)
+{
+	int err;
+
+	present_shfb_id = shfb_id;
+	queue_head = 0;
+	queue_tail = 0;
+	presented = 0;
+
+	item_sema = sceKernelCreateSema("vita2d_present_item", 0, 0, PRESENT_QUEUE_SIZE, NULL);
+	if (item_sema < 0) {
+		SCE_DBG_LOG_ERROR("[PRESENT] sceKernelCreateSema(): 0x%X", item_sema);
+		err = item_sema;
+		goto _present_init_error;
+	}
+
+	ready_sema = sceKernelCreateSema("vita2d_present_ready", 0, 0, 1, NULL);
+	if (ready_sema < 0) {
+		SCE_DBG_LOG_ERROR("[PRESENT] sceKernelCreateSema(): 0x%X", ready_sema);
+		err = ready_sema;
+		goto _present_init_error;
+	}
+
+	present_thread_id = sceKernelCreateThread(
+		"vita2d_present",
+		present_thread,
+		SCE_KERNEL_HIGHEST_PRIORITY_USER,
+		PRESENT_THREAD_STACK_SIZE,
+		0,
+		SCE_KERNEL_THREAD_CPU_AFFINITY_MASK_DEFAULT,
+		NULL);
+
+	if (present_thread_id < 0) {
+		SCE_DBG_LOG_ERROR("[PRESENT] sceKernelCreateThread(): 0x%X", present_thread_id);
+		err = present_thread_id;
+		goto _present_init_error;
+	}
+
+	err = sceKernelStartThread(present_thread_id, 0, NULL);
+	if (err != SCE_OK) {
+		SCE_DBG_LOG_ERROR("[PRESENT] sceKernelStartThread(): 0x%X", err);
+		sceKernelDeleteThread(present_thread_id);
+		goto _present_init_error;
+	}
+
+	return SCE_OK;
+
+_present_init_error:
+
+	if (ready_sema >= 0)
+		sceKernelDeleteSema(ready_sema);
+	if (item_sema >= 0)
+		sceKernelDeleteSema(item_sema);
+
+	present_thread_id = SCE_UID_INVALID_UID;
+	ready_sema = SCE_UID_INVALID_UID;
+	item_sema = SCE_UID_INVALID_UID;
+
+	return err;
+}
+
+void _vita2d_present_fini(void)
+{
+	if (present_thread_id < 0)
+		return;
+
+	// The present thread ends the frame it began and exits
+	while (!queue_push(1, 0))
+		sceKernelDelayThread(1000);
+
+	sceKernelWaitThreadEnd(present_thread_id, NULL, NULL);
+	sceKernelDeleteThread(present_thread_id);
+	sceKernelDeleteSema(ready_sema);
+	sceKernelDeleteSema(item_sema);
+
+	present_thread_id = SCE_UID_INVALID_UID;
+	ready_sema = SCE_UID_INVALID_UID;
+	item_sema = SCE_UID_INVALID_UID;
+}
+
+int _vita2d_present_enabled(void)
+{
+	return present_thread_id >= 0;
+}
+
+void _vita2d_present_acquire(SceSharedFbInfo *info)
+{
+	sceKernelWaitSema(ready_sema, 1, NULL);
+	*info = present_info;
+}
+
+int _vita2d_present_submit(void)
+{
+	if (!queue_push(0, 1)) {
+		SCE_DBG_LOG_ERROR("[PRESENT] present queue is full");
+		return VITA2D_SYS_ERROR_INVALID_STATE;
+	}
+
+	return SCE_OK;
+}
+
+unsigned int _vita2d_present_pending(void)
+{
+	if (present_thread_id < 0)
+		return 0;
+
+	return queue_head - presented;
+}
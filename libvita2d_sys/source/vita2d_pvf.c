@@ -384,6 +384,9 @@ int generic_pvf_draw_text(vita2d_pvf *font, int draw, int *height,
 	float pen_x = x;
 	float pen_y = y;
 
+	if (draw)
+		VITA2D_STAT_ADD(_vita2d_ctx(), textDraws, 1);
+
 	for (i = 0; text[i];) {
 		i += utf8_to_ucs2(&text[i], &character);
 
@@ -398,6 +401,8 @@ int generic_pvf_draw_text(vita2d_pvf *font, int draw, int *height,
 		fontid = get_font_for_character(font, character);
 
 		if (!texture_atlas_get(font->atlas, character, &rect, &data)) {
+			VITA2D_STAT_ADD(_vita2d_ctx(), glyphMisses, 1);
+
 			if (!atlas_add_glyph(font, fontid, character))
 				continue;
 
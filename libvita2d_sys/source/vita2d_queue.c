@@ -0,0 +1,454 @@
+#include <kernel.h>
+#include <libdbg.h>
+#include "vita2d_sys.h"
+
+#include "utils.h"
+#include "shared.h"
+#include "heap.h"
+
+extern void* vita2d_heap_internal;
+
+/*
+ * Deferred quad queue.
+ *
+ * While deferred mode is enabled, batchable quads (rectangles, texture quads,
+ * text) are written into a cached staging buffer and recorded together with
+ * the current layer instead of being drawn. Any flush point (non-batchable
+ * draw, state change, end of scene) submits the queue:
+ * - layers are submitted in ascending order, recording order is kept otherwise,
+ * - within a layer a quad joins an earlier bucket with the same programs and
+ *   texture only if it does not overlap any bucket it would be moved across,
+ *   so painter's order is kept wherever primitives overlap,
+ * - every bucket is copied into the temp pool and drawn with one call.
+ *
+ * With depth sorting enabled every layer also gets its own depth. Opaque quads
+ * (drawn with VITA2D_BLEND_MODE_OPAQUE) are submitted first, front layer first,
+ * with depth test and write enabled, so hidden parts of lower layers are
+ * rejected before shading. Everything else follows back to front with depth
+ * test only. An opaque quad stays in the translucent pass when it overlaps an
+ * earlier quad of its own layer that does, both would share a depth otherwise.
+ */
+
+#define QUEUE_MAX_ITEMS		2048
+#define QUEUE_STAGING_SIZE	(128 * 1024)
+#define QUEUE_MERGE_WINDOW	64
+// Depth of a layer slot, cleared depth is 1.0 and every submit takes slots below the previous one
+#define QUEUE_DEPTH_STEP	(1.0f / 65536.0f)
+
+enum {
+	QUEUE_PASS_ALL,
+	QUEUE_PASS_OPAQUE,
+	QUEUE_PASS_TRANSLUCENT
+};
+
+typedef struct vita2d_queue_key {
+	const SceGxmVertexProgram *vertexProgram;
+	const SceGxmFragmentProgram *fragmentProgram;
+	const SceGxmProgramParameter *wvpParam;
+	const SceGxmTexture *texture;
+	unsigned int stride;
+} vita2d_queue_key;
+
+typedef struct vita2d_queue_item {
+	vita2d_queue_key key;
+	int layer;
+	int opaque;
+	int promoted;
+	unsigned int offset;
+	unsigned int quadCount;
+	int next;
+} vita2d_queue_item;
+
+typedef struct vita2d_queue_bucket {
+	int first;
+	int last;
+	unsigned int quadCount;
+	float x_min;
+	float y_min;
+	float x_max;
+	float y_max;
+} vita2d_queue_bucket;
+
+static int queue_enabled = 0;
+static int queue_layer = 0;
+static int depth_sorting = 0;
+static int depth_active = 0;
+static float depth_cursor = 1.0f;
+static vita2d_queue_item *items = NULL;
+static vita2d_queue_bucket *buckets = NULL;
+static int *layers = NULL;
+static unsigned char *staging = NULL;
+static unsigned int item_count = 0;
+static unsigned int staging_index = 0;
+static int submitting = 0;
+
+static int queue_alloc(void)
+{
+	items = heap_alloc_heap_memory(vita2d_heap_internal, QUEUE_MAX_ITEMS * sizeof(vita2d_queue_item));
+	buckets = heap_alloc_heap_memory(vita2d_heap_internal, QUEUE_MAX_ITEMS * sizeof(vita2d_queue_bucket));
+	layers = heap_alloc_heap_memory(vita2d_heap_internal, QUEUE_MAX_ITEMS * sizeof(int));
+	staging = heap_alloc_heap_memory(vita2d_heap_internal, QUEUE_STAGING_SIZE);
+
+	if (!items || !buckets || !layers || !staging) {
+		SCE_DBG_LOG_ERROR("[QUEUE] heap_alloc_heap_memory() returned NULL");
+		_vita2d_queue_fini();
+		return VITA2D_SYS_ERROR_NO_MEMORY;
+	}
+
+	return SCE_OK;
+}
+
+void _vita2d_queue_fini(void)
+{
+	if (items)
+		heap_free_heap_memory(vita2d_heap_internal, items);
+	if (buckets)
+		heap_free_heap_memory(vita2d_heap_internal, buckets);
+	if (layers)
+		heap_free_heap_memory(vita2d_heap_internal, layers);
+	if (staging)
+		heap_free_heap_memory(vita2d_heap_internal, staging);
+
+	items = NULL;
+	buckets = NULL;
+	layers = NULL;
+	staging = NULL;
+	queue_enabled = 0;
+	depth_sorting = 0;
+	depth_active = 0;
+	item_count = 0;
+	staging_index = 0;
+}
+
+int _vita2d_queue_enabled(void)
+{
+	// Submission draws through the regular batch path
+	return queue_enabled && !submitting;
+}
+
+static int key_equal(const vita2d_queue_key *a, const vita2d_queue_key *b)
+{
+	return a->vertexProgram == b->vertexProgram
+		&& a->fragmentProgram == b->fragmentProgram
+		&& a->texture == b->texture;
+}
+
+static void item_bounds(const vita2d_queue_item *item, float *x_min, float *y_min, float *x_max, float *y_max)
+{
+	// Both quad vertex formats start with float x, y
+	const unsigned char *vertex = staging + item->offset;
+	unsigned int i;
+
+	*x_min = *x_max = ((const float *)vertex)[0];
+	*y_min = *y_max = ((const float *)vertex)[1];
+
+	for (i = 1; i < item->quadCount * 4; i++) {
+		const float *position = (const float *)(vertex + i * item->key.stride);
+		if (position[0] < *x_min) *x_min = position[0];
+		if (position[0] > *x_max) *x_max = position[0];
+		if (position[1] < *y_min) *y_min = position[1];
+		if (position[1] > *y_max) *y_max = position[1];
+	}
+}
+
+void _vita2d_queue_scene_begin(void)
+{
+	// Every scene starts with a cleared depth buffer
+	depth_cursor = 1.0f;
+	depth_active = depth_sorting;
+
+	// Immediate draws must neither test nor leave depth behind
+	if (depth_active)
+		_vita2d_set_depth_func(SCE_GXM_DEPTH_FUNC_ALWAYS, SCE_GXM_DEPTH_WRITE_DISABLED);
+}
+
+static int item_in_pass(const vita2d_queue_item *item, int pass)
+{
+	switch (pass) {
+	case QUEUE_PASS_OPAQUE:
+		return item->promoted;
+	case QUEUE_PASS_TRANSLUCENT:
+		return !item->promoted;
+	default:
+		return 1;
+	}
+}
+
+static void submit_bucket(const vita2d_queue_bucket *bucket, const float *wvp)
+{
+	const vita2d_queue_key *key = &items[bucket->first].key;
+	int i;
+
+	unsigned char *vertices = (unsigned char *)vita2d_pool_memalign(
+		bucket->quadCount * 4 * key->stride,
+		sizeof(float));
+
+	if (!vertices)
+		return;
+
+	unsigned char *dst = vertices;
+	for (i = bucket->first; i >= 0; i = items[i].next) {
+		unsigned int size = items[i].quadCount * 4 * key->stride;
+		sceClibMemcpy(dst, staging + items[i].offset, size);
+		dst += size;
+	}
+
+	_vita2d_batch_draw_quads(key->vertexProgram, key->fragmentProgram, key->wvpParam,
+		key->texture, vertices, key->stride, bucket->quadCount, wvp);
+}
+
+static void submit_layer(int layer, int pass, const float *wvp)
+{
+	unsigned int bucket_count = 0;
+	unsigned int i, j;
+
+	for (i = 0; i < item_count; i++) {
+		vita2d_queue_item *item = &items[i];
+		vita2d_queue_bucket *target = NULL;
+		float x_min, y_min, x_max, y_max;
+
+		if (item->layer != layer || !item_in_pass(item, pass))
+			continue;
+
+		item->next = -1;
+		item_bounds(item, &x_min, &y_min, &x_max, &y_max);
+
+		// Walk back to the closest bucket with the same state, stop at the first overlap
+		for (j = bucket_count; j > 0 && bucket_count - j < QUEUE_MERGE_WINDOW; j--) {
+			vita2d_queue_bucket *bucket = &buckets[j - 1];
+
+			if (key_equal(&items[bucket->first].key, &item->key)) {
+				target = bucket;
+				break;
+			}
+
+			if (x_min < bucket->x_max && x_max > bucket->x_min
+				&& y_min < bucket->y_max && y_max > bucket->y_min)
+				break;
+		}
+
+		if (target) {
+			items[target->last].next = i;
+			target->last = i;
+			target->quadCount += item->quadCount;
+			if (x_min < target->x_min) target->x_min = x_min;
+			if (y_min < target->y_min) target->y_min = y_min;
+			if (x_max > target->x_max) target->x_max = x_max;
+			if (y_max > target->y_max) target->y_max = y_max;
+		}
+		else {
+			target = &buckets[bucket_count++];
+			target->first = i;
+			target->last = i;
+			target->quadCount = item->quadCount;
+			target->x_min = x_min;
+			target->y_min = y_min;
+			target->x_max = x_max;
+			target->y_max = y_max;
+		}
+	}
+
+	for (i = 0; i < bucket_count; i++)
+		submit_bucket(&buckets[i], wvp);
+}
+
+static void promote_layer(int layer)
+{
+	float x_min, y_min, x_max, y_max;
+	float u_x_min = 0.0f, u_y_min = 0.0f, u_x_max = 0.0f, u_y_max = 0.0f;
+	int covered = 0;
+	unsigned int i;
+
+	// Union of the quads left in the translucent pass so far
+	for (i = 0; i < item_count; i++) {
+		vita2d_queue_item *item = &items[i];
+
+		if (item->layer != layer)
+			continue;
+
+		item_bounds(item, &x_min, &y_min, &x_max, &y_max);
+
+		item->promoted = item->opaque && (!covered
+			|| x_min >= u_x_max || x_max <= u_x_min
+			|| y_min >= u_y_max || y_max <= u_y_min);
+
+		if (item->promoted)
+			continue;
+
+		if (!covered) {
+			u_x_min = x_min;
+			u_y_min = y_min;
+			u_x_max = x_max;
+			u_y_max = y_max;
+			covered = 1;
+		}
+		else {
+			if (x_min < u_x_min) u_x_min = x_min;
+			if (y_min < u_y_min) u_y_min = y_min;
+			if (x_max > u_x_max) u_x_max = x_max;
+			if (y_max > u_y_max) u_y_max = y_max;
+		}
+	}
+}
+
+static unsigned int gather_layers(void)
+{
+	unsigned int layer_count = 0;
+	unsigned int i, j, k;
+
+	// Distinct layers in ascending order
+	for (i = 0; i < item_count; i++) {
+		int layer = items[i].layer;
+
+		for (j = layer_count; j > 0 && layers[j - 1] > layer; j--);
+
+		if (j > 0 && layers[j - 1] == layer)
+			continue;
+
+		for (k = layer_count; k > j; k--)
+			layers[k] = layers[k - 1];
+		layers[j] = layer;
+		layer_count++;
+	}
+
+	return layer_count;
+}
+
+static void layer_wvp(float *wvp, unsigned int rank)
+{
+	// Clip z of the quad vertices is 0, the depth goes into the z translation
+	matrix_copy(wvp, _vita2d_ctx()->ortho);
+	wvp[14] += depth_cursor - (rank + 1) * QUEUE_DEPTH_STEP;
+}
+
+static void submit_sorted(unsigned int layer_count)
+{
+	float wvp[4 * 4];
+	unsigned int i;
+
+	for (i = 0; i < layer_count; i++)
+		promote_layer(layers[i]);
+
+	// Opaque quads front to back, filling depth
+	_vita2d_set_depth_func(SCE_GXM_DEPTH_FUNC_LESS_EQUAL, SCE_GXM_DEPTH_WRITE_ENABLED);
+	for (i = layer_count; i > 0; i--) {
+		layer_wvp(wvp, i - 1);
+		submit_layer(layers[i - 1], QUEUE_PASS_OPAQUE, wvp);
+	}
+
+	// Everything else back to front, hidden fragments are rejected
+	_vita2d_set_depth_func(SCE_GXM_DEPTH_FUNC_LESS_EQUAL, SCE_GXM_DEPTH_WRITE_DISABLED);
+	for (i = 0; i < layer_count; i++) {
+		layer_wvp(wvp, i);
+		submit_layer(layers[i], QUEUE_PASS_TRANSLUCENT, wvp);
+	}
+
+	_vita2d_set_depth_func(SCE_GXM_DEPTH_FUNC_ALWAYS, SCE_GXM_DEPTH_WRITE_DISABLED);
+
+	// Following submits stay in front of this one
+	depth_cursor -= layer_count * QUEUE_DEPTH_STEP;
+}
+
+void _vita2d_queue_submit(void)
+{
+	unsigned int layer_count, i;
+
+	if (item_count == 0)
+		return;
+
+	submitting = 1;
+
+	layer_count = gather_layers();
+
+	// Out of depth slots for this scene, keep drawing in painter's order
+	if (depth_active && depth_cursor - layer_count * QUEUE_DEPTH_STEP > 0.0f) {
+		submit_sorted(layer_count);
+	}
+	else {
+		// Lowest layer first, one pass per distinct layer
+		for (i = 0; i < layer_count; i++)
+			submit_layer(layers[i], QUEUE_PASS_ALL, _vita2d_ctx()->ortho);
+	}
+
+	item_count = 0;
+	staging_index = 0;
+	submitting = 0;
+}
+
+void *_vita2d_queue_alloc_quads(const SceGxmVertexProgram *vertexProgram, const SceGxmFragmentProgram *fragmentProgram,
+	const SceGxmProgramParameter *wvpParam, const SceGxmTexture *texture, unsigned int stride, unsigned int count)
+{
+	unsigned int size = count * 4 * stride;
+
+	if (size > QUEUE_STAGING_SIZE)
+		return NULL;
+
+	if (item_count == QUEUE_MAX_ITEMS || staging_index + size > QUEUE_STAGING_SIZE)
+		_vita2d_queue_submit();
+
+	vita2d_queue_item *item = &items[item_count++];
+	item->key.vertexProgram = vertexProgram;
+	item->key.fragmentProgram = fragmentProgram;
+	item->key.wvpParam = wvpParam;
+	item->key.texture = texture;
+	item->key.stride = stride;
+	item->layer = queue_layer;
+	item->opaque = vita2d_get_blend_mode() == VITA2D_BLEND_MODE_OPAQUE;
+	item->promoted = 0;
+	item->offset = staging_index;
+	item->quadCount = count;
+
+	staging_index += size;
+
+	return staging + item->offset;
+}
+
+int vita2d_set_deferred_mode(int enable)
+{
+	int err;
+
+	if (enable && !items) {
+		err = queue_alloc();
+		if (err != SCE_OK)
+			return err;
+	}
+
+	if (!enable && queue_enabled) {
+		_vita2d_queue_submit();
+		queue_layer = 0;
+	}
+	else if (enable && !queue_enabled) {
+		// Quads already batched keep their place in front of the queue
+		_vita2d_batch_flush();
+	}
+
+	queue_enabled = enable;
+
+	return SCE_OK;
+}
+
+int vita2d_get_deferred_mode()
+{
+	return queue_enabled;
+}
+
+void vita2d_set_depth_sorting(int enable)
+{
+	// Draws earlier in the scene may have left depth behind, applied from the next scene on
+	depth_sorting = enable;
+}
+
+int vita2d_get_depth_sorting()
+{
+	return depth_sorting;
+}
+
+void vita2d_set_draw_layer(int layer)
+{
+	queue_layer = layer;
+}
+
+int vita2d_get_draw_layer()
+{
+	return queue_layer;
+}
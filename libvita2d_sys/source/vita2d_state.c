@@ -0,0 +1,211 @@
+#include <kernel.h>
+#include "vita2d_sys.h"
+
+#include "shared.h"
+
+/*
+ * Shadow copy of the GXM context state set by the library. Setters compare
+ * against it and skip calls that would not change anything. The copy is
+ * invalidated whenever the library cannot know what is bound on the context
+ * (scene start, direct context access by the application, command lists).
+ * Every draw context keeps its own copy.
+ */
+
+void _vita2d_state_invalidate(void)
+{
+	sceClibMemset(&_vita2d_ctx()->state, 0, sizeof(vita2d_state));
+}
+
+void _vita2d_state_reset_stats(void)
+{
+	vita2d_state_stats *stats = &_vita2d_ctx()->stateStats;
+
+	stats->issued = 0;
+	stats->elided = 0;
+}
+
+void _vita2d_set_vertex_stream(unsigned int index, const void *data)
+{
+	// Streams change with every draw, nothing to elide
+	sceGxmSetVertexStream(_vita2d_ctx()->context, index, data);
+}
+
+void _vita2d_set_vertex_program(const SceGxmVertexProgram *program)
+{
+	vita2d_draw_ctx *ctx = _vita2d_ctx();
+	vita2d_state *state = &ctx->state;
+	vita2d_state_stats *stats = &ctx->stateStats;
+
+	if (state->vertexProgram == program) {
+		stats->elided++;
+		return;
+	}
+
+	sceGxmSetVertexProgram(ctx->context, program);
+	state->vertexProgram = program;
+	// Default uniform buffer layout is per program
+	state->wvpProgram = NULL;
+	stats->issued++;
+	VITA2D_STAT_ADD(ctx, programBinds, 1);
+}
+
+void _vita2d_set_fragment_program(const SceGxmFragmentProgram *program)
+{
+	vita2d_draw_ctx *ctx = _vita2d_ctx();
+	vita2d_state *state = &ctx->state;
+	vita2d_state_stats *stats = &ctx->stateStats;
+
+	if (state->fragmentProgram == program) {
+		stats->elided++;
+		return;
+	}
+
+	sceGxmSetFragmentProgram(ctx->context, program);
+	state->fragmentProgram = program;
+	stats->issued++;
+	VITA2D_STAT_ADD(ctx, programBinds, 1);
+}
+
+void _vita2d_set_fragment_texture(const SceGxmTexture *texture)
+{
+	vita2d_draw_ctx *ctx = _vita2d_ctx();
+	vita2d_state *state = &ctx->state;
+	vita2d_state_stats *stats = &ctx->stateStats;
+
+	// Compare control words, filters may change without the pointer changing
+	if (state->textureValid && !sceClibMemcmp(&state->texture, texture, sizeof(SceGxmTexture))) {
+		stats->elided++;
+		return;
+	}
+
+	sceGxmSetFragmentTexture(ctx->context, 0, texture);
+	state->texture = *texture;
+	state->textureValid = 1;
+	stats->issued++;
+	VITA2D_STAT_ADD(ctx, textureBinds, 1);
+}
+
+void _vita2d_set_front_polygon_mode(SceGxmPolygonMode mode)
+{
+	vita2d_draw_ctx *ctx = _vita2d_ctx();
+	vita2d_state *state = &ctx->state;
+	vita2d_state_stats *stats = &ctx->stateStats;
+
+	if (state->frontPolygonModeValid && state->frontPolygonMode == mode) {
+		stats->elided++;
+		return;
+	}
+
+	sceGxmSetFrontPolygonMode(ctx->context, mode);
+	state->frontPolygonMode = mode;
+	state->frontPolygonModeValid = 1;
+	stats->issued++;
+}
+
+void _vita2d_set_back_polygon_mode(SceGxmPolygonMode mode)
+{
+	vita2d_draw_ctx *ctx = _vita2d_ctx();
+	vita2d_state *state = &ctx->state;
+	vita2d_state_stats *stats = &ctx->stateStats;
+
+	if (state->backPolygonModeValid && state->backPolygonMode == mode) {
+		stats->elided++;
+		return;
+	}
+
+	sceGxmSetBackPolygonMode(ctx->context, mode);
+	state->backPolygonMode = mode;
+	state->backPolygonModeValid = 1;
+	stats->issued++;
+}
+
+void _vita2d_set_front_stencil_func(SceGxmStencilFunc func, SceGxmStencilOp stencilFail, SceGxmStencilOp depthFail,
+	SceGxmStencilOp depthPass, unsigned char compareMask, unsigned char writeMask)
+{
+	vita2d_draw_ctx *ctx = _vita2d_ctx();
+	vita2d_state *state = &ctx->state;
+	vita2d_state_stats *stats = &ctx->stateStats;
+	vita2d_stencil_state stencil;
+
+	sceClibMemset(&stencil, 0, sizeof(stencil));
+	stencil.func = func;
+	stencil.stencilFail = stencilFail;
+	stencil.depthFail = depthFail;
+	stencil.depthPass = depthPass;
+	stencil.compareMask = compareMask;
+	stencil.writeMask = writeMask;
+
+	if (state->frontStencilValid && !sceClibMemcmp(&state->frontStencil, &stencil, sizeof(stencil))) {
+		stats->elided++;
+		return;
+	}
+
+	sceGxmSetFrontStencilFunc(ctx->context, func, stencilFail, depthFail, depthPass, compareMask, writeMask);
+	state->frontStencil = stencil;
+	state->frontStencilValid = 1;
+	stats->issued++;
+}
+
+void _vita2d_set_depth_func(SceGxmDepthFunc func, SceGxmDepthWriteMode write)
+{
+	vita2d_draw_ctx *ctx = _vita2d_ctx();
+	vita2d_state *state = &ctx->state;
+	vita2d_state_stats *stats = &ctx->stateStats;
+
+	if (state->depthValid && state->depthFunc == func && state->depthWrite == write) {
+		stats->elided++;
+		return;
+	}
+
+	// Library draws are never culled, both faces get the same depth state
+	sceGxmSetFrontDepthFunc(ctx->context, func);
+	sceGxmSetBackDepthFunc(ctx->context, func);
+	sceGxmSetFrontDepthWriteEnable(ctx->context, write);
+	sceGxmSetBackDepthWriteEnable(ctx->context, write);
+	state->depthFunc = func;
+	state->depthWrite = write;
+	state->depthValid = 1;
+	stats->issued++;
+}
+
+void _vita2d_set_wvp(const SceGxmProgramParameter *param, const float *matrix)
+{
+	vita2d_draw_ctx *ctx = _vita2d_ctx();
+	vita2d_state *state = &ctx->state;
+	vita2d_state_stats *stats = &ctx->stateStats;
+
+	/*
+	 * The last reserved default uniform buffer stays bound for following draws,
+	 * so the upload can be skipped while the vertex program and matrix are unchanged.
+	 */
+	if (state->wvpProgram == state->vertexProgram && state->wvpProgram != NULL
+		&& !sceClibMemcmp(state->wvp, matrix, sizeof(state->wvp))) {
+		stats->elided++;
+		return;
+	}
+
+	_vita2d_reserve_vertex_uniforms(param, matrix);
+}
+
+void *_vita2d_reserve_vertex_uniforms(const SceGxmProgramParameter *wvpParam, const float *matrix)
+{
+	vita2d_draw_ctx *ctx = _vita2d_ctx();
+	vita2d_state *state = &ctx->state;
+	void *vertexDefaultBuffer;
+
+	// Always reserves a new default uniform buffer, callers may write more uniforms into it
+	sceGxmReserveVertexDefaultUniformBuffer(ctx->context, &vertexDefaultBuffer);
+	sceGxmSetUniformDataF(vertexDefaultBuffer, wvpParam, 0, 16, matrix);
+
+	sceClibMemcpy(state->wvp, matrix, sizeof(state->wvp));
+	state->wvpProgram = state->vertexProgram;
+	ctx->stateStats.issued++;
+
+	return vertexDefaultBuffer;
+}
+
+void vita2d_get_state_stats(vita2d_state_stats *out)
+{
+	if (out)
+		*out = _vita2d_ctx()->stateStats;
+}
@@ -12,6 +12,7 @@
 
 #define GXM_TEX_MAX_SIZE 4096
 static SceGxmDeviceHeapId heapType = SCE_GXM_DEVICE_HEAP_ID_CDRAM;
+static int premultipliedAlpha = 0;
 
 extern void* vita2d_heap_internal;
 
@@ -53,6 +54,16 @@ SceGxmDeviceHeapId vita2d_texture_get_heap_type()
 	return heapType;
 }
 
+void vita2d_texture_set_premultiplied_alpha(int enable)
+{
+	premultipliedAlpha = enable;
+}
+
+int vita2d_texture_get_premultiplied_alpha()
+{
+	return premultipliedAlpha;
+}
+
 vita2d_texture *vita2d_create_empty_texture(unsigned int w, unsigned int h)
 {
 	return vita2d_create_empty_texture_format(w, h, SCE_GXM_TEXTURE_FORMAT_A8B8G8R8);
@@ -223,6 +234,7 @@ vita2d_texture * vita2d_create_empty_texture_rendertarget(unsigned int w, unsign
 void vita2d_free_texture(vita2d_texture *texture)
 {
 	if (texture) {
+		_vita2d_batch_flush_texture(&texture->gxm_tex);
 		if (texture->gxm_rtgt) {
 			sceGxmDestroyRenderTarget(texture->gxm_rtgt);
 		}
@@ -276,99 +288,157 @@ SceGxmTextureFilter vita2d_texture_get_mag_filter(const vita2d_texture *texture)
 
 void vita2d_texture_set_filters(vita2d_texture *texture, SceGxmTextureFilter min_filter, SceGxmTextureFilter mag_filter)
 {
+	// Texture state is latched at flush time
+	_vita2d_batch_flush_texture(&texture->gxm_tex);
 	sceGxmTextureSetMinFilter(&texture->gxm_tex, min_filter);
 	sceGxmTextureSetMagFilter(&texture->gxm_tex, mag_filter);
 }
 
-static inline void set_texture_program()
+#define SPRITE_MAX_INSTANCES 0xFFFF
+
+/* Untinted draws use the tint path with white, so tinted and untinted quads batch together */
+#define NO_TINT RGBA8(0xFF, 0xFF, 0xFF, 0xFF)
+
+/* Quad texcoords are U16 normalized, 0xFFFF is 1.0 */
+#define TEXCOORD_ONE 0xFFFF
+
+static inline unsigned short texcoord_u16n(float coord)
 {
-	sceGxmSetVertexProgram(_vita2d_context, _vita2d_textureVertexProgram);
-	sceGxmSetFragmentProgram(_vita2d_context, _vita2d_textureFragmentProgram);
+	return (unsigned short)(coord * (float)TEXCOORD_ONE + 0.5f);
 }
 
-static inline void set_texture_tint_program()
+/* U16 normalized texcoords only cover the texture once, tiled and wrapped parts keep F32 texcoords */
+static inline int texcoords_normalized(float u0, float v0, float u1, float v1)
 {
-	sceGxmSetVertexProgram(_vita2d_context, _vita2d_textureVertexProgram);
-	sceGxmSetFragmentProgram(_vita2d_context, _vita2d_textureTintFragmentProgram);
+	return u0 >= 0.0f && u0 <= 1.0f && v0 >= 0.0f && v0 <= 1.0f
+		&& u1 >= 0.0f && u1 <= 1.0f && v1 >= 0.0f && v1 <= 1.0f;
 }
 
-static inline void set_texture_wvp_uniform()
+/*
+ * Batches a quad with corners x[i], y[i] in strip order, corner i samples
+ * (i & 1 ? u1 : u0, i & 2 ? v1 : v0).
+ */
+static inline void write_texture_quad(const vita2d_texture *texture, const float *x, const float *y,
+	float u0, float v0, float u1, float v1, unsigned int color)
 {
-	void *vertex_wvp_buffer;
-	sceGxmReserveVertexDefaultUniformBuffer(_vita2d_context, &vertex_wvp_buffer);
-	sceGxmSetUniformDataF(vertex_wvp_buffer, _vita2d_textureWvpParam, 0, 16, _vita2d_ortho_matrix);
+	int i;
+
+	if (texcoords_normalized(u0, v0, u1, v1)) {
+		const unsigned short tu[2] = { texcoord_u16n(u0), texcoord_u16n(u1) };
+		const unsigned short tv[2] = { texcoord_u16n(v0), texcoord_u16n(v1) };
+
+		vita2d_texture_tint_vertex *vertices = (vita2d_texture_tint_vertex *)_vita2d_batch_alloc_quads(
+			_vita2d_textureTintVertexProgram,
+			_vita2d_ctx()->programs->textureTint,
+			_vita2d_textureTintWvpParam,
+			&texture->gxm_tex,
+			sizeof(vita2d_texture_tint_vertex),
+			1);
+		if (!vertices)
+			return;
+
+		for (i = 0; i < 4; i++) {
+			vertices[i].x = x[i];
+			vertices[i].y = y[i];
+			vertices[i].u = tu[i & 1];
+			vertices[i].v = tv[i >> 1];
+			vertices[i].color = color;
+		}
+	}
+	else {
+		const float tu[2] = { u0, u1 };
+		const float tv[2] = { v0, v1 };
+
+		vita2d_texture_tint_wide_vertex *vertices = (vita2d_texture_tint_wide_vertex *)_vita2d_batch_alloc_quads(
+			_vita2d_textureTintWideVertexProgram,
+			_vita2d_ctx()->programs->textureTint,
+			_vita2d_textureTintWvpParam,
+			&texture->gxm_tex,
+			sizeof(vita2d_texture_tint_wide_vertex),
+			1);
+		if (!vertices)
+			return;
+
+		for (i = 0; i < 4; i++) {
+			vertices[i].x = x[i];
+			vertices[i].y = y[i];
+			vertices[i].u = tu[i & 1];
+			vertices[i].v = tv[i >> 1];
+			vertices[i].color = color;
+		}
+	}
 }
 
-static inline void set_texture_tint_color_uniform(unsigned int color)
+/* Axis-aligned quad from (x0, y0) to (x1, y1), clipped on the CPU when clipping is enabled */
+static inline void draw_texture_quad(const vita2d_texture *texture, float x0, float y0, float x1, float y1,
+	float u0, float v0, float u1, float v1, unsigned int color)
 {
-	void *texture_tint_color_buffer;
-	sceGxmReserveFragmentDefaultUniformBuffer(_vita2d_context, &texture_tint_color_buffer);
+	if (_vita2d_visibility(x0, y0, x1, y1) == VITA2D_CLIP_OUTSIDE)
+		return;
 
-	float *tint_color = vita2d_pool_memalign(
-		4 * sizeof(float), // RGBA
-		sizeof(float));
+	if (!_vita2d_clip_quad(&x0, &y0, &x1, &y1, &u0, &v0, &u1, &v1))
+		return;
 
-	tint_color[0] = ((color >> 8*0) & 0xFF)/255.0f;
-	tint_color[1] = ((color >> 8*1) & 0xFF)/255.0f;
-	tint_color[2] = ((color >> 8*2) & 0xFF)/255.0f;
-	tint_color[3] = ((color >> 8*3) & 0xFF)/255.0f;
+	const float x[4] = { x0, x1, x0, x1 };
+	const float y[4] = { y0, y0, y1, y1 };
 
-	sceGxmSetUniformDataF(texture_tint_color_buffer, _vita2d_textureTintColorParam, 0, 4, tint_color);
+	write_texture_quad(texture, x, y, u0, v0, u1, v1, color);
 }
 
-static inline void draw_texture_generic(const vita2d_texture *texture, float x, float y)
+/*
+ * Quad from (x0, y0) to (x1, y1) relative to its hotspot, rotated by rad and moved to (x, y).
+ * Culled by its rotated bounds, the stencil mask is only needed when it crosses the clip edges.
+ */
+static inline void draw_texture_quad_rotate(const vita2d_texture *texture, float x, float y, float x0, float y0, float x1, float y1,
+	float rad, float u0, float v0, float u1, float v1, unsigned int color)
 {
-	vita2d_texture_vertex *vertices = (vita2d_texture_vertex *)vita2d_pool_memalign(
-		4 * sizeof(vita2d_texture_vertex), // 4 vertices
-		sizeof(vita2d_texture_vertex));
+	const float c = sceFpuCosf(rad);
+	const float s = sceFpuSinf(rad);
+	const float px[4] = { x0, x1, x0, x1 };
+	const float py[4] = { y0, y0, y1, y1 };
+	float rx[4], ry[4];
+	float x_min, y_min, x_max, y_max;
+	int i;
 
-	const float w = vita2d_texture_get_width(texture);
-	const float h = vita2d_texture_get_height(texture);
+	for (i = 0; i < 4; ++i) { // Rotate and translate
+		rx[i] = px[i]*c - py[i]*s + x;
+		ry[i] = px[i]*s + py[i]*c + y;
+	}
+
+	x_min = x_max = rx[0];
+	y_min = y_max = ry[0];
+	for (i = 1; i < 4; ++i) {
+		if (rx[i] < x_min) x_min = rx[i];
+		if (rx[i] > x_max) x_max = rx[i];
+		if (ry[i] < y_min) y_min = ry[i];
+		if (ry[i] > y_max) y_max = ry[i];
+	}
 
-	vertices[0].x = x;
-	vertices[0].y = y;
-	vertices[0].z = +0.5f;
-	vertices[0].u = 0.0f;
-	vertices[0].v = 0.0f;
-
-	vertices[1].x = x + w;
-	vertices[1].y = y;
-	vertices[1].z = +0.5f;
-	vertices[1].u = 1.0f;
-	vertices[1].v = 0.0f;
-
-	vertices[2].x = x;
-	vertices[2].y = y + h;
-	vertices[2].z = +0.5f;
-	vertices[2].u = 0.0f;
-	vertices[2].v = 1.0f;
-
-	vertices[3].x = x + w;
-	vertices[3].y = y + h;
-	vertices[3].z = +0.5f;
-	vertices[3].u = 1.0f;
-	vertices[3].v = 1.0f;
+	int visibility = _vita2d_visibility(x_min, y_min, x_max, y_max);
+	if (visibility == VITA2D_CLIP_OUTSIDE)
+		return;
+	if (visibility == VITA2D_CLIP_PARTIAL)
+		_vita2d_clip_require_stencil();
 
-	// Set the texture to the TEXUNIT0
-	sceGxmSetFragmentTexture(_vita2d_context, 0, &texture->gxm_tex);
+	write_texture_quad(texture, rx, ry, u0, v0, u1, v1, color);
+}
 
-	sceGxmSetVertexStream(_vita2d_context, 0, vertices);
-	sceGxmDraw(_vita2d_context, SCE_GXM_PRIMITIVE_TRIANGLE_STRIP, SCE_GXM_INDEX_FORMAT_U16, vita2d_get_linear_indices(), 4);
+static inline void draw_texture_generic(const vita2d_texture *texture, float x, float y, unsigned int color)
+{
+	const float w = vita2d_texture_get_width(texture);
+	const float h = vita2d_texture_get_height(texture);
+
+	draw_texture_quad(texture, x, y, x + w, y + h, 0.0f, 0.0f, 1.0f, 1.0f, color);
 }
 
 void vita2d_draw_texture(const vita2d_texture *texture, float x, float y)
 {
-	set_texture_program();
-	set_texture_wvp_uniform();
-	draw_texture_generic(texture, x, y);
+	draw_texture_generic(texture, x, y, NO_TINT);
 }
 
 void vita2d_draw_texture_tint(const vita2d_texture *texture, float x, float y, unsigned int color)
 {
-	set_texture_tint_program();
-	set_texture_wvp_uniform();
-	set_texture_tint_color_uniform(color);
-	draw_texture_generic(texture, x, y);
+	draw_texture_generic(texture, x, y, color);
 }
 
 void vita2d_draw_texture_rotate(const vita2d_texture *texture, float x, float y, float rad)
@@ -386,308 +456,97 @@ void vita2d_draw_texture_tint_rotate(const vita2d_texture *texture, float x, flo
 		color);
 }
 
-static inline void draw_texture_rotate_hotspot_generic(const vita2d_texture *texture, float x, float y, float rad, float center_x, float center_y)
+static inline void draw_texture_rotate_hotspot_generic(const vita2d_texture *texture, float x, float y, float rad, float center_x, float center_y, unsigned int color)
 {
-	vita2d_texture_vertex *vertices = (vita2d_texture_vertex *)vita2d_pool_memalign(
-		4 * sizeof(vita2d_texture_vertex), // 4 vertices
-		sizeof(vita2d_texture_vertex));
-
 	const float w = vita2d_texture_get_width(texture);
 	const float h = vita2d_texture_get_height(texture);
 
-	vertices[0].x = -center_x;
-	vertices[0].y = -center_y;
-	vertices[0].z = +0.5f;
-	vertices[0].u = 0.0f;
-	vertices[0].v = 0.0f;
-
-	vertices[1].x = w - center_x;
-	vertices[1].y = -center_y;
-	vertices[1].z = +0.5f;
-	vertices[1].u = 1.0f;
-	vertices[1].v = 0.0f;
-
-	vertices[2].x = -center_x;
-	vertices[2].y = h - center_y;
-	vertices[2].z = +0.5f;
-	vertices[2].u = 0.0f;
-	vertices[2].v = 1.0f;
-
-	vertices[3].x = w - center_x;
-	vertices[3].y = h - center_y;
-	vertices[3].z = +0.5f;
-	vertices[3].u = 1.0f;
-	vertices[3].v = 1.0f;
-
-	float c = sceFpuCosf(rad);
-	float s = sceFpuSinf(rad);
-	int i;
-	for (i = 0; i < 4; ++i) { // Rotate and translate
-		float _x = vertices[i].x;
-		float _y = vertices[i].y;
-		vertices[i].x = _x*c - _y*s + x;
-		vertices[i].y = _x*s + _y*c + y;
-	}
-
-	// Set the texture to the TEXUNIT0
-	sceGxmSetFragmentTexture(_vita2d_context, 0, &texture->gxm_tex);
-
-	sceGxmSetVertexStream(_vita2d_context, 0, vertices);
-	sceGxmDraw(_vita2d_context, SCE_GXM_PRIMITIVE_TRIANGLE_STRIP, SCE_GXM_INDEX_FORMAT_U16, vita2d_get_linear_indices(), 4);
+	draw_texture_quad_rotate(texture, x, y, -center_x, -center_y, w - center_x, h - center_y,
+		rad, 0.0f, 0.0f, 1.0f, 1.0f, color);
 }
 
 void vita2d_draw_texture_rotate_hotspot(const vita2d_texture *texture, float x, float y, float rad, float center_x, float center_y)
 {
-	set_texture_program();
-	set_texture_wvp_uniform();
-	draw_texture_rotate_hotspot_generic(texture, x, y, rad, center_x, center_y);
+	draw_texture_rotate_hotspot_generic(texture, x, y, rad, center_x, center_y, NO_TINT);
 }
 
 void vita2d_draw_texture_tint_rotate_hotspot(const vita2d_texture *texture, float x, float y, float rad, float center_x, float center_y, unsigned int color)
 {
-	set_texture_tint_program();
-	set_texture_wvp_uniform();
-	set_texture_tint_color_uniform(color);
-	draw_texture_rotate_hotspot_generic(texture, x, y, rad, center_x, center_y);
+	draw_texture_rotate_hotspot_generic(texture, x, y, rad, center_x, center_y, color);
 }
 
-static inline void draw_texture_scale_generic(const vita2d_texture *texture, float x, float y, float x_scale, float y_scale)
+static inline void draw_texture_scale_generic(const vita2d_texture *texture, float x, float y, float x_scale, float y_scale, unsigned int color)
 {
-	vita2d_texture_vertex *vertices = (vita2d_texture_vertex *)vita2d_pool_memalign(
-		4 * sizeof(vita2d_texture_vertex), // 4 vertices
-		sizeof(vita2d_texture_vertex));
-
 	const float w = x_scale * vita2d_texture_get_width(texture);
 	const float h = y_scale * vita2d_texture_get_height(texture);
 
-	vertices[0].x = x;
-	vertices[0].y = y;
-	vertices[0].z = +0.5f;
-	vertices[0].u = 0.0f;
-	vertices[0].v = 0.0f;
-
-	vertices[1].x = x + w;
-	vertices[1].y = y;
-	vertices[1].z = +0.5f;
-	vertices[1].u = 1.0f;
-	vertices[1].v = 0.0f;
-
-	vertices[2].x = x;
-	vertices[2].y = y + h;
-	vertices[2].z = +0.5f;
-	vertices[2].u = 0.0f;
-	vertices[2].v = 1.0f;
-
-	vertices[3].x = x + w;
-	vertices[3].y = y + h;
-	vertices[3].z = +0.5f;
-	vertices[3].u = 1.0f;
-	vertices[3].v = 1.0f;
-
-	// Set the texture to the TEXUNIT0
-	sceGxmSetFragmentTexture(_vita2d_context, 0, &texture->gxm_tex);
-
-	sceGxmSetVertexStream(_vita2d_context, 0, vertices);
-	sceGxmDraw(_vita2d_context, SCE_GXM_PRIMITIVE_TRIANGLE_STRIP, SCE_GXM_INDEX_FORMAT_U16, vita2d_get_linear_indices(), 4);
+	draw_texture_quad(texture, x, y, x + w, y + h, 0.0f, 0.0f, 1.0f, 1.0f, color);
 }
 
 void vita2d_draw_texture_scale(const vita2d_texture *texture, float x, float y, float x_scale, float y_scale)
 {
-	set_texture_program();
-	set_texture_wvp_uniform();
-	draw_texture_scale_generic(texture, x, y, x_scale, y_scale);
+	draw_texture_scale_generic(texture, x, y, x_scale, y_scale, NO_TINT);
 }
 
 void vita2d_draw_texture_tint_scale(const vita2d_texture *texture, float x, float y, float x_scale, float y_scale, unsigned int color)
 {
-	set_texture_tint_program();
-	set_texture_wvp_uniform();
-	set_texture_tint_color_uniform(color);
-	draw_texture_scale_generic(texture, x, y, x_scale, y_scale);
+	draw_texture_scale_generic(texture, x, y, x_scale, y_scale, color);
 }
 
 
-static inline void draw_texture_part_generic(const vita2d_texture *texture, float x, float y, float tex_x, float tex_y, float tex_w, float tex_h)
+static inline void draw_texture_part_generic(const vita2d_texture *texture, float x, float y, float tex_x, float tex_y, float tex_w, float tex_h, unsigned int color)
 {
-	vita2d_texture_vertex *vertices = (vita2d_texture_vertex *)vita2d_pool_memalign(
-		4 * sizeof(vita2d_texture_vertex), // 4 vertices
-		sizeof(vita2d_texture_vertex));
-
 	const float w = vita2d_texture_get_width(texture);
 	const float h = vita2d_texture_get_height(texture);
 
-	const float u0 = tex_x/w;
-	const float v0 = tex_y/h;
-	const float u1 = (tex_x+tex_w)/w;
-	const float v1 = (tex_y+tex_h)/h;
-
-	vertices[0].x = x;
-	vertices[0].y = y;
-	vertices[0].z = +0.5f;
-	vertices[0].u = u0;
-	vertices[0].v = v0;
-
-	vertices[1].x = x + tex_w;
-	vertices[1].y = y;
-	vertices[1].z = +0.5f;
-	vertices[1].u = u1;
-	vertices[1].v = v0;
-
-	vertices[2].x = x;
-	vertices[2].y = y + tex_h;
-	vertices[2].z = +0.5f;
-	vertices[2].u = u0;
-	vertices[2].v = v1;
-
-	vertices[3].x = x + tex_w;
-	vertices[3].y = y + tex_h;
-	vertices[3].z = +0.5f;
-	vertices[3].u = u1;
-	vertices[3].v = v1;
-
-	// Set the texture to the TEXUNIT0
-	sceGxmSetFragmentTexture(_vita2d_context, 0, &texture->gxm_tex);
-
-	sceGxmSetVertexStream(_vita2d_context, 0, vertices);
-	sceGxmDraw(_vita2d_context, SCE_GXM_PRIMITIVE_TRIANGLE_STRIP, SCE_GXM_INDEX_FORMAT_U16, vita2d_get_linear_indices(), 4);
+	draw_texture_quad(texture, x, y, x + tex_w, y + tex_h,
+		tex_x/w, tex_y/h, (tex_x+tex_w)/w, (tex_y+tex_h)/h, color);
 }
 
 void vita2d_draw_texture_part(const vita2d_texture *texture, float x, float y, float tex_x, float tex_y, float tex_w, float tex_h)
 {
-	set_texture_program();
-	set_texture_wvp_uniform();
-	draw_texture_part_generic(texture, x, y, tex_x, tex_y, tex_w, tex_h);
+	draw_texture_part_generic(texture, x, y, tex_x, tex_y, tex_w, tex_h, NO_TINT);
 }
 
 void vita2d_draw_texture_tint_part(const vita2d_texture *texture, float x, float y, float tex_x, float tex_y, float tex_w, float tex_h, unsigned int color)
 {
-	set_texture_tint_program();
-	set_texture_wvp_uniform();
-	set_texture_tint_color_uniform(color);
-	draw_texture_part_generic(texture, x, y, tex_x, tex_y, tex_w, tex_h);
+	draw_texture_part_generic(texture, x, y, tex_x, tex_y, tex_w, tex_h, color);
 }
 
-static inline void draw_texture_part_scale_generic(const vita2d_texture *texture, float x, float y, float tex_x, float tex_y, float tex_w, float tex_h, float x_scale, float y_scale)
+static inline void draw_texture_part_scale_generic(const vita2d_texture *texture, float x, float y, float tex_x, float tex_y, float tex_w, float tex_h, float x_scale, float y_scale, unsigned int color)
 {
-	vita2d_texture_vertex *vertices = (vita2d_texture_vertex *)vita2d_pool_memalign(
-		4 * sizeof(vita2d_texture_vertex), // 4 vertices
-		sizeof(vita2d_texture_vertex));
-
 	const float w = vita2d_texture_get_width(texture);
 	const float h = vita2d_texture_get_height(texture);
 
-	const float u0 = tex_x/w;
-	const float v0 = tex_y/h;
-	const float u1 = (tex_x+tex_w)/w;
-	const float v1 = (tex_y+tex_h)/h;
-
-	tex_w *= x_scale;
-	tex_h *= y_scale;
-
-	vertices[0].x = x;
-	vertices[0].y = y;
-	vertices[0].z = +0.5f;
-	vertices[0].u = u0;
-	vertices[0].v = v0;
-
-	vertices[1].x = x + tex_w;
-	vertices[1].y = y;
-	vertices[1].z = +0.5f;
-	vertices[1].u = u1;
-	vertices[1].v = v0;
-
-	vertices[2].x = x;
-	vertices[2].y = y + tex_h;
-	vertices[2].z = +0.5f;
-	vertices[2].u = u0;
-	vertices[2].v = v1;
-
-	vertices[3].x = x + tex_w;
-	vertices[3].y = y + tex_h;
-	vertices[3].z = +0.5f;
-	vertices[3].u = u1;
-	vertices[3].v = v1;
-
-	// Set the texture to the TEXUNIT0
-	sceGxmSetFragmentTexture(_vita2d_context, 0, &texture->gxm_tex);
-
-	sceGxmSetVertexStream(_vita2d_context, 0, vertices);
-	sceGxmDraw(_vita2d_context, SCE_GXM_PRIMITIVE_TRIANGLE_STRIP, SCE_GXM_INDEX_FORMAT_U16, vita2d_get_linear_indices(), 4);
+	draw_texture_quad(texture, x, y, x + tex_w * x_scale, y + tex_h * y_scale,
+		tex_x/w, tex_y/h, (tex_x+tex_w)/w, (tex_y+tex_h)/h, color);
 }
 
 void vita2d_draw_texture_part_scale(const vita2d_texture *texture, float x, float y, float tex_x, float tex_y, float tex_w, float tex_h, float x_scale, float y_scale)
 {
-	set_texture_program();
-	set_texture_wvp_uniform();
-	draw_texture_part_scale_generic(texture, x, y, tex_x, tex_y, tex_w, tex_h, x_scale, y_scale);
+	draw_texture_part_scale_generic(texture, x, y, tex_x, tex_y, tex_w, tex_h, x_scale, y_scale, NO_TINT);
 }
 
 void vita2d_draw_texture_tint_part_scale(const vita2d_texture *texture, float x, float y, float tex_x, float tex_y, float tex_w, float tex_h, float x_scale, float y_scale, unsigned int color)
 {
-	set_texture_tint_program();
-	set_texture_wvp_uniform();
-	set_texture_tint_color_uniform(color);
-	draw_texture_part_scale_generic(texture, x, y, tex_x, tex_y, tex_w, tex_h, x_scale, y_scale);
+	draw_texture_part_scale_generic(texture, x, y, tex_x, tex_y, tex_w, tex_h, x_scale, y_scale, color);
 }
 
-static inline void draw_texture_scale_rotate_hotspot_generic(const vita2d_texture *texture, float x, float y, float x_scale, float y_scale, float rad, float center_x, float center_y)
+static inline void draw_texture_scale_rotate_hotspot_generic(const vita2d_texture *texture, float x, float y, float x_scale, float y_scale, float rad, float center_x, float center_y, unsigned int color)
 {
-	vita2d_texture_vertex *vertices = (vita2d_texture_vertex *)vita2d_pool_memalign(
-		4 * sizeof(vita2d_texture_vertex), // 4 vertices
-		sizeof(vita2d_texture_vertex));
-
 	const float w = x_scale * vita2d_texture_get_width(texture);
 	const float h = y_scale * vita2d_texture_get_height(texture);
 	const float center_x_scaled = x_scale * center_x;
 	const float center_y_scaled = y_scale * center_y;
 
-	vertices[0].x = -center_x_scaled;
-	vertices[0].y = -center_y_scaled;
-	vertices[0].z = +0.5f;
-	vertices[0].u = 0.0f;
-	vertices[0].v = 0.0f;
-
-	vertices[1].x = -center_x_scaled + w;
-	vertices[1].y = -center_y_scaled;
-	vertices[1].z = +0.5f;
-	vertices[1].u = 1.0f;
-	vertices[1].v = 0.0f;
-
-	vertices[2].x = -center_x_scaled;
-	vertices[2].y = -center_y_scaled + h;
-	vertices[2].z = +0.5f;
-	vertices[2].u = 0.0f;
-	vertices[2].v = 1.0f;
-
-	vertices[3].x = -center_x_scaled + w;
-	vertices[3].y = -center_y_scaled + h;
-	vertices[3].z = +0.5f;
-	vertices[3].u = 1.0f;
-	vertices[3].v = 1.0f;
-
-	float c = sceFpuCosf(rad);
-	float s = sceFpuSinf(rad);
-	int i;
-	for (i = 0; i < 4; ++i) { // Rotate and translate
-		float _x = vertices[i].x;
-		float _y = vertices[i].y;
-		vertices[i].x = _x*c - _y*s + x;
-		vertices[i].y = _x*s + _y*c + y;
-	}
-
-	// Set the texture to the TEXUNIT0
-	sceGxmSetFragmentTexture(_vita2d_context, 0, &texture->gxm_tex);
-
-	sceGxmSetVertexStream(_vita2d_context, 0, vertices);
-	sceGxmDraw(_vita2d_context, SCE_GXM_PRIMITIVE_TRIANGLE_STRIP, SCE_GXM_INDEX_FORMAT_U16, vita2d_get_linear_indices(), 4);
+	draw_texture_quad_rotate(texture, x, y, -center_x_scaled, -center_y_scaled,
+		-center_x_scaled + w, -center_y_scaled + h, rad, 0.0f, 0.0f, 1.0f, 1.0f, color);
 }
 
 void vita2d_draw_texture_scale_rotate_hotspot(const vita2d_texture *texture, float x, float y, float x_scale, float y_scale, float rad, float center_x, float center_y)
 {
-	set_texture_program();
-	set_texture_wvp_uniform();
 	draw_texture_scale_rotate_hotspot_generic(texture, x, y, x_scale, y_scale,
-		rad, center_x, center_y);
+		rad, center_x, center_y, NO_TINT);
 }
 
 void vita2d_draw_texture_scale_rotate(const vita2d_texture *texture, float x, float y, float x_scale, float y_scale, float rad)
@@ -699,11 +558,8 @@ void vita2d_draw_texture_scale_rotate(const vita2d_texture *texture, float x, fl
 
 void vita2d_draw_texture_tint_scale_rotate_hotspot(const vita2d_texture *texture, float x, float y, float x_scale, float y_scale, float rad, float center_x, float center_y, unsigned int color)
 {
-	set_texture_tint_program();
-	set_texture_wvp_uniform();
-	set_texture_tint_color_uniform(color);
 	draw_texture_scale_rotate_hotspot_generic(texture, x, y, x_scale, y_scale,
-		rad, center_x, center_y);
+		rad, center_x, center_y, color);
 }
 
 void vita2d_draw_texture_tint_scale_rotate(const vita2d_texture *texture, float x, float y, float x_scale, float y_scale, float rad, unsigned int color)
@@ -714,94 +570,161 @@ void vita2d_draw_texture_tint_scale_rotate(const vita2d_texture *texture, float
 }
 
 static inline void draw_texture_part_scale_rotate_generic(const vita2d_texture *texture, float x, float y,
-	float tex_x, float tex_y, float tex_w, float tex_h, float x_scale, float y_scale, float rad)
+	float tex_x, float tex_y, float tex_w, float tex_h, float x_scale, float y_scale, float rad, unsigned int color)
 {
-	vita2d_texture_vertex *vertices = (vita2d_texture_vertex *)vita2d_pool_memalign(
-		4 * sizeof(vita2d_texture_vertex), // 4 vertices
-		sizeof(vita2d_texture_vertex));
-
 	const float w_full = vita2d_texture_get_width(texture);
 	const float h_full = vita2d_texture_get_height(texture);
 
 	const float w_half = (tex_w * x_scale) / 2.0f;
 	const float h_half = (tex_h * y_scale) / 2.0f;
 
-	const float u0 = tex_x / w_full;
-	const float v0 = tex_y / h_full;
-	const float u1 = (tex_x + tex_w) / w_full;
-	const float v1 = (tex_y + tex_h) / h_full;
-
-	vertices[0].x = -w_half;
-	vertices[0].y = -h_half;
-	vertices[0].z = +0.5f;
-	vertices[0].u = u0;
-	vertices[0].v = v0;
-
-	vertices[1].x = w_half;
-	vertices[1].y = -h_half;
-	vertices[1].z = +0.5f;
-	vertices[1].u = u1;
-	vertices[1].v = v0;
-
-	vertices[2].x = -w_half;
-	vertices[2].y = h_half;
-	vertices[2].z = +0.5f;
-	vertices[2].u = u0;
-	vertices[2].v = v1;
-
-	vertices[3].x = w_half;
-	vertices[3].y = h_half;
-	vertices[3].z = +0.5f;
-	vertices[3].u = u1;
-	vertices[3].v = v1;
-
-	const float c = sceFpuCosf(rad);
-	const float s = sceFpuSinf(rad);
-	int i;
-	for (i = 0; i < 4; ++i) { // Rotate and translate
-		float _x = vertices[i].x;
-		float _y = vertices[i].y;
-		vertices[i].x = _x*c - _y*s + x;
-		vertices[i].y = _x*s + _y*c + y;
-	}
-
-	// Set the texture to the TEXUNIT0
-	sceGxmSetFragmentTexture(_vita2d_context, 0, &texture->gxm_tex);
-
-	sceGxmSetVertexStream(_vita2d_context, 0, vertices);
-	sceGxmDraw(_vita2d_context, SCE_GXM_PRIMITIVE_TRIANGLE_STRIP, SCE_GXM_INDEX_FORMAT_U16, vita2d_get_linear_indices(), 4);
+	draw_texture_quad_rotate(texture, x, y, -w_half, -h_half, w_half, h_half, rad,
+		tex_x / w_full, tex_y / h_full, (tex_x + tex_w) / w_full, (tex_y + tex_h) / h_full, color);
 }
 
 void vita2d_draw_texture_part_scale_rotate(const vita2d_texture *texture, float x, float y,
 	float tex_x, float tex_y, float tex_w, float tex_h, float x_scale, float y_scale, float rad)
 {
-	set_texture_program();
-	set_texture_wvp_uniform();
 	draw_texture_part_scale_rotate_generic(texture, x, y,
-		tex_x, tex_y, tex_w, tex_h, x_scale, y_scale, rad);
+		tex_x, tex_y, tex_w, tex_h, x_scale, y_scale, rad, NO_TINT);
 }
 
 void vita2d_draw_texture_part_tint_scale_rotate(const vita2d_texture *texture, float x, float y,
 	float tex_x, float tex_y, float tex_w, float tex_h, float x_scale, float y_scale, float rad, unsigned int color)
 {
-	set_texture_tint_program();
-	set_texture_wvp_uniform();
-	set_texture_tint_color_uniform(color);
 	draw_texture_part_scale_rotate_generic(texture, x, y,
-		tex_x, tex_y, tex_w, tex_h, x_scale, y_scale, rad);
+		tex_x, tex_y, tex_w, tex_h, x_scale, y_scale, rad, color);
 }
 
 void vita2d_draw_array_textured(const vita2d_texture *texture, SceGxmPrimitiveType mode, const vita2d_texture_vertex *vertices, size_t count, unsigned int color)
 {
-	set_texture_tint_program();
-	set_texture_wvp_uniform();
-	set_texture_tint_color_uniform(color);
+	_vita2d_clip_require_stencil();
+	_vita2d_batch_flush();
+
+	// Single tint color for the whole array, fetched by instance index
+	unsigned int *tint_color = (unsigned int *)vita2d_pool_memalign(
+		sizeof(unsigned int),
+		sizeof(unsigned int));
+
+	if (!tint_color)
+		return;
+
+	*tint_color = color;
 
-	sceGxmSetBackPolygonMode(_vita2d_context, SCE_GXM_POLYGON_MODE_TRIANGLE_FILL);
+	const vita2d_draw_ctx *ctx = _vita2d_ctx();
+
+	_vita2d_set_vertex_program(_vita2d_textureTintArrayVertexProgram);
+	_vita2d_set_fragment_program(ctx->programs->textureTint);
+	_vita2d_set_wvp(_vita2d_textureTintWvpParam, ctx->ortho);
+
+	_vita2d_set_front_polygon_mode(SCE_GXM_POLYGON_MODE_TRIANGLE_FILL);
+	_vita2d_set_back_polygon_mode(SCE_GXM_POLYGON_MODE_TRIANGLE_FILL);
 
 	// Set the texture to the TEXUNIT0
-	sceGxmSetFragmentTexture(_vita2d_context, 0, &texture->gxm_tex);
+	_vita2d_set_fragment_texture(&texture->gxm_tex);
+
+	_vita2d_set_vertex_stream(0, vertices);
+	_vita2d_set_vertex_stream(1, tint_color);
+	_vita2d_draw(mode, vita2d_get_linear_indices(), count, count);
+}
+
+static int sprite_visibility(const vita2d_sprite_instance *sprite)
+{
+	// Extent of the sprite around its hotspot, before rotation
+	float x0 = -sprite->center_x * sprite->x_scale;
+	float x1 = (sprite->tex_w - sprite->center_x) * sprite->x_scale;
+	float y0 = -sprite->center_y * sprite->y_scale;
+	float y1 = (sprite->tex_h - sprite->center_y) * sprite->y_scale;
+	float t;
+
+	if (x1 < x0) {
+		t = x0;
+		x0 = x1;
+		x1 = t;
+	}
+	if (y1 < y0) {
+		t = y0;
+		y0 = y1;
+		y1 = t;
+	}
 
-	sceGxmSetVertexStream(_vita2d_context, 0, vertices);
-	sceGxmDraw(_vita2d_context, mode, SCE_GXM_INDEX_FORMAT_U16, vita2d_get_linear_indices(), count);
+	if (sprite->rad != 0.0f) {
+		// Any rotation stays within dx + dy of the hotspot, no need for the exact corner distance
+		float dx = -x0 > x1 ? -x0 : x1;
+		float dy = -y0 > y1 ? -y0 : y1;
+		float r = dx + dy;
+		return _vita2d_visibility(sprite->x - r, sprite->y - r, sprite->x + r, sprite->y + r);
+	}
+
+	return _vita2d_visibility(sprite->x + x0, sprite->y + y0, sprite->x + x1, sprite->y + y1);
+}
+
+void vita2d_draw_sprites(const vita2d_texture *texture, const vita2d_sprite_instance *sprites, unsigned int count)
+{
+	if (count == 0)
+		return;
+
+	_vita2d_batch_flush();
+
+	vita2d_sprite_instance *instances = (vita2d_sprite_instance *)vita2d_pool_memalign(
+		count * sizeof(vita2d_sprite_instance),
+		sizeof(float));
+
+	if (!instances)
+		return;
+
+	if (vita2d_get_clipping_enabled() || vita2d_get_culling_enabled()) {
+		// Only sprites crossing the clip edges need the stencil mask, invisible ones are skipped
+		unsigned int i, visible = 0;
+		int partial = 0;
+
+		for (i = 0; i < count; i++) {
+			int result = sprite_visibility(&sprites[i]);
+			if (result == VITA2D_CLIP_OUTSIDE)
+				continue;
+			if (result == VITA2D_CLIP_PARTIAL)
+				partial = 1;
+			instances[visible++] = sprites[i];
+		}
+
+		if (visible == 0)
+			return;
+		if (partial)
+			_vita2d_clip_require_stencil();
+
+		count = visible;
+	}
+	else {
+		sceClibMemcpy(instances, sprites, count * sizeof(vita2d_sprite_instance));
+	}
+
+	const vita2d_draw_ctx *ctx = _vita2d_ctx();
+
+	_vita2d_set_vertex_program(_vita2d_spriteVertexProgram);
+	_vita2d_set_fragment_program(ctx->programs->sprite);
+
+	float inv_tex_size[2];
+	inv_tex_size[0] = 1.0f / vita2d_texture_get_width(texture);
+	inv_tex_size[1] = 1.0f / vita2d_texture_get_height(texture);
+
+	void *vertexDefaultBuffer = _vita2d_reserve_vertex_uniforms(_vita2d_spriteWvpParam, ctx->ortho);
+	sceGxmSetUniformDataF(vertexDefaultBuffer, _vita2d_spriteInvTexSizeParam, 0, 2, inv_tex_size);
+
+	_vita2d_set_front_polygon_mode(SCE_GXM_POLYGON_MODE_TRIANGLE_FILL);
+
+	// Set the texture to the TEXUNIT0
+	_vita2d_set_fragment_texture(&texture->gxm_tex);
+
+	_vita2d_set_vertex_stream(0, _vita2d_spriteQuadVertices);
+
+	// Instance index is 16 bit, split huge arrays
+	while (count) {
+		unsigned int n = count > SPRITE_MAX_INSTANCES ? SPRITE_MAX_INSTANCES : count;
+
+		_vita2d_set_vertex_stream(1, instances);
+		_vita2d_draw_instanced(_vita2d_spriteQuadIndices, n * 6, 6, n * 4);
+
+		instances += n;
+		count -= n;
+	}
 }
@@ -0,0 +1,72 @@
+/*
+ * vita2d_draw_polyline() with 10000 points: CPU time per call, pool bytes,
+ * vertices and draws. Times are for the host build, where NEON is emulated
+ * lane by lane, compare them between builds rather than with the device.
+ */
+
+#include <math.h>
+#include <time.h>
+#include "stub/gxm_record.h"
+#include "stub/vita2d_host.h"
+#include "check.h"
+
+#define POINTS		10000
+#define RUNS		20
+
+static float points[POINTS * 2];
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void bench(const char *name, float thickness, vita2d_line_join join)
+{
+	vita2d_pool_stats stats;
+	double start, best = 1e30;
+	unsigned int run;
+
+	for (run = 0; run < RUNS; run++) {
+		vita2d_host_begin_scene();
+		start = now_us();
+		vita2d_draw_polyline(points, POINTS, thickness, join, 0x80FFFFFF);
+		if (now_us() - start < best)
+			best = now_us() - start;
+		vita2d_host_end_scene();
+	}
+
+	vita2d_get_pool_stats(&stats);
+
+	printf("%-14s %8.0f us %9u pool bytes %7u vertices %3u draws\n", name, best, stats.used,
+		_vita2d_default_ctx.counters.vertices, gxm_record_count(GXM_CALL_DRAW));
+
+	CHECK(stats.used > 0);
+	CHECK(gxm_record_count(GXM_CALL_DRAW) >= 1);
+}
+
+int main(void)
+{
+	unsigned int i;
+
+	if (vita2d_host_init(16 * 1024 * 1024) != 0) {
+		fprintf(stderr, "vita2d_host_init() failed\n");
+		return 1;
+	}
+
+	// A noisy wave across the screen, turns of every size in both directions
+	for (i = 0; i < POINTS; i++) {
+		points[i * 2 + 0] = 960.0f * i / POINTS;
+		points[i * 2 + 1] = 272.0f + 200.0f * sinf(i * 0.05f) + 20.0f * sinf(i * 1.7f);
+	}
+
+	printf("%u points, best of %u runs\n", POINTS, RUNS);
+	bench("miter, 4 px", 4.0f, VITA2D_LINE_JOIN_MITER);
+	bench("miter, 16 px", 16.0f, VITA2D_LINE_JOIN_MITER);
+	bench("round, 4 px", 4.0f, VITA2D_LINE_JOIN_ROUND);
+	bench("round, 16 px", 16.0f, VITA2D_LINE_JOIN_ROUND);
+
+	return CHECK_RESULT();
+}
@@ -0,0 +1,66 @@
+/*
+ * Pool bytes per frame for a frame of built-in primitives, with the compact
+ * vertex formats and with the F32 formats the batcher wrote before them
+ * (vita2d_color_vertex for colored primitives, x, y, u, v, color for
+ * texture quads).
+ */
+
+#include "stub/vita2d_host.h"
+#include "check.h"
+
+#define RECTS	2000
+#define LINES	200
+#define QUADS	2000
+#define TILED	100
+
+static unsigned int frame_pool_bytes(vita2d_texture *tex)
+{
+	vita2d_pool_stats stats;
+	int i;
+
+	vita2d_host_begin_scene();
+	for (i = 0; i < RECTS; i++)
+		vita2d_draw_rectangle((float)(i % 900), (float)(i % 500), 8.0f, 8.0f, 0xFF00FF00);
+	for (i = 0; i < LINES; i++)
+		vita2d_draw_line(0.0f, (float)i, 960.0f, (float)i, 0xFFFFFFFF);
+	for (i = 0; i < QUADS; i++)
+		vita2d_draw_texture(tex, (float)(i % 900), (float)(i % 500));
+	for (i = 0; i < TILED; i++)
+		vita2d_draw_texture_part(tex, 0.0f, 0.0f, 0.0f, 0.0f, 256.0f, 64.0f);
+	vita2d_host_end_scene();
+
+	vita2d_get_pool_stats(&stats);
+
+	return stats.used;
+}
+
+int main(void)
+{
+	const unsigned int f32_color = sizeof(vita2d_color_vertex);
+	const unsigned int f32_texture = sizeof(vita2d_texture_tint_wide_vertex);
+	unsigned int before, after, expected;
+	vita2d_texture *tex;
+
+	if (vita2d_host_init(4 * 1024 * 1024) != 0) {
+		fprintf(stderr, "vita2d_host_init() failed\n");
+		return 1;
+	}
+
+	tex = vita2d_create_empty_texture(32, 32);
+	CHECK(tex != NULL);
+	if (!tex)
+		return 1;
+
+	after = frame_pool_bytes(tex);
+	before = RECTS * 4 * f32_color + LINES * 2 * f32_color + (QUADS + TILED) * 4 * f32_texture;
+	expected = RECTS * 4 * sizeof(vita2d_color_compact_vertex) + LINES * 2 * sizeof(vita2d_color_compact_vertex)
+		+ QUADS * 4 * sizeof(vita2d_texture_tint_vertex) + TILED * 4 * sizeof(vita2d_texture_tint_wide_vertex);
+
+	printf("%u rectangles, %u lines, %u texture quads, %u tiled texture quads\n", RECTS, LINES, QUADS, TILED);
+	printf("pool bytes per frame, F32 formats:     %8u\n", before);
+	printf("pool bytes per frame, compact formats: %8u (%.1f%%)\n", after, 100.0 * after / before);
+
+	CHECK_EQ(after, expected);
+
+	return CHECK_RESULT();
+}
@@ -0,0 +1,6 @@
+#ifndef STUB_APPMGR_H
+#define STUB_APPMGR_H
+
+#include "kernel.h"
+
+#endif
@@ -0,0 +1,340 @@
+#ifndef STUB_ARM_NEON_H
+#define STUB_ARM_NEON_H
+
+/*
+ * Lane-by-lane C versions of the NEON intrinsics the library uses, following
+ * the ARM definitions, so NEON paths build and run on the host. Estimates
+ * (vrsqrteq_f32, vrecpeq_f32) are exact here, callers refine them anyway.
+ */
+
+#include <stdint.h>
+#include <math.h>
+#include <string.h>
+
+typedef struct { uint8_t v[8]; } uint8x8_t;
+typedef struct { uint16_t v[8]; } uint16x8_t;
+typedef struct { uint32_t v[4]; } uint32x4_t;
+typedef struct { float v[2]; } float32x2_t;
+typedef struct { float v[4]; } float32x4_t;
+typedef struct { uint8x8_t val[4]; } uint8x8x4_t;
+typedef struct { float32x4_t val[2]; } float32x4x2_t;
+typedef struct { float32x4_t val[3]; } float32x4x3_t;
+
+static inline uint8x8x4_t vld4_u8(const uint8_t *p)
+{
+	uint8x8x4_t r;
+	int i, j;
+
+	for (i = 0; i < 8; i++)
+		for (j = 0; j < 4; j++)
+			r.val[j].v[i] = p[i * 4 + j];
+	return r;
+}
+
+static inline void vst4_u8(uint8_t *p, uint8x8x4_t a)
+{
+	int i, j;
+
+	for (i = 0; i < 8; i++)
+		for (j = 0; j < 4; j++)
+			p[i * 4 + j] = a.val[j].v[i];
+}
+
+static inline uint16x8_t vmull_u8(uint8x8_t a, uint8x8_t b)
+{
+	uint16x8_t r;
+	int i;
+
+	for (i = 0; i < 8; i++)
+		r.v[i] = (uint16_t)(a.v[i] * b.v[i]);
+	return r;
+}
+
+// a + rounded (b >> n)
+#define vrsraq_n_u16(a, b, n) stub_vrsraq_n_u16(a, b, n)
+static inline uint16x8_t stub_vrsraq_n_u16(uint16x8_t a, uint16x8_t b, int n)
+{
+	uint16x8_t r;
+	int i;
+
+	for (i = 0; i < 8; i++)
+		r.v[i] = (uint16_t)(a.v[i] + (((uint32_t)b.v[i] + (1u << (n - 1))) >> n));
+	return r;
+}
+
+// Narrowing rounded right shift
+#define vrshrn_n_u16(a, n) stub_vrshrn_n_u16(a, n)
+static inline uint8x8_t stub_vrshrn_n_u16(uint16x8_t a, int n)
+{
+	uint8x8_t r;
+	int i;
+
+	for (i = 0; i < 8; i++)
+		r.v[i] = (uint8_t)(((uint32_t)a.v[i] + (1u << (n - 1))) >> n);
+	return r;
+}
+
+static inline float32x4_t vdupq_n_f32(float x)
+{
+	float32x4_t r;
+	int i;
+
+	for (i = 0; i < 4; i++)
+		r.v[i] = x;
+	return r;
+}
+
+static inline float32x4x2_t vld2q_f32(const float *p)
+{
+	float32x4x2_t r;
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		r.val[0].v[i] = p[i * 2 + 0];
+		r.val[1].v[i] = p[i * 2 + 1];
+	}
+	return r;
+}
+
+static inline void vst2q_f32(float *p, float32x4x2_t a)
+{
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		p[i * 2 + 0] = a.val[0].v[i];
+		p[i * 2 + 1] = a.val[1].v[i];
+	}
+}
+
+static inline float32x4_t vld1q_f32(const float *p)
+{
+	float32x4_t r;
+	int i;
+
+	for (i = 0; i < 4; i++)
+		r.v[i] = p[i];
+	return r;
+}
+
+static inline void vst1q_f32(float *p, float32x4_t a)
+{
+	int i;
+
+	for (i = 0; i < 4; i++)
+		p[i] = a.v[i];
+}
+
+static inline void vst3q_f32(float *p, float32x4x3_t a)
+{
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		p[i * 3 + 0] = a.val[0].v[i];
+		p[i * 3 + 1] = a.val[1].v[i];
+		p[i * 3 + 2] = a.val[2].v[i];
+	}
+}
+
+static inline uint32x4_t vld1q_u32(const uint32_t *p)
+{
+	uint32x4_t r;
+
+	memcpy(&r, p, sizeof(r));
+	return r;
+}
+
+static inline float32x2_t vget_low_f32(float32x4_t a)
+{
+	float32x2_t r = { { a.v[0], a.v[1] } };
+	return r;
+}
+
+static inline float32x2_t vget_high_f32(float32x4_t a)
+{
+	float32x2_t r = { { a.v[2], a.v[3] } };
+	return r;
+}
+
+static inline float32x4_t vcombine_f32(float32x2_t lo, float32x2_t hi)
+{
+	float32x4_t r = { { lo.v[0], lo.v[1], hi.v[0], hi.v[1] } };
+	return r;
+}
+
+static inline float32x4x2_t vtrnq_f32(float32x4_t a, float32x4_t b)
+{
+	float32x4x2_t r;
+
+	r.val[0].v[0] = a.v[0];
+	r.val[0].v[1] = b.v[0];
+	r.val[0].v[2] = a.v[2];
+	r.val[0].v[3] = b.v[2];
+	r.val[1].v[0] = a.v[1];
+	r.val[1].v[1] = b.v[1];
+	r.val[1].v[2] = a.v[3];
+	r.val[1].v[3] = b.v[3];
+	return r;
+}
+
+#define STUB_NEON_F32_BINARY(name, expr) \
+	static inline float32x4_t name(float32x4_t a, float32x4_t b) \
+	{ \
+		float32x4_t r; \
+		int i; \
+		for (i = 0; i < 4; i++) \
+			r.v[i] = (expr); \
+		return r; \
+	}
+
+STUB_NEON_F32_BINARY(vaddq_f32, a.v[i] + b.v[i])
+STUB_NEON_F32_BINARY(vsubq_f32, a.v[i] - b.v[i])
+STUB_NEON_F32_BINARY(vmulq_f32, a.v[i] * b.v[i])
+STUB_NEON_F32_BINARY(vmaxq_f32, a.v[i] > b.v[i] ? a.v[i] : b.v[i])
+STUB_NEON_F32_BINARY(vminq_f32, a.v[i] < b.v[i] ? a.v[i] : b.v[i])
+STUB_NEON_F32_BINARY(vrsqrtsq_f32, (3.0f - a.v[i] * b.v[i]) * 0.5f)
+STUB_NEON_F32_BINARY(vrecpsq_f32, 2.0f - a.v[i] * b.v[i])
+
+static inline float32x4_t vmlaq_f32(float32x4_t a, float32x4_t b, float32x4_t c)
+{
+	float32x4_t r;
+	int i;
+
+	for (i = 0; i < 4; i++)
+		r.v[i] = a.v[i] + b.v[i] * c.v[i];
+	return r;
+}
+
+static inline float32x4_t vmlsq_f32(float32x4_t a, float32x4_t b, float32x4_t c)
+{
+	float32x4_t r;
+	int i;
+
+	for (i = 0; i < 4; i++)
+		r.v[i] = a.v[i] - b.v[i] * c.v[i];
+	return r;
+}
+
+static inline float32x4_t vmulq_n_f32(float32x4_t a, float b)
+{
+	float32x4_t r;
+	int i;
+
+	for (i = 0; i < 4; i++)
+		r.v[i] = a.v[i] * b;
+	return r;
+}
+
+static inline float32x4_t vmlaq_n_f32(float32x4_t a, float32x4_t b, float c)
+{
+	float32x4_t r;
+	int i;
+
+	for (i = 0; i < 4; i++)
+		r.v[i] = a.v[i] + b.v[i] * c;
+	return r;
+}
+
+static inline float32x4_t vmlsq_n_f32(float32x4_t a, float32x4_t b, float c)
+{
+	float32x4_t r;
+	int i;
+
+	for (i = 0; i < 4; i++)
+		r.v[i] = a.v[i] - b.v[i] * c;
+	return r;
+}
+
+static inline float32x4_t vnegq_f32(float32x4_t a)
+{
+	float32x4_t r;
+	int i;
+
+	for (i = 0; i < 4; i++)
+		r.v[i] = -a.v[i];
+	return r;
+}
+
+static inline float32x4_t vrsqrteq_f32(float32x4_t a)
+{
+	float32x4_t r;
+	int i;
+
+	for (i = 0; i < 4; i++)
+		r.v[i] = 1.0f / sqrtf(a.v[i]);
+	return r;
+}
+
+static inline float32x4_t vrecpeq_f32(float32x4_t a)
+{
+	float32x4_t r;
+	int i;
+
+	for (i = 0; i < 4; i++)
+		r.v[i] = 1.0f / a.v[i];
+	return r;
+}
+
+static inline uint32x4_t vcltq_f32(float32x4_t a, float32x4_t b)
+{
+	uint32x4_t r;
+	int i;
+
+	for (i = 0; i < 4; i++)
+		r.v[i] = a.v[i] < b.v[i] ? 0xFFFFFFFFu : 0;
+	return r;
+}
+
+// Bitwise select, a set bit takes b
+static inline float32x4_t vbslq_f32(uint32x4_t a, float32x4_t b, float32x4_t c)
+{
+	uint32_t ub[4], uc[4];
+	float32x4_t r;
+	int i;
+
+	memcpy(ub, &b, sizeof(ub));
+	memcpy(uc, &c, sizeof(uc));
+	for (i = 0; i < 4; i++)
+		ub[i] = (ub[i] & a.v[i]) | (uc[i] & ~a.v[i]);
+	memcpy(&r, ub, sizeof(r));
+	return r;
+}
+
+static inline uint32x4_t vcgtq_f32(float32x4_t a, float32x4_t b)
+{
+	uint32x4_t r;
+	int i;
+
+	for (i = 0; i < 4; i++)
+		r.v[i] = a.v[i] > b.v[i] ? 0xFFFFFFFFu : 0;
+	return r;
+}
+
+static inline uint32x4_t vandq_u32(uint32x4_t a, uint32x4_t b)
+{
+	uint32x4_t r;
+	int i;
+
+	for (i = 0; i < 4; i++)
+		r.v[i] = a.v[i] & b.v[i];
+	return r;
+}
+
+static inline uint32x4_t vreinterpretq_u32_f32(float32x4_t a)
+{
+	uint32x4_t r;
+
+	memcpy(&r, &a, sizeof(r));
+	return r;
+}
+
+static inline float32x4_t vreinterpretq_f32_u32(uint32x4_t a)
+{
+	float32x4_t r;
+
+	memcpy(&r, &a, sizeof(r));
+	return r;
+}
+
+#define vgetq_lane_f32(a, lane) ((a).v[lane])
+
+#endif
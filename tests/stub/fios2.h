@@ -0,0 +1,6 @@
+#ifndef STUB_FIOS2_H
+#define STUB_FIOS2_H
+
+#include "kernel.h"
+
+#endif
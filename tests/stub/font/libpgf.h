@@ -0,0 +1,6 @@
+#ifndef STUB_LIBPGF_H
+#define STUB_LIBPGF_H
+
+#include "../kernel.h"
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef STUB_LIBPVF_H
+#define STUB_LIBPVF_H
+
+#include "../kernel.h"
+
+typedef int ScePvfLanguageCode;
+typedef int ScePvfFamilyCode;
+typedef int ScePvfStyleCode;
+
+#endif
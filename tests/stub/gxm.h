@@ -0,0 +1,240 @@
+#ifndef STUB_GXM_H
+#define STUB_GXM_H
+
+/*
+ * Host stand-in for the GXM header. Objects the library only passes around
+ * are small structs so tests can create distinct instances, the calls are
+ * recorded by gxm_record.c.
+ */
+
+#include "kernel.h"
+
+typedef struct SceGxmContext { int id; } SceGxmContext;
+typedef struct SceGxmVertexProgram { int id; } SceGxmVertexProgram;
+typedef struct SceGxmFragmentProgram { int id; } SceGxmFragmentProgram;
+typedef struct SceGxmProgramParameter { int id; } SceGxmProgramParameter;
+typedef struct SceGxmProgram { int id; } SceGxmProgram;
+typedef struct SceGxmRenderTarget { int id; } SceGxmRenderTarget;
+typedef struct SceGxmShaderPatcher { int id; } SceGxmShaderPatcher;
+typedef struct SceGxmSyncObject { int id; } SceGxmSyncObject;
+
+// Plain fields instead of control words, without padding so memcmp works
+typedef struct SceGxmTexture {
+	const void *data;
+	const void *palette;
+	unsigned int format;
+	unsigned int width;
+	unsigned int height;
+	unsigned int minFilter;
+	unsigned int magFilter;
+	unsigned int reserved;
+} SceGxmTexture;
+
+typedef struct SceGxmColorSurface {
+	uint32_t data[8];
+} SceGxmColorSurface;
+
+typedef struct SceGxmDepthStencilSurface {
+	uint32_t data[6];
+} SceGxmDepthStencilSurface;
+
+typedef struct SceGxmNotification {
+	volatile uint32_t *address;
+	uint32_t value;
+} SceGxmNotification;
+
+typedef struct SceGxmDeviceMemInfo {
+	void *mappedBase;
+	unsigned int size;
+} SceGxmDeviceMemInfo;
+
+typedef struct SceGxmRenderTargetParams {
+	uint32_t flags;
+	uint16_t width;
+	uint16_t height;
+	uint16_t scenesPerFrame;
+	uint16_t multisampleMode;
+	uint32_t multisampleLocations;
+	SceUID driverMemBlock;
+} SceGxmRenderTargetParams;
+
+typedef enum SceGxmPrimitiveType {
+	SCE_GXM_PRIMITIVE_TRIANGLES,
+	SCE_GXM_PRIMITIVE_LINES,
+	SCE_GXM_PRIMITIVE_POINTS,
+	SCE_GXM_PRIMITIVE_TRIANGLE_STRIP,
+	SCE_GXM_PRIMITIVE_TRIANGLE_FAN,
+	SCE_GXM_PRIMITIVE_TRIANGLE_EDGES
+} SceGxmPrimitiveType;
+
+typedef enum SceGxmIndexFormat {
+	SCE_GXM_INDEX_FORMAT_U16,
+	SCE_GXM_INDEX_FORMAT_U32
+} SceGxmIndexFormat;
+
+typedef enum SceGxmPolygonMode {
+	SCE_GXM_POLYGON_MODE_TRIANGLE_FILL,
+	SCE_GXM_POLYGON_MODE_LINE,
+	SCE_GXM_POLYGON_MODE_POINT_10UV,
+	SCE_GXM_POLYGON_MODE_POINT,
+	SCE_GXM_POLYGON_MODE_POINT_01UV,
+	SCE_GXM_POLYGON_MODE_TRIANGLE_LINE,
+	SCE_GXM_POLYGON_MODE_TRIANGLE_POINT
+} SceGxmPolygonMode;
+
+typedef enum SceGxmStencilFunc {
+	SCE_GXM_STENCIL_FUNC_NEVER,
+	SCE_GXM_STENCIL_FUNC_LESS,
+	SCE_GXM_STENCIL_FUNC_EQUAL,
+	SCE_GXM_STENCIL_FUNC_LESS_EQUAL,
+	SCE_GXM_STENCIL_FUNC_GREATER,
+	SCE_GXM_STENCIL_FUNC_NOT_EQUAL,
+	SCE_GXM_STENCIL_FUNC_GREATER_EQUAL,
+	SCE_GXM_STENCIL_FUNC_ALWAYS
+} SceGxmStencilFunc;
+
+typedef enum SceGxmStencilOp {
+	SCE_GXM_STENCIL_OP_KEEP,
+	SCE_GXM_STENCIL_OP_ZERO,
+	SCE_GXM_STENCIL_OP_REPLACE,
+	SCE_GXM_STENCIL_OP_INCR,
+	SCE_GXM_STENCIL_OP_DECR,
+	SCE_GXM_STENCIL_OP_INVERT,
+	SCE_GXM_STENCIL_OP_INCR_WRAP,
+	SCE_GXM_STENCIL_OP_DECR_WRAP
+} SceGxmStencilOp;
+
+typedef enum SceGxmDepthFunc {
+	SCE_GXM_DEPTH_FUNC_NEVER,
+	SCE_GXM_DEPTH_FUNC_LESS,
+	SCE_GXM_DEPTH_FUNC_EQUAL,
+	SCE_GXM_DEPTH_FUNC_LESS_EQUAL,
+	SCE_GXM_DEPTH_FUNC_GREATER,
+	SCE_GXM_DEPTH_FUNC_NOT_EQUAL,
+	SCE_GXM_DEPTH_FUNC_GREATER_EQUAL,
+	SCE_GXM_DEPTH_FUNC_ALWAYS
+} SceGxmDepthFunc;
+
+typedef enum SceGxmDepthWriteMode {
+	SCE_GXM_DEPTH_WRITE_DISABLED,
+	SCE_GXM_DEPTH_WRITE_ENABLED
+} SceGxmDepthWriteMode;
+
+typedef enum SceGxmRegionClipMode {
+	SCE_GXM_REGION_CLIP_NONE,
+	SCE_GXM_REGION_CLIP_ALL,
+	SCE_GXM_REGION_CLIP_OUTSIDE,
+	SCE_GXM_REGION_CLIP_INSIDE
+} SceGxmRegionClipMode;
+
+typedef enum SceGxmMultisampleMode {
+	SCE_GXM_MULTISAMPLE_NONE,
+	SCE_GXM_MULTISAMPLE_2X,
+	SCE_GXM_MULTISAMPLE_4X
+} SceGxmMultisampleMode;
+
+typedef enum SceGxmTextureFilter {
+	SCE_GXM_TEXTURE_FILTER_POINT,
+	SCE_GXM_TEXTURE_FILTER_LINEAR
+} SceGxmTextureFilter;
+
+typedef enum SceGxmDeviceHeapId {
+	SCE_GXM_DEVICE_HEAP_ID_SYSTEM,
+	SCE_GXM_DEVICE_HEAP_ID_USER_NC,
+	SCE_GXM_DEVICE_HEAP_ID_CDRAM
+} SceGxmDeviceHeapId;
+
+typedef unsigned int SceGxmTextureFormat;
+typedef unsigned int SceGxmColorFormat;
+
+#define SCE_GXM_TEXTURE_BASE_FORMAT_U8			0x00000000U
+#define SCE_GXM_TEXTURE_BASE_FORMAT_S8			0x01000000U
+#define SCE_GXM_TEXTURE_BASE_FORMAT_U4U4U4U4	0x02000000U
+#define SCE_GXM_TEXTURE_BASE_FORMAT_U8U3U3U2	0x03000000U
+#define SCE_GXM_TEXTURE_BASE_FORMAT_U1U5U5U5	0x04000000U
+#define SCE_GXM_TEXTURE_BASE_FORMAT_U5U6U5		0x05000000U
+#define SCE_GXM_TEXTURE_BASE_FORMAT_S5S5U6		0x06000000U
+#define SCE_GXM_TEXTURE_BASE_FORMAT_U8U8		0x07000000U
+#define SCE_GXM_TEXTURE_BASE_FORMAT_S8S8		0x08000000U
+#define SCE_GXM_TEXTURE_BASE_FORMAT_U8U8U8U8	0x0C000000U
+#define SCE_GXM_TEXTURE_BASE_FORMAT_S8S8S8S8	0x0D000000U
+#define SCE_GXM_TEXTURE_BASE_FORMAT_F32			0x11000000U
+#define SCE_GXM_TEXTURE_BASE_FORMAT_U32			0x19000000U
+#define SCE_GXM_TEXTURE_BASE_FORMAT_S32			0x1A000000U
+#define SCE_GXM_TEXTURE_BASE_FORMAT_U8U8U8		0x98000000U
+#define SCE_GXM_TEXTURE_BASE_FORMAT_S8S8S8		0x99000000U
+#define SCE_GXM_TEXTURE_BASE_FORMAT_P8			0x95000000U
+
+#define SCE_GXM_TEXTURE_FORMAT_U8U8U8U8_ABGR	(SCE_GXM_TEXTURE_BASE_FORMAT_U8U8U8U8 | 0x0000U)
+#define SCE_GXM_TEXTURE_FORMAT_A8B8G8R8			SCE_GXM_TEXTURE_FORMAT_U8U8U8U8_ABGR
+#define SCE_GXM_TEXTURE_FORMAT_U8_R111			(SCE_GXM_TEXTURE_BASE_FORMAT_U8 | 0x4000U)
+
+#define SCE_GXM_COLOR_FORMAT_A8B8G8R8			0x00000000U
+
+#define SCE_GXM_MEMORY_ATTRIB_READ				1
+#define SCE_GXM_MEMORY_ATTRIB_WRITE				2
+
+#define SCE_GXM_TEXTURE_ALIGNMENT				16
+#define SCE_GXM_PALETTE_ALIGNMENT				64
+#define SCE_GXM_COLOR_SURFACE_ALIGNMENT			4
+#define SCE_GXM_DEPTHSTENCIL_SURFACE_ALIGNMENT	16
+#define SCE_GXM_TILE_SIZEX						32
+#define SCE_GXM_TILE_SIZEY						32
+
+#define SCE_GXM_NOTIFICATION_COUNT				512
+
+#define SCE_GXM_COLOR_SURFACE_LINEAR			0
+#define SCE_GXM_COLOR_SURFACE_SCALE_NONE		0
+#define SCE_GXM_COLOR_SURFACE_SCALE_MSAA_DOWNSCALE	1
+#define SCE_GXM_OUTPUT_REGISTER_SIZE_32BIT		0
+#define SCE_GXM_DEPTH_STENCIL_FORMAT_S8D24		0
+#define SCE_GXM_DEPTH_STENCIL_SURFACE_TILED		0
+
+volatile unsigned int *sceGxmGetNotificationRegion(void);
+int sceGxmNotificationWait(const SceGxmNotification *notification);
+int sceGxmFinish(SceGxmContext *context);
+
+int sceGxmAllocDeviceMemLinux(SceGxmDeviceHeapId heapId, uint32_t memAttribs, uint32_t size, uint32_t alignment, SceGxmDeviceMemInfo **memInfo);
+int sceGxmFreeDeviceMemLinux(SceGxmDeviceMemInfo *memInfo);
+
+int sceGxmDraw(SceGxmContext *context, SceGxmPrimitiveType primType, SceGxmIndexFormat indexType, const void *indexData, unsigned int indexCount);
+int sceGxmDrawInstanced(SceGxmContext *context, SceGxmPrimitiveType primType, SceGxmIndexFormat indexType, const void *indexData, unsigned int indexCount, unsigned int indexWrap);
+int sceGxmSetVertexStream(SceGxmContext *context, unsigned int streamIndex, const void *streamData);
+void sceGxmSetVertexProgram(SceGxmContext *context, const SceGxmVertexProgram *vertexProgram);
+void sceGxmSetFragmentProgram(SceGxmContext *context, const SceGxmFragmentProgram *fragmentProgram);
+int sceGxmSetFragmentTexture(SceGxmContext *context, unsigned int textureIndex, const SceGxmTexture *texture);
+void sceGxmSetFrontPolygonMode(SceGxmContext *context, SceGxmPolygonMode mode);
+void sceGxmSetBackPolygonMode(SceGxmContext *context, SceGxmPolygonMode mode);
+void sceGxmSetFrontStencilFunc(SceGxmContext *context, SceGxmStencilFunc func, SceGxmStencilOp stencilFail, SceGxmStencilOp depthFail,
+	SceGxmStencilOp depthPass, unsigned char compareMask, unsigned char writeMask);
+void sceGxmSetFrontDepthFunc(SceGxmContext *context, SceGxmDepthFunc depthFunc);
+void sceGxmSetBackDepthFunc(SceGxmContext *context, SceGxmDepthFunc depthFunc);
+void sceGxmSetFrontDepthWriteEnable(SceGxmContext *context, SceGxmDepthWriteMode enable);
+void sceGxmSetBackDepthWriteEnable(SceGxmContext *context, SceGxmDepthWriteMode enable);
+void sceGxmSetRegionClip(SceGxmContext *context, SceGxmRegionClipMode mode, unsigned int xMin, unsigned int yMin, unsigned int xMax, unsigned int yMax);
+int sceGxmReserveVertexDefaultUniformBuffer(SceGxmContext *context, void **uniformBuffer);
+int sceGxmReserveFragmentDefaultUniformBuffer(SceGxmContext *context, void **uniformBuffer);
+int sceGxmSetUniformDataF(void *uniformBuffer, const SceGxmProgramParameter *parameter, unsigned int componentOffset, unsigned int componentCount,
+	const float *sourceData);
+
+int sceGxmTextureInitLinear(SceGxmTexture *texture, const void *data, SceGxmTextureFormat texFormat, unsigned int width, unsigned int height,
+	unsigned int mipCount);
+void *sceGxmTextureGetData(const SceGxmTexture *texture);
+SceGxmTextureFormat sceGxmTextureGetFormat(const SceGxmTexture *texture);
+unsigned int sceGxmTextureGetWidth(const SceGxmTexture *texture);
+unsigned int sceGxmTextureGetHeight(const SceGxmTexture *texture);
+SceGxmTextureFilter sceGxmTextureGetMinFilter(const SceGxmTexture *texture);
+SceGxmTextureFilter sceGxmTextureGetMagFilter(const SceGxmTexture *texture);
+int sceGxmTextureSetMinFilter(SceGxmTexture *texture, SceGxmTextureFilter minFilter);
+int sceGxmTextureSetMagFilter(SceGxmTexture *texture, SceGxmTextureFilter magFilter);
+void *sceGxmTextureGetPalette(const SceGxmTexture *texture);
+int sceGxmTextureSetPalette(SceGxmTexture *texture, const void *paletteData);
+
+int sceGxmColorSurfaceInit(SceGxmColorSurface *surface, SceGxmColorFormat colorFormat, int surfaceType, int scaleMode, int outputRegisterSize,
+	unsigned int width, unsigned int height, unsigned int strideInPixels, void *data);
+int sceGxmDepthStencilSurfaceInit(SceGxmDepthStencilSurface *surface, int depthStencilFormat, int surfaceType, unsigned int strideInSamples,
+	void *depthData, void *stencilData);
+int sceGxmCreateRenderTarget(const SceGxmRenderTargetParams *params, SceGxmRenderTarget **renderTarget);
+int sceGxmDestroyRenderTarget(SceGxmRenderTarget *renderTarget);
+
+#endif
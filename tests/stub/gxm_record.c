@@ -0,0 +1,424 @@
+#include <stdlib.h>
+#include <time.h>
+#include "gxm_record.h"
+
+#define RECORD_MAX_CALLS	(64 * 1024)
+#define ARENA_SIZE			(32 * 1024 * 1024)
+#define UNIFORM_SIZE		(64 * 1024)
+
+/*
+ * The library keeps device addresses in 32 bit integers, the harness links
+ * without PIE so static storage stays below 4 GB and the casts hold.
+ */
+static unsigned char arena[ARENA_SIZE] __attribute__((aligned(4096)));
+static unsigned int arena_used = 0;
+static SceGxmDeviceMemInfo mem_infos[1024];
+static unsigned int mem_info_count = 0;
+static unsigned char uniforms[UNIFORM_SIZE] __attribute__((aligned(16)));
+static SceGxmRenderTarget render_target;
+static volatile unsigned int notifications[SCE_GXM_NOTIFICATION_COUNT];
+
+static gxm_call_record records[RECORD_MAX_CALLS];
+static unsigned int record_count = 0;
+
+static const void *bound_stream[2];
+static const SceGxmVertexProgram *bound_vertex_program;
+static const SceGxmFragmentProgram *bound_fragment_program;
+static SceGxmTexture bound_texture;
+
+static gxm_call_record *record(gxm_call call)
+{
+	gxm_call_record *r;
+
+	if (record_count == RECORD_MAX_CALLS) {
+		fprintf(stderr, "gxm_record: log is full\n");
+		abort();
+	}
+
+	r = &records[record_count++];
+	memset(r, 0, sizeof(*r));
+	r->call = call;
+	r->stream[0] = bound_stream[0];
+	r->stream[1] = bound_stream[1];
+	r->vertexProgram = bound_vertex_program;
+	r->fragmentProgram = bound_fragment_program;
+	r->texture = bound_texture;
+
+	return r;
+}
+
+void gxm_record_reset(void)
+{
+	record_count = 0;
+}
+
+unsigned int gxm_record_size(void)
+{
+	return record_count;
+}
+
+const gxm_call_record *gxm_record_get(unsigned int index)
+{
+	return index < record_count ? &records[index] : NULL;
+}
+
+unsigned int gxm_record_count(gxm_call call)
+{
+	unsigned int i, n = 0;
+
+	for (i = 0; i < record_count; i++)
+		if (records[i].call == call)
+			n++;
+
+	return n;
+}
+
+const gxm_call_record *gxm_record_find(gxm_call call, unsigned int nth)
+{
+	unsigned int i;
+
+	for (i = 0; i < record_count; i++)
+		if (records[i].call == call && nth-- == 0)
+			return &records[i];
+
+	return NULL;
+}
+
+volatile unsigned int *sceGxmGetNotificationRegion(void)
+{
+	return notifications;
+}
+
+int sceGxmNotificationWait(const SceGxmNotification *notification)
+{
+	// Work is done as soon as it is submitted
+	*notification->address = notification->value;
+	return SCE_OK;
+}
+
+int sceGxmFinish(SceGxmContext *context)
+{
+	(void)context;
+	return SCE_OK;
+}
+
+int sceGxmAllocDeviceMemLinux(SceGxmDeviceHeapId heapId, uint32_t memAttribs, uint32_t size, uint32_t alignment, SceGxmDeviceMemInfo **memInfo)
+{
+	unsigned int offset = (arena_used + alignment - 1) & ~(alignment - 1);
+
+	(void)heapId;
+	(void)memAttribs;
+
+	if (offset + size > ARENA_SIZE || mem_info_count == sizeof(mem_infos) / sizeof(mem_infos[0]))
+		return -1;
+
+	arena_used = offset + size;
+	memset(&arena[offset], 0, size);
+
+	*memInfo = &mem_infos[mem_info_count++];
+	(*memInfo)->mappedBase = &arena[offset];
+	(*memInfo)->size = size;
+
+	return SCE_OK;
+}
+
+int sceGxmFreeDeviceMemLinux(SceGxmDeviceMemInfo *memInfo)
+{
+	// Arena memory is never reused, tests are short
+	(void)memInfo;
+	return SCE_OK;
+}
+
+int sceGxmDraw(SceGxmContext *context, SceGxmPrimitiveType primType, SceGxmIndexFormat indexType, const void *indexData, unsigned int indexCount)
+{
+	gxm_call_record *r = record(GXM_CALL_DRAW);
+
+	(void)context;
+	r->primitive = primType;
+	r->indexFormat = indexType;
+	r->indices = indexData;
+	r->indexCount = indexCount;
+
+	return SCE_OK;
+}
+
+int sceGxmDrawInstanced(SceGxmContext *context, SceGxmPrimitiveType primType, SceGxmIndexFormat indexType, const void *indexData, unsigned int indexCount, unsigned int indexWrap)
+{
+	gxm_call_record *r = record(GXM_CALL_DRAW_INSTANCED);
+
+	(void)context;
+	r->primitive = primType;
+	r->indexFormat = indexType;
+	r->indices = indexData;
+	r->indexCount = indexCount;
+	r->indexWrap = indexWrap;
+
+	return SCE_OK;
+}
+
+int sceGxmSetVertexStream(SceGxmContext *context, unsigned int streamIndex, const void *streamData)
+{
+	(void)context;
+	if (streamIndex < 2)
+		bound_stream[streamIndex] = streamData;
+	record(GXM_CALL_SET_VERTEX_STREAM);
+	return SCE_OK;
+}
+
+void sceGxmSetVertexProgram(SceGxmContext *context, const SceGxmVertexProgram *vertexProgram)
+{
+	(void)context;
+	bound_vertex_program = vertexProgram;
+	record(GXM_CALL_SET_VERTEX_PROGRAM);
+}
+
+void sceGxmSetFragmentProgram(SceGxmContext *context, const SceGxmFragmentProgram *fragmentProgram)
+{
+	(void)context;
+	bound_fragment_program = fragmentProgram;
+	record(GXM_CALL_SET_FRAGMENT_PROGRAM);
+}
+
+int sceGxmSetFragmentTexture(SceGxmContext *context, unsigned int textureIndex, const SceGxmTexture *texture)
+{
+	(void)context;
+	(void)textureIndex;
+	bound_texture = *texture;
+	record(GXM_CALL_SET_FRAGMENT_TEXTURE);
+	return SCE_OK;
+}
+
+void sceGxmSetFrontPolygonMode(SceGxmContext *context, SceGxmPolygonMode mode)
+{
+	(void)context;
+	(void)mode;
+	record(GXM_CALL_SET_POLYGON_MODE);
+}
+
+void sceGxmSetBackPolygonMode(SceGxmContext *context, SceGxmPolygonMode mode)
+{
+	(void)context;
+	(void)mode;
+	record(GXM_CALL_SET_POLYGON_MODE);
+}
+
+void sceGxmSetFrontStencilFunc(SceGxmContext *context, SceGxmStencilFunc func, SceGxmStencilOp stencilFail, SceGxmStencilOp depthFail,
+	SceGxmStencilOp depthPass, unsigned char compareMask, unsigned char writeMask)
+{
+	(void)context;
+	(void)func;
+	(void)stencilFail;
+	(void)depthFail;
+	(void)depthPass;
+	(void)compareMask;
+	(void)writeMask;
+	record(GXM_CALL_SET_STENCIL_FUNC);
+}
+
+void sceGxmSetFrontDepthFunc(SceGxmContext *context, SceGxmDepthFunc depthFunc)
+{
+	(void)context;
+	(void)depthFunc;
+	record(GXM_CALL_SET_DEPTH);
+}
+
+void sceGxmSetBackDepthFunc(SceGxmContext *context, SceGxmDepthFunc depthFunc)
+{
+	(void)context;
+	(void)depthFunc;
+	record(GXM_CALL_SET_DEPTH);
+}
+
+void sceGxmSetFrontDepthWriteEnable(SceGxmContext *context, SceGxmDepthWriteMode enable)
+{
+	(void)context;
+	(void)enable;
+	record(GXM_CALL_SET_DEPTH);
+}
+
+void sceGxmSetBackDepthWriteEnable(SceGxmContext *context, SceGxmDepthWriteMode enable)
+{
+	(void)context;
+	(void)enable;
+	record(GXM_CALL_SET_DEPTH);
+}
+
+void sceGxmSetRegionClip(SceGxmContext *context, SceGxmRegionClipMode mode, unsigned int xMin, unsigned int yMin, unsigned int xMax, unsigned int yMax)
+{
+	(void)context;
+	(void)mode;
+	(void)xMin;
+	(void)yMin;
+	(void)xMax;
+	(void)yMax;
+	record(GXM_CALL_SET_REGION_CLIP);
+}
+
+int sceGxmReserveVertexDefaultUniformBuffer(SceGxmContext *context, void **uniformBuffer)
+{
+	(void)context;
+	*uniformBuffer = uniforms;
+	record(GXM_CALL_RESERVE_UNIFORMS);
+	return SCE_OK;
+}
+
+int sceGxmReserveFragmentDefaultUniformBuffer(SceGxmContext *context, void **uniformBuffer)
+{
+	(void)context;
+	*uniformBuffer = uniforms;
+	record(GXM_CALL_RESERVE_UNIFORMS);
+	return SCE_OK;
+}
+
+int sceGxmSetUniformDataF(void *uniformBuffer, const SceGxmProgramParameter *parameter, unsigned int componentOffset, unsigned int componentCount,
+	const float *sourceData)
+{
+	(void)parameter;
+	if ((componentOffset + componentCount) * sizeof(float) <= UNIFORM_SIZE)
+		memcpy((float *)uniformBuffer + componentOffset, sourceData, componentCount * sizeof(float));
+	return SCE_OK;
+}
+
+int sceGxmTextureInitLinear(SceGxmTexture *texture, const void *data, SceGxmTextureFormat texFormat, unsigned int width, unsigned int height,
+	unsigned int mipCount)
+{
+	(void)mipCount;
+	memset(texture, 0, sizeof(*texture));
+	texture->data = data;
+	texture->format = texFormat;
+	texture->width = width;
+	texture->height = height;
+	return SCE_OK;
+}
+
+void *sceGxmTextureGetData(const SceGxmTexture *texture)
+{
+	return (void *)texture->data;
+}
+
+SceGxmTextureFormat sceGxmTextureGetFormat(const SceGxmTexture *texture)
+{
+	return texture->format;
+}
+
+unsigned int sceGxmTextureGetWidth(const SceGxmTexture *texture)
+{
+	return texture->width;
+}
+
+unsigned int sceGxmTextureGetHeight(const SceGxmTexture *texture)
+{
+	return texture->height;
+}
+
+SceGxmTextureFilter sceGxmTextureGetMinFilter(const SceGxmTexture *texture)
+{
+	return (SceGxmTextureFilter)texture->minFilter;
+}
+
+SceGxmTextureFilter sceGxmTextureGetMagFilter(const SceGxmTexture *texture)
+{
+	return (SceGxmTextureFilter)texture->magFilter;
+}
+
+int sceGxmTextureSetMinFilter(SceGxmTexture *texture, SceGxmTextureFilter minFilter)
+{
+	texture->minFilter = minFilter;
+	return SCE_OK;
+}
+
+int sceGxmTextureSetMagFilter(SceGxmTexture *texture, SceGxmTextureFilter magFilter)
+{
+	texture->magFilter = magFilter;
+	return SCE_OK;
+}
+
+void *sceGxmTextureGetPalette(const SceGxmTexture *texture)
+{
+	return (void *)texture->palette;
+}
+
+int sceGxmTextureSetPalette(SceGxmTexture *texture, const void *paletteData)
+{
+	texture->palette = paletteData;
+	return SCE_OK;
+}
+
+int sceGxmColorSurfaceInit(SceGxmColorSurface *surface, SceGxmColorFormat colorFormat, int surfaceType, int scaleMode, int outputRegisterSize,
+	unsigned int width, unsigned int height, unsigned int strideInPixels, void *data)
+{
+	(void)colorFormat;
+	(void)surfaceType;
+	(void)scaleMode;
+	(void)outputRegisterSize;
+	(void)width;
+	(void)height;
+	(void)strideInPixels;
+	(void)data;
+	memset(surface, 0, sizeof(*surface));
+	return SCE_OK;
+}
+
+int sceGxmDepthStencilSurfaceInit(SceGxmDepthStencilSurface *surface, int depthStencilFormat, int surfaceType, unsigned int strideInSamples,
+	void *depthData, void *stencilData)
+{
+	(void)depthStencilFormat;
+	(void)surfaceType;
+	(void)strideInSamples;
+	(void)depthData;
+	(void)stencilData;
+	memset(surface, 0, sizeof(*surface));
+	return SCE_OK;
+}
+
+int sceGxmCreateRenderTarget(const SceGxmRenderTargetParams *params, SceGxmRenderTarget **renderTarget)
+{
+	(void)params;
+	*renderTarget = &render_target;
+	return SCE_OK;
+}
+
+int sceGxmDestroyRenderTarget(SceGxmRenderTarget *renderTarget)
+{
+	(void)renderTarget;
+	return SCE_OK;
+}
+
+SceUInt64 sceKernelGetProcessTimeWide(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (SceUInt64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int sceKernelCreateLwMutex(SceKernelLwMutexWork *work, const char *name, unsigned int attr, int count, void *opt)
+{
+	(void)name;
+	(void)attr;
+	(void)count;
+	(void)opt;
+	memset(work, 0, sizeof(*work));
+	return SCE_OK;
+}
+
+int sceKernelDeleteLwMutex(SceKernelLwMutexWork *work)
+{
+	(void)work;
+	return SCE_OK;
+}
+
+int sceKernelLockLwMutex(SceKernelLwMutexWork *work, int count, unsigned int *timeout)
+{
+	(void)work;
+	(void)count;
+	(void)timeout;
+	return SCE_OK;
+}
+
+int sceKernelUnlockLwMutex(SceKernelLwMutexWork *work, int count)
+{
+	(void)work;
+	(void)count;
+	return SCE_OK;
+}
@@ -0,0 +1,48 @@
+#ifndef GXM_RECORD_H
+#define GXM_RECORD_H
+
+/*
+ * Recording stand-in for sceGxm. Every context call the library makes is
+ * appended to a log together with the state bound at that point, tests
+ * inspect the log instead of a GPU.
+ */
+
+#include "gxm.h"
+
+typedef enum gxm_call {
+	GXM_CALL_DRAW,
+	GXM_CALL_DRAW_INSTANCED,
+	GXM_CALL_SET_VERTEX_STREAM,
+	GXM_CALL_SET_VERTEX_PROGRAM,
+	GXM_CALL_SET_FRAGMENT_PROGRAM,
+	GXM_CALL_SET_FRAGMENT_TEXTURE,
+	GXM_CALL_SET_POLYGON_MODE,
+	GXM_CALL_SET_STENCIL_FUNC,
+	GXM_CALL_SET_DEPTH,
+	GXM_CALL_SET_REGION_CLIP,
+	GXM_CALL_RESERVE_UNIFORMS,
+	GXM_CALL_COUNT
+} gxm_call;
+
+typedef struct gxm_call_record {
+	gxm_call call;
+	SceGxmPrimitiveType primitive;		// Draws only
+	SceGxmIndexFormat indexFormat;
+	unsigned int indexCount;
+	unsigned int indexWrap;
+	const void *indices;
+	const void *stream[2];				// Streams bound when the draw was issued
+	const SceGxmVertexProgram *vertexProgram;
+	const SceGxmFragmentProgram *fragmentProgram;
+	SceGxmTexture texture;
+} gxm_call_record;
+
+void gxm_record_reset(void);
+unsigned int gxm_record_size(void);
+const gxm_call_record *gxm_record_get(unsigned int index);
+unsigned int gxm_record_count(gxm_call call);
+
+// Nth call of the given kind, NULL if there are fewer
+const gxm_call_record *gxm_record_find(gxm_call call, unsigned int nth);
+
+#endif
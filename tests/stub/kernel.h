@@ -0,0 +1,55 @@
+#ifndef STUB_KERNEL_H
+#define STUB_KERNEL_H
+
+/*
+ * Host stand-in for the parts of the SDK kernel headers the tested sources
+ * use. Only what the library references is declared.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+
+typedef int SceUID;
+typedef unsigned int SceSize;
+typedef int SceInt32;
+typedef unsigned int SceUInt32;
+typedef long long SceInt64;
+typedef unsigned long long SceUInt64;
+typedef uintptr_t SceUIntPtr;
+typedef int SceBool;
+typedef int SceKernelMemBlockType;
+
+#define SCE_OK					0
+#define SCE_NULL				NULL
+#define SCE_UID_INVALID_UID		(-1)
+#define SCE_TRUE				1
+#define SCE_FALSE				0
+
+#define SCE_KERNEL_MEMBLOCK_TYPE_USER_RW				0x0C20D060
+#define SCE_KERNEL_MEMBLOCK_TYPE_USER_CDRAM_RW			0x09408060
+#define SCE_KERNEL_MEMBLOCK_TYPE_USER_MAIN_PHYCONT_NC_RW	0x0C80D060
+
+typedef struct SceKernelLwMutexWork {
+	SceInt64 data[4];
+} SceKernelLwMutexWork;
+
+#define sceClibMemset		memset
+#define sceClibMemcpy		memcpy
+#define sceClibMemcmp		memcmp
+#define sceClibMemmove		memmove
+#define sceClibStrcmp		strcmp
+#define sceClibStrncpy		strncpy
+#define sceClibPrintf		printf
+#define sceClibSnprintf		snprintf
+#define sceClibVsnprintf	vsnprintf
+
+SceUInt64 sceKernelGetProcessTimeWide(void);
+int sceKernelCreateLwMutex(SceKernelLwMutexWork *work, const char *name, unsigned int attr, int count, void *opt);
+int sceKernelDeleteLwMutex(SceKernelLwMutexWork *work);
+int sceKernelLockLwMutex(SceKernelLwMutexWork *work, int count, unsigned int *timeout);
+int sceKernelUnlockLwMutex(SceKernelLwMutexWork *work, int count);
+
+#endif
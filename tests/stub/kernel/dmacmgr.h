@@ -0,0 +1,9 @@
+#ifndef STUB_DMACMGR_H
+#define STUB_DMACMGR_H
+
+#include <string.h>
+
+#define sceDmacMemset	memset
+#define sceDmacMemcpy	memcpy
+
+#endif
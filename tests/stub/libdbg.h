@@ -0,0 +1,11 @@
+#ifndef STUB_LIBDBG_H
+#define STUB_LIBDBG_H
+
+#include <stdio.h>
+
+#define SCE_DBG_LOG_ERROR(...)		(fprintf(stderr, __VA_ARGS__), fputc('\n', stderr))
+#define SCE_DBG_LOG_WARNING(...)	(fprintf(stderr, __VA_ARGS__), fputc('\n', stderr))
+#define SCE_DBG_LOG_INFO(...)		((void)0)
+#define SCE_DBG_LOG_DEBUG(...)		((void)0)
+
+#endif
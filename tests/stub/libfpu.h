@@ -0,0 +1,11 @@
+#ifndef STUB_LIBFPU_H
+#define STUB_LIBFPU_H
+
+#include <math.h>
+
+#define sceFpuSinf	sinf
+#define sceFpuCosf	cosf
+#define sceFpuSqrtf	sqrtf
+#define sceFpuAtan2f	atan2f
+
+#endif
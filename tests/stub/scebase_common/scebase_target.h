@@ -0,0 +1,6 @@
+#ifndef STUB_SCEBASE_TARGET_H
+#define STUB_SCEBASE_TARGET_H
+
+#define _SCE_HOST_COMPILER_SNC	0
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef STUB_SCECONST_H
+#define STUB_SCECONST_H
+
+#define SCE_MATH_PI		3.14159265358979323846f
+
+#endif
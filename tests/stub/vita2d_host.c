@@ -0,0 +1,270 @@
+#include <stdlib.h>
+#include <kernel.h>
+#include <gxm.h>
+#include <libdbg.h>
+#include "vita2d_sys.h"
+#include "shared.h"
+#include "heap.h"
+#include "utils.h"
+#include "gxm_record.h"
+#include "vita2d_host.h"
+
+#define HOST_HEAP_SIZE		(8 * 1024 * 1024)
+
+static SceGxmContext context;
+static SceGxmVertexProgram vertex_programs[9];
+static SceGxmFragmentProgram fragment_programs[6];
+static SceGxmProgramParameter params[7];
+static vita2d_fragment_programs normal_programs;
+static uint16_t *linear_indices;
+
+static unsigned char heap[HOST_HEAP_SIZE] __attribute__((aligned(16)));
+static unsigned int heap_used = 0;
+
+void *vita2d_heap_internal = heap;
+SceGxmContext *_vita2d_context = &context;
+vita2d_draw_ctx _vita2d_default_ctx = {
+	.clip = { 0, 0, 0, 960, 544 }
+};
+SceGxmVertexProgram *_vita2d_colorVertexProgram = &vertex_programs[0];
+SceGxmVertexProgram *_vita2d_colorCompactVertexProgram = &vertex_programs[1];
+SceGxmVertexProgram *_vita2d_colorMeshVertexProgram = &vertex_programs[2];
+SceGxmVertexProgram *_vita2d_textureVertexProgram = &vertex_programs[3];
+SceGxmVertexProgram *_vita2d_textureTintVertexProgram = &vertex_programs[4];
+SceGxmVertexProgram *_vita2d_textureTintArrayVertexProgram = &vertex_programs[5];
+SceGxmVertexProgram *_vita2d_spriteVertexProgram = &vertex_programs[6];
+SceGxmVertexProgram *_vita2d_shapeVertexProgram = &vertex_programs[7];
+SceGxmVertexProgram *_vita2d_textureTintWideVertexProgram = &vertex_programs[8];
+const SceGxmProgramParameter *_vita2d_colorWvpParam = &params[0];
+const SceGxmProgramParameter *_vita2d_colorCompactWvpParam = &params[1];
+const SceGxmProgramParameter *_vita2d_textureWvpParam = &params[2];
+const SceGxmProgramParameter *_vita2d_textureTintWvpParam = &params[3];
+const SceGxmProgramParameter *_vita2d_spriteWvpParam = &params[4];
+const SceGxmProgramParameter *_vita2d_spriteInvTexSizeParam = &params[5];
+const SceGxmProgramParameter *_vita2d_shapeWvpParam = &params[6];
+const float *_vita2d_spriteQuadVertices = NULL;
+const uint16_t *_vita2d_spriteQuadIndices = NULL;
+
+/* Heap, every block keeps its size in front so realloc can copy */
+
+void *heap_alloc_heap_memory(void *h, unsigned int nbytes)
+{
+	unsigned int *block;
+	unsigned int offset = (heap_used + 15) & ~15u;
+
+	(void)h;
+	if (offset + 16 + nbytes > HOST_HEAP_SIZE)
+		return NULL;
+
+	heap_used = offset + 16 + nbytes;
+	block = (unsigned int *)&heap[offset + 16];
+	block[-1] = nbytes;
+
+	return block;
+}
+
+int heap_free_heap_memory(void *h, void *ptr)
+{
+	// Bump allocator, tests are short
+	(void)h;
+	(void)ptr;
+	return 0;
+}
+
+void *heap_realloc_heap_memory(void *h, void *ptr, unsigned int nbytes)
+{
+	void *block = heap_alloc_heap_memory(h, nbytes);
+	unsigned int size;
+
+	if (block && ptr) {
+		size = ((unsigned int *)ptr)[-1];
+		memcpy(block, ptr, size < nbytes ? size : nbytes);
+	}
+
+	return block;
+}
+
+int check_free_memory(SceKernelMemBlockType type, SceSize size)
+{
+	(void)type;
+	(void)size;
+	return 1;
+}
+
+/* vita2d.c */
+
+int vita2d_fini()
+{
+	return 0;
+}
+
+const uint16_t *vita2d_get_linear_indices()
+{
+	return linear_indices;
+}
+
+int vita2d_get_clipping_enabled()
+{
+	return _vita2d_ctx()->clip.enabled;
+}
+
+int vita2d_get_culling_enabled()
+{
+	return 0;
+}
+
+int _vita2d_visibility(float x_min, float y_min, float x_max, float y_max)
+{
+	(void)x_min;
+	(void)y_min;
+	(void)x_max;
+	(void)y_max;
+	return VITA2D_CLIP_INSIDE;
+}
+
+void _vita2d_clip_require_stencil(void)
+{
+}
+
+int _vita2d_clip_quad(float *x0, float *y0, float *x1, float *y1, float *u0, float *v0, float *u1, float *v1)
+{
+	(void)x0;
+	(void)y0;
+	(void)x1;
+	(void)y1;
+	(void)u0;
+	(void)v0;
+	(void)u1;
+	(void)v1;
+	return 1;
+}
+
+#ifndef VITA2D_SYS_NO_STATS
+void _vita2d_stats_reset(vita2d_draw_ctx *ctx)
+{
+	memset(&ctx->counters, 0, sizeof(vita2d_frame_counters));
+}
+#endif
+
+/* vita2d_deferred.c, vita2d_queue.c and vita2d_display_list.c are not part of the harness */
+
+vita2d_draw_ctx *_vita2d_ctx(void)
+{
+	return &_vita2d_default_ctx;
+}
+
+int _vita2d_queue_enabled(void)
+{
+	return 0;
+}
+
+void _vita2d_queue_submit(void)
+{
+}
+
+void *_vita2d_queue_alloc_quads(const SceGxmVertexProgram *vertexProgram, const SceGxmFragmentProgram *fragmentProgram,
+	const SceGxmProgramParameter *wvpParam, const SceGxmTexture *texture, unsigned int stride, unsigned int count)
+{
+	(void)vertexProgram;
+	(void)fragmentProgram;
+	(void)wvpParam;
+	(void)texture;
+	(void)stride;
+	(void)count;
+	return NULL;
+}
+
+int _vita2d_display_list_recording(void)
+{
+	return 0;
+}
+
+void *_vita2d_display_list_alloc_quads(const SceGxmVertexProgram *vertexProgram, const SceGxmFragmentProgram *fragmentProgram,
+	const SceGxmProgramParameter *wvpParam, const SceGxmTexture *texture, unsigned int stride, unsigned int count)
+{
+	(void)vertexProgram;
+	(void)fragmentProgram;
+	(void)wvpParam;
+	(void)texture;
+	(void)stride;
+	(void)count;
+	return NULL;
+}
+
+/* Harness */
+
+static void ortho(float *m, float w, float h)
+{
+	memset(m, 0, 16 * sizeof(float));
+	m[0] = 2.0f / w;
+	m[5] = -2.0f / h;
+	m[10] = -1.0f;
+	m[12] = -1.0f;
+	m[13] = 1.0f;
+	m[15] = 1.0f;
+}
+
+int vita2d_host_init(unsigned int pool_size)
+{
+	static const float quad_vertices[8] = { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+	static const uint16_t quad_indices[6] = { 0, 1, 2, 2, 1, 3 };
+	SceGxmDeviceMemInfo *mem;
+	unsigned int i;
+	int err;
+
+	err = sceGxmAllocDeviceMemLinux(SCE_GXM_DEVICE_HEAP_ID_USER_NC, SCE_GXM_MEMORY_ATTRIB_READ,
+		(UINT16_MAX + 1) * sizeof(uint16_t), sizeof(uint16_t), &mem);
+	if (err != SCE_OK)
+		return err;
+
+	linear_indices = mem->mappedBase;
+	for (i = 0; i <= UINT16_MAX; i++)
+		linear_indices[i] = i;
+
+	_vita2d_spriteQuadVertices = quad_vertices;
+	_vita2d_spriteQuadIndices = quad_indices;
+
+	normal_programs.color = &fragment_programs[0];
+	normal_programs.colorCompact = &fragment_programs[1];
+	normal_programs.texture = &fragment_programs[2];
+	normal_programs.textureTint = &fragment_programs[3];
+	normal_programs.sprite = &fragment_programs[4];
+	normal_programs.shape = &fragment_programs[5];
+
+	_vita2d_default_ctx.context = _vita2d_context;
+	_vita2d_default_ctx.programs = &normal_programs;
+	_vita2d_default_ctx.blendMode = VITA2D_BLEND_MODE_NORMAL;
+	ortho(_vita2d_default_ctx.ortho, 960.0f, 544.0f);
+
+	err = _vita2d_batch_init();
+	if (err != SCE_OK)
+		return err;
+
+	err = _vita2d_circle_init();
+	if (err != SCE_OK)
+		return err;
+
+	_vita2d_polyline_init();
+
+	return _vita2d_pool_init(pool_size);
+}
+
+void vita2d_host_begin_scene(void)
+{
+	_vita2d_pool_next_frame();
+	_vita2d_batch_reset_stats();
+	_vita2d_state_reset_stats();
+	_vita2d_stats_reset(&_vita2d_default_ctx);
+	_vita2d_state_invalidate();
+	gxm_record_reset();
+}
+
+void vita2d_host_end_scene(void)
+{
+	_vita2d_batch_flush();
+}
+
+const vita2d_fragment_programs *vita2d_host_programs(void)
+{
+	return &normal_programs;
+}
@@ -0,0 +1,25 @@
+#ifndef VITA2D_HOST_H
+#define VITA2D_HOST_H
+
+/*
+ * Host side of vita2d.c for the tests: program objects, the default draw
+ * context and the frame bookkeeping the tested sources expect, without a
+ * display or shader patcher behind them.
+ */
+
+#include <kernel.h>
+#include <gxm.h>
+#include "vita2d_sys.h"
+#include "shared.h"
+
+// Set up what vita2d_init() would, returns 0 on success
+int vita2d_host_init(unsigned int pool_size);
+
+// vita2d_start_drawing() / vita2d_end_drawing() without the display, the record log starts empty
+void vita2d_host_begin_scene(void);
+void vita2d_host_end_scene(void);
+
+// Fragment programs of the normal blend mode
+const vita2d_fragment_programs *vita2d_host_programs(void);
+
+#endif
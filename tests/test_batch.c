@@ -0,0 +1,121 @@
+/*
+ * Draw calls issued by the batcher for sequences of textures and rectangles.
+ */
+
+#include "stub/gxm_record.h"
+#include "stub/vita2d_host.h"
+#include "check.h"
+
+#define QUADS	64
+
+static vita2d_texture *tex_a;
+static vita2d_texture *tex_b;
+
+static void test_contiguous_textures(void)
+{
+	int i;
+
+	vita2d_host_begin_scene();
+	for (i = 0; i < QUADS; i++)
+		vita2d_draw_texture(tex_a, (float)i, 0.0f);
+	vita2d_host_end_scene();
+
+	// One draw for the whole run, one texture bind
+	CHECK_EQ(gxm_record_count(GXM_CALL_DRAW) + gxm_record_count(GXM_CALL_DRAW_INSTANCED), 1);
+	CHECK_EQ(gxm_record_count(GXM_CALL_SET_FRAGMENT_TEXTURE), 1);
+	CHECK_EQ(vita2d_get_draw_call_count(), 1);
+}
+
+static void test_contiguous_rectangles(void)
+{
+	int i;
+
+	vita2d_host_begin_scene();
+	for (i = 0; i < QUADS; i++)
+		vita2d_draw_rectangle((float)i, 0.0f, 4.0f, 4.0f, 0xFF00FF00);
+	vita2d_host_end_scene();
+
+	CHECK_EQ(gxm_record_count(GXM_CALL_DRAW) + gxm_record_count(GXM_CALL_DRAW_INSTANCED), 1);
+	CHECK_EQ(vita2d_get_draw_call_count(), 1);
+}
+
+static void test_interleaved_texture_rectangle(void)
+{
+	int i;
+
+	vita2d_host_begin_scene();
+	for (i = 0; i < QUADS; i++) {
+		vita2d_draw_texture(tex_a, (float)i, 0.0f);
+		vita2d_draw_rectangle((float)i, 8.0f, 4.0f, 4.0f, 0xFF00FF00);
+	}
+	vita2d_host_end_scene();
+
+	// Programs change on every quad, nothing can be merged
+	CHECK_EQ(gxm_record_count(GXM_CALL_DRAW) + gxm_record_count(GXM_CALL_DRAW_INSTANCED), 2 * QUADS);
+	CHECK_EQ(vita2d_get_draw_call_count(), 2 * QUADS);
+}
+
+static void test_interleaved_textures(void)
+{
+	const gxm_call_record *draw;
+	int i;
+
+	vita2d_host_begin_scene();
+	for (i = 0; i < QUADS; i++) {
+		vita2d_draw_texture(tex_a, (float)i, 0.0f);
+		vita2d_draw_texture(tex_b, (float)i, 8.0f);
+	}
+	vita2d_host_end_scene();
+
+	CHECK_EQ(gxm_record_count(GXM_CALL_DRAW) + gxm_record_count(GXM_CALL_DRAW_INSTANCED), 2 * QUADS);
+
+	// Every draw samples the texture it was batched with
+	for (i = 0; i < 2 * QUADS; i++) {
+		draw = gxm_record_find(GXM_CALL_DRAW, i);
+		if (!draw)
+			break;
+		CHECK(draw->texture.data == (i & 1 ? tex_b : tex_a)->data_mem->mappedBase);
+	}
+}
+
+static void test_runs_of_textures(void)
+{
+	int i;
+
+	// Two runs per texture, a draw per run
+	vita2d_host_begin_scene();
+	for (i = 0; i < QUADS; i++)
+		vita2d_draw_texture(tex_a, (float)i, 0.0f);
+	for (i = 0; i < QUADS; i++)
+		vita2d_draw_texture(tex_b, (float)i, 0.0f);
+	for (i = 0; i < QUADS; i++)
+		vita2d_draw_rectangle((float)i, 0.0f, 4.0f, 4.0f, 0xFF0000FF);
+	for (i = 0; i < QUADS; i++)
+		vita2d_draw_texture(tex_a, (float)i, 0.0f);
+	vita2d_host_end_scene();
+
+	CHECK_EQ(gxm_record_count(GXM_CALL_DRAW) + gxm_record_count(GXM_CALL_DRAW_INSTANCED), 4);
+	CHECK_EQ(vita2d_get_draw_call_count(), 4);
+}
+
+int main(void)
+{
+	if (vita2d_host_init(1024 * 1024) != 0) {
+		fprintf(stderr, "vita2d_host_init() failed\n");
+		return 1;
+	}
+
+	tex_a = vita2d_create_empty_texture(32, 32);
+	tex_b = vita2d_create_empty_texture(32, 32);
+	CHECK(tex_a && tex_b);
+	if (!tex_a || !tex_b)
+		return 1;
+
+	test_contiguous_textures();
+	test_contiguous_rectangles();
+	test_interleaved_texture_rectangle();
+	test_interleaved_textures();
+	test_runs_of_textures();
+
+	return CHECK_RESULT();
+}
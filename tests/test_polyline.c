@@ -0,0 +1,303 @@
+/*
+ * Polyline geometry: round joins cover every point near the line exactly
+ * once, miter joints extruded 4 at a time match the per joint formula.
+ */
+
+#include <math.h>
+#include "stub/gxm_record.h"
+#include "stub/vita2d_host.h"
+#include "check.h"
+
+#define WHITE	0xFFFFFFFF
+
+static const vita2d_color_compact_vertex *draw_vertices(unsigned int nth, const uint16_t **indices, unsigned int *count)
+{
+	const gxm_call_record *draw = gxm_record_find(GXM_CALL_DRAW, nth);
+
+	if (!draw)
+		return NULL;
+
+	*indices = draw->indices;
+	*count = draw->indexCount;
+	return draw->stream[0];
+}
+
+static int inside(const vita2d_color_compact_vertex *a, const vita2d_color_compact_vertex *b, const vita2d_color_compact_vertex *c,
+	double x, double y)
+{
+	double area = (b->x - a->x) * (double)(c->y - a->y) - (b->y - a->y) * (double)(c->x - a->x);
+	double w0 = (b->x - x) * (c->y - y) - (b->y - y) * (c->x - x);
+	double w1 = (c->x - x) * (a->y - y) - (c->y - y) * (a->x - x);
+	double w2 = (a->x - x) * (b->y - y) - (a->y - y) * (b->x - x);
+
+	if (fabs(area) < 1e-9)
+		return 0;
+	if (area < 0) {
+		w0 = -w0;
+		w1 = -w1;
+		w2 = -w2;
+	}
+	return w0 > 0 && w1 > 0 && w2 > 0;
+}
+
+// Distance to the segment, or a negative value when (x, y) is past its ends
+static double segment_distance(const float *p, const float *q, double x, double y)
+{
+	double dx = q[0] - p[0], dy = q[1] - p[1];
+	double t = ((x - p[0]) * dx + (y - p[1]) * dy) / (dx * dx + dy * dy);
+
+	if (t < 0 || t > 1)
+		return -1.0;
+	return fabs((x - p[0]) * dy - (y - p[1]) * dx) / sqrt(dx * dx + dy * dy);
+}
+
+static double point_distance(const float *p, double x, double y)
+{
+	return sqrt((x - p[0]) * (x - p[0]) + (y - p[1]) * (y - p[1]));
+}
+
+/* Distance to the line with square ends and round joints, 1e30 when past the ends */
+static double polyline_distance(const float *points, unsigned int count, double x, double y)
+{
+	double d, best = 1e30;
+	unsigned int i;
+
+	for (i = 0; i + 1 < count; i++) {
+		d = segment_distance(&points[i * 2], &points[i * 2 + 2], x, y);
+		if (d >= 0 && d < best)
+			best = d;
+	}
+	for (i = 1; i + 1 < count; i++) {
+		d = point_distance(&points[i * 2], x, y);
+		if (d < best)
+			best = d;
+	}
+	return best;
+}
+
+/*
+ * Samples the polyline on a grid off the pixel centers. Samples closer to the
+ * line than its half width must be covered, samples further than half width
+ * plus feather must not. Unless the line overlaps itself, no sample may be
+ * covered twice.
+ */
+static void check_coverage(const float *points, unsigned int count, float thickness, int overlaps)
+{
+	const vita2d_color_compact_vertex *vertices;
+	const uint16_t *indices;
+	unsigned int index_count, i, hits;
+	unsigned int twice = 0, holes = 0, outside = 0;
+	double x, y, d;
+	const double half = thickness * 0.5;
+
+	vertices = draw_vertices(0, &indices, &index_count);
+	CHECK(vertices != NULL);
+	CHECK_EQ(gxm_record_count(GXM_CALL_DRAW), 1);
+	if (!vertices)
+		return;
+
+	for (y = -40.13; y < 300.0; y += 0.5) {
+		for (x = -40.29; x < 300.0; x += 0.5) {
+			hits = 0;
+			for (i = 0; i < index_count; i += 3)
+				hits += inside(&vertices[indices[i]], &vertices[indices[i + 1]], &vertices[indices[i + 2]], x, y);
+
+			d = polyline_distance(points, count, x, y);
+			if (hits > 1)
+				twice++;
+			if (hits == 0 && d < half - 0.01)
+				holes++;
+			if (hits && d > half + 0.5 + 0.01)
+				outside++;
+		}
+	}
+
+	if (!overlaps)
+		CHECK_EQ(twice, 0);
+	CHECK_EQ(holes, 0);
+	CHECK_EQ(outside, 0);
+}
+
+static void test_round_join_coverage(void)
+{
+	// Left and right turns, a straight joint and a right angle
+	static const float points[] = {
+		10.0f, 10.0f,
+		120.0f, 20.0f,
+		200.0f, 110.0f,
+		120.0f, 160.0f,
+		60.0f, 180.0f,
+		0.0f, 200.0f,
+		0.0f, 280.0f,
+		90.0f, 280.0f,
+	};
+	const unsigned int count = sizeof(points) / sizeof(points[0]) / 2;
+
+	vita2d_host_begin_scene();
+	vita2d_draw_polyline(points, count, 12.0f, VITA2D_LINE_JOIN_ROUND, WHITE);
+	vita2d_host_end_scene();
+	check_coverage(points, count, 12.0f, 0);
+
+	vita2d_host_begin_scene();
+	vita2d_draw_polyline(points, count, 3.0f, VITA2D_LINE_JOIN_ROUND, WHITE);
+	vita2d_host_end_scene();
+	check_coverage(points, count, 3.0f, 0);
+}
+
+static void test_round_join_sharp(void)
+{
+	// Turns past the miter limit and a segment shorter than the line is wide
+	static const float points[] = {
+		0.0f, 200.0f,
+		250.0f, 250.0f,
+		40.0f, 230.0f,
+		150.0f, 100.0f,
+		154.0f, 104.0f,
+		40.0f, 10.0f,
+	};
+	const unsigned int count = sizeof(points) / sizeof(points[0]) / 2;
+
+	vita2d_host_begin_scene();
+	vita2d_draw_polyline(points, count, 12.0f, VITA2D_LINE_JOIN_ROUND, WHITE);
+	vita2d_host_end_scene();
+	check_coverage(points, count, 12.0f, 1);
+}
+
+static void test_miter_groups(void)
+{
+	float points[64 * 2];
+	const vita2d_color_compact_vertex *vertices;
+	const uint16_t *indices;
+	unsigned int index_count, i, k;
+	const float inner = (8.0f - 1.0f) * 0.5f;
+	const float outer = inner + 1.0f;
+	const float scale[4] = { outer, inner, -inner, -outer };
+	float worst = 0.0f;
+
+	// Zig-zag with growing turns, a folded joint and a repeated point
+	for (i = 0; i < 64; i++) {
+		points[i * 2 + 0] = 20.0f + i * 12.0f;
+		points[i * 2 + 1] = 200.0f + ((i & 1) ? 1.0f : -1.0f) * (float)(i % 7) * 9.0f;
+	}
+	points[30 * 2 + 0] = points[29 * 2 + 0];
+	points[30 * 2 + 1] = points[29 * 2 + 1];
+	points[41 * 2 + 0] = points[39 * 2 + 0];
+	points[41 * 2 + 1] = points[39 * 2 + 1];
+
+	vita2d_host_begin_scene();
+	vita2d_draw_polyline(points, 64, 8.0f, VITA2D_LINE_JOIN_MITER, WHITE);
+	vita2d_host_end_scene();
+
+	vertices = draw_vertices(0, &indices, &index_count);
+	CHECK(vertices != NULL);
+	if (!vertices)
+		return;
+	CHECK_EQ(index_count, 63 * 18);
+
+	for (i = 0; i < 64; i++) {
+		double n0[2], n1[2], mx, my, len, cos_half, s;
+		int a = i == 0 ? 0 : (int)i - 1;
+		int b = i == 63 ? 62 : (int)i;
+		unsigned int j;
+
+		// Normals of the segments around the joint, zero length segments take the one before
+		for (j = 0; j < 2; j++) {
+			int seg = j ? b : a;
+			double dx, dy;
+
+			do {
+				dx = points[seg * 2 + 2] - points[seg * 2];
+				dy = points[seg * 2 + 3] - points[seg * 2 + 1];
+			} while (dx * dx + dy * dy <= 1e-12 && --seg >= 0);
+
+			len = sqrt(dx * dx + dy * dy);
+			(j ? n1 : n0)[0] = -dy / len;
+			(j ? n1 : n0)[1] = dx / len;
+		}
+
+		mx = n0[0] + n1[0];
+		my = n0[1] + n1[1];
+		len = sqrt(mx * mx + my * my);
+		if (len * len < 1e-6) {
+			mx = n0[0];
+			my = n0[1];
+			s = 1.0;
+		}
+		else {
+			mx /= len;
+			my /= len;
+			cos_half = mx * n1[0] + my * n1[1];
+			s = cos_half * 4.0 > 1.0 ? 1.0 / cos_half : 4.0;
+		}
+
+		for (k = 0; k < 4; k++) {
+			const vita2d_color_compact_vertex *v = &vertices[i * 4 + k];
+			float ex = (float)(points[i * 2 + 0] + mx * s * scale[k]);
+			float ey = (float)(points[i * 2 + 1] + my * s * scale[k]);
+			float err = fabsf(v->x - ex) + fabsf(v->y - ey);
+
+			if (err > worst)
+				worst = err;
+			CHECK_EQ(v->color, (k == 0 || k == 3) ? (WHITE & 0x00FFFFFF) : WHITE);
+		}
+	}
+
+	CHECK(worst < 1e-3f);
+}
+
+static void test_single_draw(void)
+{
+	static float points[10000 * 2];
+	const gxm_call_record *draw;
+	const uint32_t *indices;
+	unsigned int i, max_index = 0, vertex_count;
+
+	for (i = 0; i < 10000; i++) {
+		points[i * 2 + 0] = 960.0f * i / 10000;
+		points[i * 2 + 1] = 272.0f + 200.0f * sinf(i * 0.05f) + 20.0f * sinf(i * 1.7f);
+	}
+
+	// Short polylines keep 16 bit indices
+	vita2d_host_begin_scene();
+	vita2d_draw_polyline(points, 100, 16.0f, VITA2D_LINE_JOIN_ROUND, WHITE);
+	vita2d_host_end_scene();
+
+	draw = gxm_record_find(GXM_CALL_DRAW, 0);
+	CHECK_EQ(gxm_record_count(GXM_CALL_DRAW), 1);
+	CHECK(draw && draw->indexFormat == SCE_GXM_INDEX_FORMAT_U16);
+
+	// Past 65536 vertices the polyline is still one draw, with 32 bit indices
+	vita2d_host_begin_scene();
+	vita2d_draw_polyline(points, 10000, 16.0f, VITA2D_LINE_JOIN_ROUND, WHITE);
+	vita2d_host_end_scene();
+
+	vertex_count = _vita2d_default_ctx.counters.vertices;
+	draw = gxm_record_find(GXM_CALL_DRAW, 0);
+	CHECK_EQ(gxm_record_count(GXM_CALL_DRAW), 1);
+	CHECK(vertex_count > 65536);
+	CHECK(draw && draw->indexFormat == SCE_GXM_INDEX_FORMAT_U32);
+	if (!draw)
+		return;
+
+	indices = draw->indices;
+	for (i = 0; i < draw->indexCount; i++) {
+		if (indices[i] > max_index)
+			max_index = indices[i];
+	}
+	CHECK_EQ(max_index, vertex_count - 1);
+}
+
+int main(void)
+{
+	if (vita2d_host_init(4 * 1024 * 1024) != 0) {
+		fprintf(stderr, "vita2d_host_init() failed\n");
+		return 1;
+	}
+
+	test_round_join_coverage();
+	test_round_join_sharp();
+	test_miter_groups();
+	test_single_draw();
+
+	return CHECK_RESULT();
+}
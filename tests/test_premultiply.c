@@ -0,0 +1,83 @@
+/*
+ * premultiply_alpha() against the scalar premultiply_alpha_ref() and against
+ * round(c * a / 255), for every (color, alpha) pair and for runs that don't
+ * fill a whole NEON group or don't start on an aligned address.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "premultiply.h"
+#include "check.h"
+
+#define PAIRS	(256 * 256)
+#define GUARD	0xA5
+
+static unsigned char pixels[PAIRS * 4];
+static unsigned char reference[PAIRS * 4];
+
+static void test_all_pairs(void)
+{
+	unsigned int c, a, i, mismatches = 0;
+
+	// Each channel sees every color against every alpha, in a different order
+	for (a = 0; a < 256; a++) {
+		for (c = 0; c < 256; c++) {
+			i = (a * 256 + c) * 4;
+			pixels[i + 0] = c;
+			pixels[i + 1] = 255 - c;
+			pixels[i + 2] = c ^ 0x5A;
+			pixels[i + 3] = a;
+		}
+	}
+	memcpy(reference, pixels, sizeof(pixels));
+
+	premultiply_alpha(pixels, PAIRS);
+	premultiply_alpha_ref(reference, PAIRS);
+
+	CHECK(memcmp(pixels, reference, sizeof(pixels)) == 0);
+
+	for (a = 0; a < 256; a++) {
+		for (c = 0; c < 256; c++) {
+			i = (a * 256 + c) * 4;
+			if (reference[i + 0] != (c * a * 2 + 255) / 510 || reference[i + 3] != a)
+				mismatches++;
+		}
+	}
+	CHECK_EQ(mismatches, 0);
+}
+
+static void test_tails(void)
+{
+	unsigned char buf[64 * 4 + 8], ref[64 * 4 + 8];
+	unsigned int offset, count, i;
+
+	// Every count up to eight NEON groups, at every byte offset
+	for (offset = 0; offset < 4; offset++) {
+		for (count = 0; count <= 64; count++) {
+			memset(buf, GUARD, sizeof(buf));
+			for (i = 0; i < count * 4; i++)
+				buf[offset + i] = (unsigned char)(rand() >> 4);
+			memcpy(ref, buf, sizeof(buf));
+
+			premultiply_alpha(buf + offset, count);
+			premultiply_alpha_ref(ref + offset, count);
+
+			// Bytes around the run are compared too
+			if (memcmp(buf, ref, sizeof(buf)) != 0) {
+				fprintf(stderr, "offset %u, count %u differs\n", offset, count);
+				CHECK(0);
+			}
+			CHECK_EQ(buf[offset + count * 4], GUARD);
+		}
+	}
+}
+
+int main(void)
+{
+	srand(1);
+
+	test_all_pairs();
+	test_tails();
+
+	return CHECK_RESULT();
+}
@@ -0,0 +1,96 @@
+/*
+ * Texcoords written for batched texture quads.
+ */
+
+#include <math.h>
+#include "stub/gxm_record.h"
+#include "stub/vita2d_host.h"
+#include "check.h"
+
+static vita2d_texture *tex;
+
+static int near(float a, float b)
+{
+	return fabsf(a - b) < 1e-5f;
+}
+
+static void test_normalized_texcoords(void)
+{
+	const gxm_call_record *draw;
+	const vita2d_texture_tint_vertex *v;
+
+	vita2d_host_begin_scene();
+	vita2d_draw_texture_part(tex, 0.0f, 0.0f, 16.0f, 8.0f, 16.0f, 24.0f);
+	vita2d_host_end_scene();
+
+	draw = gxm_record_find(GXM_CALL_DRAW, 0);
+	CHECK(draw != NULL);
+	if (!draw)
+		return;
+
+	CHECK(draw->vertexProgram == _vita2d_textureTintVertexProgram);
+	v = draw->stream[0];
+	CHECK_EQ(v[0].u, 0x8000);
+	CHECK_EQ(v[0].v, 0x4000);
+	CHECK_EQ(v[3].u, 0xFFFF);
+	CHECK_EQ(v[3].v, 0xFFFF);
+}
+
+static void test_tiled_texcoords(void)
+{
+	const gxm_call_record *draw;
+	const vita2d_texture_tint_wide_vertex *v;
+
+	// Four times the texture across, shifted back by half of it
+	vita2d_host_begin_scene();
+	vita2d_draw_texture_part(tex, 0.0f, 0.0f, -16.0f, 0.0f, 128.0f, 32.0f);
+	vita2d_host_end_scene();
+
+	draw = gxm_record_find(GXM_CALL_DRAW, 0);
+	CHECK(draw != NULL);
+	if (!draw)
+		return;
+
+	CHECK(draw->vertexProgram == _vita2d_textureTintWideVertexProgram);
+	v = draw->stream[0];
+	CHECK(near(v[0].u, -0.5f));
+	CHECK(near(v[0].v, 0.0f));
+	CHECK(near(v[1].u, 3.5f));
+	CHECK(near(v[2].v, 1.0f));
+	CHECK(near(v[3].u, 3.5f));
+	CHECK(near(v[3].v, 1.0f));
+	CHECK(near(v[3].x, 128.0f));
+	CHECK(near(v[3].y, 32.0f));
+}
+
+static void test_tiled_breaks_batch(void)
+{
+	vita2d_host_begin_scene();
+	vita2d_draw_texture(tex, 0.0f, 0.0f);
+	vita2d_draw_texture_part(tex, 0.0f, 0.0f, 0.0f, 0.0f, 64.0f, 64.0f);
+	vita2d_draw_texture_part(tex, 0.0f, 0.0f, 0.0f, 0.0f, 64.0f, 64.0f);
+	vita2d_draw_texture(tex, 0.0f, 0.0f);
+	vita2d_host_end_scene();
+
+	// Tiled quads have their own vertex layout, runs of them still batch
+	CHECK_EQ(gxm_record_count(GXM_CALL_DRAW), 3);
+}
+
+int main(void)
+{
+	if (vita2d_host_init(1024 * 1024) != 0) {
+		fprintf(stderr, "vita2d_host_init() failed\n");
+		return 1;
+	}
+
+	tex = vita2d_create_empty_texture(32, 32);
+	CHECK(tex != NULL);
+	if (!tex)
+		return 1;
+
+	test_normalized_texcoords();
+	test_tiled_texcoords();
+	test_tiled_breaks_batch();
+
+	return CHECK_RESULT();
+}